@@ -57,9 +57,8 @@ void Error_Handler(void);
 /* USER CODE END EFP */
 
 /* Private defines -----------------------------------------------------------*/
-#define Joy_Pin GPIO_PIN_7
-#define Joy_GPIO_Port GPIOF
-#define Joy_EXTI_IRQn EXTI9_5_IRQn
+#define Joy_Pin GPIO_PIN_6
+#define Joy_GPIO_Port GPIOB
 
 /* USER CODE BEGIN Private defines */
 
@@ -32,6 +32,8 @@ extern "C" {
 
 /* USER CODE END Includes */
 
+extern UART_HandleTypeDef huart4;
+
 extern UART_HandleTypeDef huart1;
 
 extern UART_HandleTypeDef huart2;
@@ -44,6 +46,7 @@ extern UART_HandleTypeDef huart6;
 
 /* USER CODE END Private defines */
 
+void MX_UART4_Init(void);
 void MX_USART1_UART_Init(void);
 void MX_USART2_UART_Init(void);
 void MX_USART3_UART_Init(void);
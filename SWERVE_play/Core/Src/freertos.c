@@ -25,10 +25,12 @@
 
 /* Private includes ----------------------------------------------------------*/
 /* USER CODE BEGIN Includes */
+#include "service_config.h"
 
 /* USER CODE END Includes */
 
 /* Private typedef -----------------------------------------------------------*/
+typedef StaticTask_t osStaticThreadDef_t;
 /* USER CODE BEGIN PTD */
 
 /* USER CODE END PTD */
@@ -49,51 +51,74 @@
 /* USER CODE END Variables */
 /* Definitions for CAN1_Send */
 osThreadId_t CAN1_SendHandle;
+uint32_t CAN1_SendBuffer[ CAN1_SEND_STACK ] CCM_RAM;
+osStaticThreadDef_t CAN1_SendControlBlock CCM_RAM;
 const osThreadAttr_t CAN1_Send_attributes = {
   .name = "CAN1_Send",
-  .stack_size = 128 * 4,
+  .cb_mem = &CAN1_SendControlBlock,
+  .cb_size = sizeof(CAN1_SendControlBlock),
+  .stack_mem = &CAN1_SendBuffer[0],
+  .stack_size = sizeof(CAN1_SendBuffer),
   .priority = (osPriority_t) osPriorityNormal,
 };
 /* Definitions for chassic */
 osThreadId_t chassicHandle;
+uint32_t chassicBuffer[ CHASSIS_STACK ] CCM_RAM;
+osStaticThreadDef_t chassicControlBlock CCM_RAM;
 const osThreadAttr_t chassic_attributes = {
   .name = "chassic",
-  .stack_size = 128 * 4,
+  .cb_mem = &chassicControlBlock,
+  .cb_size = sizeof(chassicControlBlock),
+  .stack_mem = &chassicBuffer[0],
+  .stack_size = sizeof(chassicBuffer),
   .priority = (osPriority_t) osPriorityHigh,
 };
 /* Definitions for CAN2_Send */
 osThreadId_t CAN2_SendHandle;
+uint32_t CAN2_SendBuffer[ CAN2_SEND_STACK ] CCM_RAM;
+osStaticThreadDef_t CAN2_SendControlBlock CCM_RAM;
 const osThreadAttr_t CAN2_Send_attributes = {
   .name = "CAN2_Send",
-  .stack_size = 128 * 4,
-  .priority = (osPriority_t) osPriorityLow,
-};
-/* Definitions for UART_Send */
-osThreadId_t UART_SendHandle;
-const osThreadAttr_t UART_Send_attributes = {
-  .name = "UART_Send",
-  .stack_size = 128 * 4,
+  .cb_mem = &CAN2_SendControlBlock,
+  .cb_size = sizeof(CAN2_SendControlBlock),
+  .stack_mem = &CAN2_SendBuffer[0],
+  .stack_size = sizeof(CAN2_SendBuffer),
   .priority = (osPriority_t) osPriorityLow,
 };
 /* Definitions for user_debug */
 osThreadId_t user_debugHandle;
+uint32_t user_debugBuffer[ USER_DEBUG_STACK ] CCM_RAM;
+osStaticThreadDef_t user_debugControlBlock CCM_RAM;
 const osThreadAttr_t user_debug_attributes = {
   .name = "user_debug",
-  .stack_size = 128 * 4,
+  .cb_mem = &user_debugControlBlock,
+  .cb_size = sizeof(user_debugControlBlock),
+  .stack_mem = &user_debugBuffer[0],
+  .stack_size = sizeof(user_debugBuffer),
   .priority = (osPriority_t) osPriorityLow,
 };
 /* Definitions for Air_Joy */
 osThreadId_t Air_JoyHandle;
+uint32_t Air_JoyBuffer[ AIR_JOY_STACK ] CCM_RAM;
+osStaticThreadDef_t Air_JoyControlBlock CCM_RAM;
 const osThreadAttr_t Air_Joy_attributes = {
   .name = "Air_Joy",
-  .stack_size = 128 * 4,
+  .cb_mem = &Air_JoyControlBlock,
+  .cb_size = sizeof(Air_JoyControlBlock),
+  .stack_mem = &Air_JoyBuffer[0],
+  .stack_size = sizeof(Air_JoyBuffer),
   .priority = (osPriority_t) osPriorityLow,
 };
 /* Definitions for Broadcast */
 osThreadId_t BroadcastHandle;
+uint32_t BroadcastBuffer[ BROADCAST_STACK ] CCM_RAM;
+osStaticThreadDef_t BroadcastControlBlock CCM_RAM;
 const osThreadAttr_t Broadcast_attributes = {
   .name = "Broadcast",
-  .stack_size = 128 * 4,
+  .cb_mem = &BroadcastControlBlock,
+  .cb_size = sizeof(BroadcastControlBlock),
+  .stack_mem = &BroadcastBuffer[0],
+  .stack_size = sizeof(BroadcastBuffer),
   .priority = (osPriority_t) osPriorityLow,
 };
 
@@ -105,13 +130,57 @@ const osThreadAttr_t Broadcast_attributes = {
 void CAN1_Send_Task(void *argument);
 extern void Chassis_Task(void *argument);
 extern void CAN2_Send_Task(void *argument);
-extern void UART_Send_Task(void *argument);
 extern void User_Debug_Task(void *argument);
 extern void Air_Joy_Task(void *argument);
 extern void Broadcast_Task(void *argument);
 
 void MX_FREERTOS_Init(void); /* (MISRA C 2004 rule 8.1) */
 
+/* Hook prototypes */
+void configureTimerForRunTimeStats(void);
+unsigned long getRunTimeCounterValue(void);
+void vApplicationStackOverflowHook(TaskHandle_t xTask, signed char *pcTaskName);
+void vApplicationMallocFailedHook(void);
+
+/* USER CODE BEGIN 1 */
+/* Functions needed when configGENERATE_RUN_TIME_STATS is on */
+/**
+  * @brief  运行时间统计使用系统us定时器TIM4，在System_Resource_Init中已经启动，这里不用再配置。
+  *         计数器32位，约71分钟回绕，统计时只使用两次采样的差值，见task_monitor.cpp
+  */
+void configureTimerForRunTimeStats(void)
+{
+
+}
+
+unsigned long getRunTimeCounterValue(void)
+{
+  return Get_SystemTimer();
+}
+/* USER CODE END 1 */
+
+/* USER CODE BEGIN 4 */
+/**
+  * @brief  任务切换时检查栈(方法2：栈底16字节的填充值被改写)，溢出时停在这里，
+  *         调试器中pcTaskName为溢出的任务，加大service_config.h中对应的栈
+  */
+void vApplicationStackOverflowHook(TaskHandle_t xTask, signed char *pcTaskName)
+{
+  Error_Handler();
+}
+/* USER CODE END 4 */
+
+/* USER CODE BEGIN 5 */
+/**
+  * @brief  任务、队列都是静态分配的，堆只是cmsis_os2.c链接需要。有动态创建的对象时停在这里，
+  *         不让启动依赖堆的剩余空间
+  */
+void vApplicationMallocFailedHook(void)
+{
+  Error_Handler();
+}
+/* USER CODE END 5 */
+
 /**
   * @brief  FreeRTOS initialization
   * @param  None
@@ -148,9 +217,6 @@ void MX_FREERTOS_Init(void) {
   /* creation of CAN2_Send */
   CAN2_SendHandle = osThreadNew(CAN2_Send_Task, NULL, &CAN2_Send_attributes);
 
-  /* creation of UART_Send */
-  UART_SendHandle = osThreadNew(UART_Send_Task, NULL, &UART_Send_attributes);
-
   /* creation of user_debug */
   user_debugHandle = osThreadNew(User_Debug_Task, NULL, &user_debug_attributes);
 
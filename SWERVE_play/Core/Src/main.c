@@ -100,6 +100,7 @@ int main(void)
   MX_USART6_UART_Init();
   MX_TIM4_Init();
   MX_TIM10_Init();
+  MX_UART4_Init();
   /* USER CODE BEGIN 2 */
   System_Resource_Init();
   /* USER CODE END 2 */
@@ -1,7 +1,7 @@
 /**
  * @file data_pool.cpp
  * @author Yang JianYi
- * @brief 数据池文件，用于存放数据以及队列。结构体定义在data_pool.h文件中
+ * @brief 数据池文件，用于存放数据、队列以及话题。结构体定义在data_pool.h文件中
  * @version 0.1
  * @date 2024-05-16
  * 
@@ -11,27 +11,56 @@
 #include "data_pool.h"
 
 //定义队列
-QueueHandle_t Port;
 QueueHandle_t  CAN1_TxPort;
 QueueHandle_t  CAN2_TxPort;
-QueueHandle_t  UART_TxPort;
-QueueHandle_t Recieve_ROS_Port;
-QueueHandle_t Chassia_Port;
-QueueHandle_t Broadcast_Port;
+QueueHandle_t Tune_Port;
+
+//定义话题
+Topic<Motor_Feedback_t> Rudder_Feedback("motor.rudder");
+Topic<Motor_Feedback_t> Wheel_Feedback("motor.wheel");
+Topic<Robot_Twist_t> Chassis_Cmd("chassis.cmd");
+Topic<Chassis_Odom_t> Chassis_Odom("chassis.odom");
+Topic<Robot_Status_t> Robot_Status("robot.status");
 
 //ROS串口接收缓存数组
 uint8_t Uart3_Rx_Buff[ROS_UART_SIZE];
 
+//IMU串口接收缓存数组
+uint8_t Uart6_Rx_Buff[IMU_RX_POOL_NUM][IMU_UART_SIZE];
+
+//调参串口接收缓存数组
+uint8_t Uart2_Rx_Buff[TUNE_RX_POOL_NUM][TUNE_UART_SIZE];
+
+//航模接收机PPM捕获缓存、SBUS/iBUS串口接收缓存
+uint16_t PPM_Capture_Buff[RC_PPM_BUF_SIZE];
+uint8_t Uart4_Rx_Buff[RC_UART_SIZE];
+
+//串口环形发送缓存，语音播报、调参应答
+uint8_t Uart1_Tx_Buff[BROADCAST_TX_SIZE];
+uint8_t Uart2_Tx_Buff[TUNE_TX_SIZE];
+
+
+//队列的存储区和控制块，静态分配在CCM
+#define QUEUE_STATIC(port, size, type) \
+    static uint8_t port##_Storage[(size) * sizeof(type)] CCM_RAM; \
+    static StaticQueue_t port##_Buffer CCM_RAM;
+
+QUEUE_STATIC(CAN1_TxPort, CAN1_TxPort_SIZE, CAN_TxMsg)
+QUEUE_STATIC(CAN2_TxPort, CAN2_TxPort_SIZE, CAN_TxMsg)
+QUEUE_STATIC(Tune_Port, Tune_Port_SIZE, Tune_Frame_t)
+
 
 /**
- * @brief 数据池队列初始化
+ * @brief 数据池队列初始化，队列静态分配，不使用堆
  */
 void DataPool_Init(void)
 {
-    CAN1_TxPort = xQueueCreate(CAN1_TxPort_SIZE, sizeof(CAN_TxMsg));
-    CAN2_TxPort = xQueueCreate(CAN2_TxPort_SIZE, sizeof(CAN_TxMsg));
-    UART_TxPort = xQueueCreate(UART_TxPort_SIZE, sizeof(UART_TxMsg));
-    Recieve_ROS_Port = xQueueCreate(Recieve_ROS_Port_SIZE, sizeof(UART_TxMsg));
-    Chassia_Port = xQueueCreate(Chassia_Port_SIZE, sizeof(Robot_Twist_t));
-    Broadcast_Port = xQueueCreate(Broadcast_Port_SIZE, sizeof(Robot_Status_t));
+    CAN1_TxPort = xQueueCreateStatic(CAN1_TxPort_SIZE, sizeof(CAN_TxMsg), CAN1_TxPort_Storage, &CAN1_TxPort_Buffer);
+    CAN2_TxPort = xQueueCreateStatic(CAN2_TxPort_SIZE, sizeof(CAN_TxMsg), CAN2_TxPort_Storage, &CAN2_TxPort_Buffer);
+    Tune_Port = xQueueCreateStatic(Tune_Port_SIZE, sizeof(Tune_Frame_t), Tune_Port_Storage, &Tune_Port_Buffer);
+
+    //注册名字，调试器和任务监视(task_monitor)按名字显示队列
+    vQueueAddToRegistry(CAN1_TxPort, "CAN1_Tx");
+    vQueueAddToRegistry(CAN2_TxPort, "CAN2_Tx");
+    vQueueAddToRegistry(Tune_Port, "Tune");
 }
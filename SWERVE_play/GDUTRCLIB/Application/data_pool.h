@@ -7,44 +7,92 @@
 #include "usart.h"
 
 
-//ROS串口DMA接收缓数组存大小
-#define ROS_UART_SIZE 25
-
-//队列大小
+//放在CCM(0x10000000，64KB)中的变量，见MDK-ARM/stm32f407_ccm.sct。CPU访问无等待，DMA不能访问，
+//只用于任务栈、TCB、队列等，DMA收发缓存不能加这个属性
+#define CCM_RAM __attribute__((section(".ccmram"), zero_init))
+
+//ROS串口循环DMA接收缓存大小，需大于两次读取之间收到的字节数(921600波特率下约92字节/ms)
+#define ROS_UART_SIZE 256
+
+//IMU串口DMA接收缓存数组大小，需大于IMU一次连续发送的字节数
+#define IMU_UART_SIZE 64
+//IMU串口接收缓存块数，空闲中断中切换到另一块，回调解析时DMA不会写入正在解析的缓存
+#define IMU_RX_POOL_NUM 2
+
+//调参串口DMA接收缓存数组大小，也是调参帧的最大长度
+#define TUNE_UART_SIZE 64
+//调参串口接收缓存块数，请求在底盘任务中处理，处理完才归还，最多同时有TUNE_RX_POOL_NUM-1帧等待处理
+#define TUNE_RX_POOL_NUM 3
+
+//串口环形发送缓存大小，需大于DMA发送一批数据期间该串口新排队的字节数，调参串口可容纳两批合并的应答
+#define BROADCAST_TX_SIZE 64
+#define TUNE_TX_SIZE 512
+
+//航模接收机协议，编译时选择：PPM接TIM4_CH1(PB6)，SBUS/iBUS接UART4_RX(PC11)，SBUS需要外部反相电路
+#define RC_PPM  0
+#define RC_SBUS 1
+#define RC_IBUS 2
+#define RC_PROTOCOL RC_PPM
+//PPM捕获缓存，每个上升沿一个计数值，约1个/ms，需大于两次读取之间的边沿数
+#define RC_PPM_BUF_SIZE 64
+//SBUS/iBUS串口循环DMA接收缓存大小，需大于两次读取之间收到的字节数
+#define RC_UART_SIZE 128
+
+//队列大小，队列只用于事件流(每一条都要处理)，设定值、反馈、状态这类只关心最新值的数据用话题(topic.h)
 #define CAN1_TxPort_SIZE 8
 #define CAN2_TxPort_SIZE 8
-#define UART_TxPort_SIZE 4
-#define Recieve_ROS_Port_SIZE 4
-#define Chassia_Port_SIZE 4
-#define Broadcast_Port_SIZE 2
+#define Tune_Port_SIZE 4
 
-//全向轮底盘轮数
-#define USE_FOUR_OMNI_WHEEL 0
-#define USE_THREE_OMNI_WHEEL 0
+//底盘类型，编译时选择。全向轮、麦轮底盘的电机为C620，挂在CAN1，ID为1~N
+#define SWERVE_CHASSIS  0
+#define OMNI3_CHASSIS   1
+#define OMNI4_CHASSIS   2
+#define MECANUM_CHASSIS 3
+#define CHASSIS_TYPE SWERVE_CHASSIS
 
-//舵轮底盘加速度开启
+//舵轮底盘速度规划(加速度、加加速度限制)开启
 #define USE_VEL_ACCEL 1
 
-//使用ROS控制舵轮底盘
-#define USE_ROS_CONTROL 1
+//各速度指令来源的超时时间，us，当前来源超时后下一个控制周期切换到其他来源，没有其他来源时停车
+#define JOY_CMD_TIMEOUT 100000
+#define ROS_CMD_TIMEOUT 100000
+#define AUTO_CMD_TIMEOUT 200000
 
 //使用调试任务
 #define USE_DEBUG_TASK 0
 
+//上行遥测发送频率，Hz，100~1000，受USART3波特率限制
+#define TELEMETRY_RATE 500
+
+//带时间戳的ROS控制帧从上位机发出到收到超过该时间则丢弃，us，对时之后生效
+#define ROS_CMD_AGE_MAX 50000
+
+//调试任务启动时测量fastmath与libm的耗时
+#define USE_FASTMATH_BENCH 0
+
+//调试任务启动时测量查表CRC、硬件CRC与原逐位CRC8每字节的耗时
+#define USE_CRC_BENCH 0
+
+//调试任务中统计各任务CPU占用、栈高水位和队列占用，每TASK_MONITOR_PERIOD毫秒从USART2发送一次，见task_monitor.cpp
+#define USE_TASK_MONITOR 1
+#define TASK_MONITOR_PERIOD 1000
+
 
 #ifdef __cplusplus
 extern "C" {
 #endif 
 
-extern xQueueHandle Port;
 extern xQueueHandle CAN1_TxPort;
 extern xQueueHandle CAN2_TxPort;
-extern xQueueHandle UART_TxPort;
-extern xQueueHandle Recieve_ROS_Port;
-extern xQueueHandle Chassia_Port;
-extern xQueueHandle Broadcast_Port;
+extern xQueueHandle Tune_Port;
 
 extern uint8_t Uart3_Rx_Buff[ROS_UART_SIZE];
+extern uint8_t Uart6_Rx_Buff[IMU_RX_POOL_NUM][IMU_UART_SIZE];
+extern uint8_t Uart2_Rx_Buff[TUNE_RX_POOL_NUM][TUNE_UART_SIZE];
+extern uint8_t Uart1_Tx_Buff[BROADCAST_TX_SIZE];
+extern uint16_t PPM_Capture_Buff[RC_PPM_BUF_SIZE];
+extern uint8_t Uart4_Rx_Buff[RC_UART_SIZE];
+extern uint8_t Uart2_Tx_Buff[TUNE_TX_SIZE];
 
 
 //机器人底盘运动模式
@@ -52,9 +100,19 @@ typedef enum CHASSIS_MODE
 {
 	X_MOVE,
 	Y_MOVE,
-	NORMAL
+	NORMAL,
+	FIELD		//世界坐标系控制，速度指令以场地为参考，需要IMU
 }CHASSIS_MODE;
 
+//速度指令来源，也是添加到Cmd_Mux的顺序。手柄用于人工接管，优先级最高
+typedef enum CMD_SOURCE
+{
+	CMD_SRC_JOY,
+	CMD_SRC_ROS,
+	CMD_SRC_AUTO,		//内部自动程序
+	CMD_SRC_NUM
+}CMD_SOURCE;
+
 typedef enum CHASSIS_STATUS
 {
 	OFF,
@@ -110,6 +168,26 @@ typedef struct Robot_Status_t
 }Robot_Status_t;
 
 
+//底盘里程计，世界坐标系以上电(或Odometry_Reset)时的底盘位置为原点
+typedef struct Chassis_Odom_t
+{
+    float x;            //m
+    float y;            //m
+    float yaw;          //度，IMU在线时使用IMU偏航角，否则积分底盘角速度
+    Robot_Twist_t vel;  //正运动学得到的底盘速度，底盘坐标系
+}Chassis_Odom_t;
+
+
+//一组电机(4个舵向或最多4个轮向)的反馈，CAN接收中断中每收到一帧发布一次，没有的电机为0
+#define MOTOR_GROUP_NUM 4
+typedef struct Motor_Feedback_t
+{
+    float angle[MOTOR_GROUP_NUM];       //度，多圈累加
+    float speed[MOTOR_GROUP_NUM];       //rpm，VESC为eRPM
+    float current[MOTOR_GROUP_NUM];     //A
+}Motor_Feedback_t;
+
+
 
 //CAN发送数据结构体
 typedef struct CAN_TxMsg
@@ -120,13 +198,12 @@ typedef struct CAN_TxMsg
 }CAN_TxMsg;
 
 
-//UART发送数据结构体
-typedef struct UART_TxMsg
+//调参请求帧，指向串口接收缓存中的一整帧，处理完后用Uart_Rx_Release归还缓存
+typedef struct Tune_Frame_t
 {
-    UART_HandleTypeDef *huart;	//串口句柄
-    uint16_t len;				//数据长度
-    void* data_addr;			//数据地址，使用时把地址赋值给这个指针。数据强转为uint8_t
-}UART_TxMsg;
+    uint8_t *buffer;
+    uint16_t len;
+}Tune_Frame_t;
 
 
 //VESC状态参数结构体，来源于VESC驱动源码
@@ -238,8 +315,23 @@ typedef enum {
 }
 CAN_PACKET_ID;
 
+//静态分配的队列占用的RAM，字节，用于service_config.cpp中的预算检查
+#define DATAPOOL_QUEUE_BYTES ((CAN1_TxPort_SIZE + CAN2_TxPort_SIZE)*sizeof(CAN_TxMsg) \
+                            + Tune_Port_SIZE*sizeof(Tune_Frame_t) + 3*sizeof(StaticQueue_t))
+
 void DataPool_Init(void);
 
 #ifdef __cplusplus
 }
 #endif 
+
+#ifdef __cplusplus
+#include "topic.h"
+
+//话题，每个话题只有一个发布方，订阅方用Subscriber读取，见topic.h
+extern Topic<Motor_Feedback_t> Rudder_Feedback;     //"motor.rudder" 舵向电机反馈，CAN1接收中断发布
+extern Topic<Motor_Feedback_t> Wheel_Feedback;      //"motor.wheel" 轮向电机反馈，舵轮底盘为CAN2接收中断、其他底盘为CAN1接收中断发布
+extern Topic<Robot_Twist_t> Chassis_Cmd;            //"chassis.cmd" 底盘本周期执行的速度指令(cmd_mux的选择结果)，底盘任务发布
+extern Topic<Chassis_Odom_t> Chassis_Odom;          //"chassis.odom" 底盘里程计，底盘任务发布
+extern Topic<Robot_Status_t> Robot_Status;          //"robot.status" ROS下发的机器人状态，航模手柄任务发布
+#endif
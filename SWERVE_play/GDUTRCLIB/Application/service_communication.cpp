@@ -1,7 +1,7 @@
 /**
  * @file service_communication.cpp
  * @author Yang Jianyi (2807643517@qq.com)
- * @brief   1) 该文件用于实现通信任务，包括CAN1、CAN2、UART的发送任务。
+ * @brief   1) 该文件用于实现通信任务，包括CAN1、CAN2的发送任务。串口直接调用Uart_Transmit写入发送缓存，由DMA发送，不需要发送任务。
  *          2) 存放定义的CAN1、CAN2、UART的接收回调函数。
  *          3) 整个通讯协议的发送接收均采用freertos的框架实现，使用队列进行数据传输。
  * @version 0.1
@@ -15,7 +15,7 @@
 #include "pid.h"
 #include "motor.h"
 #include "serial_tool.h"
-#include "chassis.h"
+#include "chassis_task.h"
 
 
 void CAN1_Send_Task(void *pvParameters)
@@ -54,23 +54,50 @@ void CAN2_Send_Task(void *pvParameters)
 }
 
 
-void UART_Send_Task(void *pvParameters)
+#if CHASSIS_TYPE == SWERVE_CHASSIS
+//舵向：GM6020电流反馈-16384~16384对应-3~3A；轮向：VESC电流为mA
+static void Rudder_Feedback_Publish(void)
 {
-    UART_TxMsg UART_TxMsg; 
-    for(;;)
+    Motor_Feedback_t fb = {{0}};
+    for(int i=0; i<Chassis_Type::WHEEL_NUM && i<MOTOR_GROUP_NUM; i++)
     {
-        if(xQueueReceive(UART_TxPort, &UART_TxMsg, portMAX_DELAY) == pdTRUE)
-        {
-           HAL_UART_Transmit_DMA(UART_TxMsg.huart, (uint8_t *)UART_TxMsg.data_addr, UART_TxMsg.len);
-        }
-        osDelay(1);
+        fb.angle[i] = chassis.RudderMotor[i].get_angle();
+        fb.speed[i] = chassis.RudderMotor[i].get_speed();
+        fb.current[i] = chassis.RudderMotor[i].get_tarque()*(3.0f/16384.0f);
     }
+    Rudder_Feedback.Publish(fb, Get_SystemTimer());
 }
 
 
-int can_flag=0;
+static void Wheel_Feedback_Publish(void)
+{
+    Motor_Feedback_t fb = {{0}};
+    for(int i=0; i<Chassis_Type::WHEEL_NUM && i<MOTOR_GROUP_NUM; i++)
+    {
+        fb.angle[i] = chassis.WheelMotor[i].get_angle();
+        fb.speed[i] = chassis.WheelMotor[i].get_speed();
+        fb.current[i] = chassis.WheelMotor[i].get_current()*0.001f;
+    }
+    Wheel_Feedback.Publish(fb, Get_SystemTimer());
+}
+#else
+//C620电流反馈-16384~16384对应-20~20A
+static void Wheel_Feedback_Publish(void)
+{
+    Motor_Feedback_t fb = {{0}};
+    for(int i=0; i<Chassis_Type::WHEEL_NUM && i<MOTOR_GROUP_NUM; i++)
+    {
+        fb.angle[i] = chassis.motor[i].get_angle();
+        fb.speed[i] = chassis.motor[i].get_speed();
+        fb.current[i] = chassis.motor[i].get_tarque()*(20.0f/16384.0f);
+    }
+    Wheel_Feedback.Publish(fb, Get_SystemTimer());
+}
+#endif
+
+
 /**
-* @brief  Callback function in CAN Interrupt
+* @brief  Callback function in CAN Interrupt. 电机数据更新后发布反馈话题
 * @param  None.
 * @return None.
 */
@@ -78,34 +105,13 @@ void CAN1_RxCallBack(CAN_RxBuffer *RxBuffer)
 {
     if(RxBuffer->header.IDE==CAN_ID_STD)
     {
-        switch (RxBuffer->header.StdId)
-        {   
-            case 0x205:
-            {
-                RudderMotor[0].update(RxBuffer->data);
-                can_flag++;
-                break;
-            }
-
-            case 0x206:
-            {
-                RudderMotor[1].update(RxBuffer->data);
-                break;
-            }
-
-            case 0x207:
-            {
-                RudderMotor[2].update(RxBuffer->data);
-                break;
-            }
-
-            case 0x208:
-            {
-                RudderMotor[3].update(RxBuffer->data);
-                break;
-            }
-        }
-		
+#if CHASSIS_TYPE == SWERVE_CHASSIS
+        if(chassis.Rudder_Update(RxBuffer->header.StdId, RxBuffer->data))
+            Rudder_Feedback_Publish();
+#else
+        if(chassis.Motor_Update(RxBuffer->header.StdId, RxBuffer->data))
+            Wheel_Feedback_Publish();
+#endif
     }
 }
 
@@ -114,25 +120,42 @@ void CAN2_RxCallBack(CAN_RxBuffer *RxBuffer)
 {
     if(RxBuffer->header.IDE==CAN_ID_EXT)
     {   
-        WheelMotor[0].update_vesc(RxBuffer);
-        WheelMotor[1].update_vesc(RxBuffer);
-        WheelMotor[2].update_vesc(RxBuffer);
-        WheelMotor[3].update_vesc(RxBuffer);
+#if CHASSIS_TYPE == SWERVE_CHASSIS
+        chassis.Wheel_Update(RxBuffer);
+        Wheel_Feedback_Publish();
+#endif
     }
 }
 
 
-//串口DMA接收完毕回调函数，函数名字可以自定义，建议使用消息队列
-uint32_t ROS_UART3_RxCallback(uint8_t* Receive_data, uint16_t data_len)
+//IMU串口接收回调函数，IMU数据帧短，直接在中断中解包
+uint32_t IMU_UART6_RxCallback(uint8_t* Receive_data, uint16_t data_len)
 {
-    UART_TxMsg Msg;
-    if(Recieve_ROS_Port != NULL)
-    {
-        Msg.data_addr = Receive_data;
-        Msg.len = data_len;
-        Msg.huart = &huart1;
-        if(Msg.data_addr != NULL)
-            xQueueSendFromISR(Recieve_ROS_Port, &Msg, 0);
-    }
+    imu.Recieve_From_IMU(Receive_data, data_len);
+    return 0;
+}
+
+
+//串口DMA发送完成回调，USART3上的遥测帧发完后接着发送下一帧，其余串口发送环形缓存中排队的数据
+void HAL_UART_TxCpltCallback(UART_HandleTypeDef *huart)
+{
+    if(huart->Instance == USART3)
+        telemetry.Tx_Complete();
+    else
+        Uart_Tx_Complete(huart);
+}
+
+
+//调参串口接收回调函数，只校验请求帧，缓存交给底盘任务处理后再归还
+uint32_t TUNE_UART2_RxCallback(uint8_t* Receive_data, uint16_t data_len)
+{
+    return tuner.Recieve_From_Host(Receive_data, data_len);
+}
+
+
+//ROS串口空闲中断回调函数，只记录一批数据收完的时刻用于对时，数据在任务中读取
+uint32_t ROS_UART3_IdleCallback(uint8_t* Receive_data, uint16_t data_len)
+{
+    ROS::Rx_Idle_Stamp();
     return 0;
 }
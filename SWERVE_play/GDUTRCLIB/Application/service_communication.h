@@ -11,12 +11,13 @@ extern "C" {
 
 void CAN1_Send_Task(void *pvParameters);
 void CAN2_Send_Task(void *pvParameters);
-void UART_Send_Task(void *pvParameters);
 
 void CAN1_RxCallBack(CAN_RxBuffer *CAN_RxBuffer);	//CAN1接收回调函数
 void CAN2_RxCallBack(CAN_RxBuffer *CAN_RxBuffer);	//CAN2接收回调函数
 
-uint32_t ROS_UART3_RxCallback(uint8_t* Receive_data, uint16_t data_len);    //UART3接收回调函数
+uint32_t IMU_UART6_RxCallback(uint8_t* Receive_data, uint16_t data_len);    //UART6接收回调函数
+uint32_t TUNE_UART2_RxCallback(uint8_t* Receive_data, uint16_t data_len);   //UART2接收回调函数
+uint32_t ROS_UART3_IdleCallback(uint8_t* Receive_data, uint16_t data_len);  //UART3空闲中断回调函数
 
 #ifdef __cplusplus 
 }
@@ -11,7 +11,19 @@
 #include "service_config.h"
 #include "chassis_task.h"
 
-Swerve_Chassis chassis(0.055,0,0.321,4);
+#if CHASSIS_TYPE == SWERVE_CHASSIS
+Swerve4_Chassis chassis(0.055f, 21, 0.321f);
+#elif CHASSIS_TYPE == OMNI3_CHASSIS
+Omni3_Chassis chassis(0.152f/2, 19, Omni_Kinematics<3>(0.641f/2));
+#elif CHASSIS_TYPE == OMNI4_CHASSIS
+Omni4_Chassis chassis(0.152f/2, 19, Omni_Kinematics<4>(0.641f/2));
+#elif CHASSIS_TYPE == MECANUM_CHASSIS
+Mecanum_Chassis chassis(0.076f, 19, Mecanum_Kinematics(0.4f, 0.35f));
+#endif
+
+//任务栈、TCB、队列都静态分配在CCM，总量在编译时检查，链接后的各部分RAM用量见Tools/mem_report.py
+static_assert(TASK_STACK_WORDS*4 + TASK_NUM*sizeof(StaticTask_t) + DATAPOOL_QUEUE_BYTES <= RTOS_CCM_BUDGET,
+              "RTOS objects exceed RTOS_CCM_BUDGET, check the task stacks in service_config.h");
 
 void System_Resource_Init(void)
 {
@@ -24,7 +36,16 @@ void System_Resource_Init(void)
     CAN_Filter_Init(&hcan2,CanFilter_14|CanFifo_0|Can_EXTID|Can_DataType,0,0);
     CAN_Filter_Init(&hcan1,CanFilter_1|CanFifo_1|Can_STDID|Can_DataType,0,0);
     CAN_Filter_Init(&hcan2,CanFilter_15|CanFifo_1|Can_EXTID|Can_DataType,0,0);
-    Uart_Init(&huart3, Uart3_Rx_Buff, 21, ROS_UART3_RxCallback);
+    Uart_Stream_Init(&huart3, Uart3_Rx_Buff, ROS_UART_SIZE, ROS_UART3_IdleCallback);
+    Uart_Init_Pool(&huart6, Uart6_Rx_Buff[0], IMU_UART_SIZE, IMU_RX_POOL_NUM, IMU_UART6_RxCallback);
+    Uart_Init_Pool(&huart2, Uart2_Rx_Buff[0], TUNE_UART_SIZE, TUNE_RX_POOL_NUM, TUNE_UART2_RxCallback);
+    Uart_Tx_Init(&huart1, Uart1_Tx_Buff, BROADCAST_TX_SIZE);
+    Uart_Tx_Init(&huart2, Uart2_Tx_Buff, TUNE_TX_SIZE);
+#if RC_PROTOCOL == RC_PPM
+    air_joy.PPM_Init(&htim4, PPM_Capture_Buff, RC_PPM_BUF_SIZE);
+#else
+    air_joy.Serial_Init(&huart4, &uart4_manager, Uart4_Rx_Buff, RC_UART_SIZE, RC_PROTOCOL);
+#endif
     App_Init();
 }
 
@@ -33,10 +54,13 @@ void App_Init(void)
 {
     Set_PwmDuty(&htim10, TIM_CHANNEL_1, 0);
     Chassis_Pid_Init();
-    PidTimer::getMicroTick_regist(Get_SystemTimer);
-    AirJoy::getMicroTick_regist(Get_SystemTimer);
-    ROS::getMicroTick_regist(Get_SystemTimer);
-    Chassis_Base::getMicroTick_regist(Get_SystemTimer);
-    Broadcast::getMicroTick_regist(Get_SystemTimer);
+    telemetry.Clock_Regist(&host_clock);
+    telemetry.Rate_Set(TELEMETRY_RATE);
+    task_monitor.Queue_Regist(CAN1_TxPort);
+    task_monitor.Queue_Regist(CAN2_TxPort);
+    task_monitor.Queue_Regist(Tune_Port);
+    Trace_Queue_Regist(CAN1_TxPort);
+    Trace_Queue_Regist(CAN2_TxPort);
+    Trace_Queue_Regist(Tune_Port);
 }
 
@@ -12,6 +12,11 @@
 #include "ROS.h"
 #include "air_joy.h"
 #include "Broadcast.h"
+#include "imu.h"
+#include "param_tuner.h"
+#include "telemetry.h"
+#include "task_monitor.h"
+#include "event_trace.h"
 
 
 #define PriorityVeryLow       1
@@ -24,6 +29,22 @@
 #define PriorityRealtime      8
 
 
+//任务栈大小，单位为字(4字节)。任务栈、TCB在freertos.c中静态分配，放在CCM
+//编译为-O0，局部变量不复用，任务切换时还要保存FPU寄存器(约200字节)。修改任务代码后用Tools/task_monitor.py查看
+//各任务的剩余栈(高水位)，剩余少于栈大小的1/4时加大。溢出由configCHECK_FOR_STACK_OVERFLOW检查
+#define CAN1_SEND_STACK       128
+#define CHASSIS_STACK         512       //调参、指令仲裁、底盘控制、遥测打包都在这个任务中
+#define CAN2_SEND_STACK       128
+#define USER_DEBUG_STACK      256       //任务监视、事件跟踪发送，USE_DEBUG_TASK时还有两个PID
+#define AIR_JOY_STACK         256       //ROS帧解析、遥控器解码
+#define BROADCAST_STACK       128
+#define TASK_STACK_WORDS      (CAN1_SEND_STACK + CHASSIS_STACK + CAN2_SEND_STACK + USER_DEBUG_STACK + AIR_JOY_STACK + BROADCAST_STACK)
+#define TASK_NUM              6
+
+//CCM中RTOS对象(任务栈、TCB、队列)的总预算，字节，超出时编译报错。CCM共64KB，留出的部分给以后的任务
+#define RTOS_CCM_BUDGET       (16*1024)
+
+
 #ifdef  __cplusplus
 extern "C"{
 #endif                                  
@@ -10,6 +10,17 @@
 #include "user_debug.h"
 #include "serial_tool.h"
 #include "ROS.h"
+#include "fastmath.h"
+#include "crc.h"
+#include "task_monitor.h"
+#include "event_trace.h"
+
+#if USE_FASTMATH_BENCH
+FastMath_Bench_t fastmath_bench_sincos, fastmath_bench_atan2, fastmath_bench_sqrt;
+#endif
+#if USE_CRC_BENCH
+Crc_Bench_t crc_bench;
+#endif
 
 void User_Debug_Task(void *pvParameters)
 {
@@ -35,11 +46,29 @@ void User_Debug_Task(void *pvParameters)
         PID_Speed.target = PID_Pos.Adjust();
         GM6020.Out = PID_Speed.Adjust();
         RM_Motor_SendMsgs(&hcan1, GM6020);
+#if USE_TASK_MONITOR
+        task_monitor.Poll();
+#endif
+#if USE_EVENT_TRACE
+        Trace_Drain();
+#endif
         osDelay(1);
     }
 #else
+#if USE_FASTMATH_BENCH
+    FastMath_Benchmark(&fastmath_bench_sincos, &fastmath_bench_atan2, &fastmath_bench_sqrt);
+#endif
+#if USE_CRC_BENCH
+    Crc_Benchmark(&crc_bench);
+#endif
     for(;;)
     {
+#if USE_TASK_MONITOR
+        task_monitor.Poll();
+#endif
+#if USE_EVENT_TRACE
+        Trace_Drain();
+#endif
         osDelay(1);
     }
 #endif
@@ -0,0 +1,78 @@
+/**
+ * @file drive_flash.c
+ * @author Yang Jianyi (2807643517@qq.com)
+ * @brief flash底层驱动文件，实现扇区擦除和按字编程。
+ * 		  1)按3.3V供电配置(VoltageRange_3)，每次编程32位；
+ * 		  2)擦除128KB扇区约需1~2s，期间从flash取指的代码会被挂起，不要在机器人运动时调用。
+ * @version 0.1
+ * @date 2024-06-16
+ * 
+ * @copyright Copyright (c) 2024
+ * 
+ */
+
+#include "drive_flash.h"
+
+/* function prototypes -------------------------------------------------------*/
+/**
+* @brief  Erase one flash sector.
+* @param  sector : FLASH_SECTOR_x.
+* @retval HAL status.
+*/
+HAL_StatusTypeDef Flash_Erase_Sector(uint32_t sector)
+{
+	FLASH_EraseInitTypeDef erase;
+	uint32_t sector_error = 0;
+	HAL_StatusTypeDef status;
+
+	erase.TypeErase = FLASH_TYPEERASE_SECTORS;
+	erase.Banks = FLASH_BANK_1;
+	erase.Sector = sector;
+	erase.NbSectors = 1;
+	erase.VoltageRange = FLASH_VOLTAGE_RANGE_3;
+
+	HAL_FLASH_Unlock();
+	__HAL_FLASH_CLEAR_FLAG(FLASH_FLAG_EOP | FLASH_FLAG_OPERR | FLASH_FLAG_WRPERR |
+	                       FLASH_FLAG_PGAERR | FLASH_FLAG_PGPERR | FLASH_FLAG_PGSERR);
+	status = HAL_FLASHEx_Erase(&erase, &sector_error);
+	HAL_FLASH_Lock();
+
+	return status;
+}
+
+
+/**
+* @brief  Program words to flash. The area must have been erased.
+* @param  addr : Word aligned flash address.
+* @param  data : Data to program.
+* @param  num : Number of words.
+* @retval HAL status. Stop at the first word that fails or reads back wrong.
+*/
+HAL_StatusTypeDef Flash_Write_Words(uint32_t addr, const uint32_t *data, uint32_t num)
+{
+	HAL_StatusTypeDef status = HAL_OK;
+
+	HAL_FLASH_Unlock();
+	__HAL_FLASH_CLEAR_FLAG(FLASH_FLAG_EOP | FLASH_FLAG_OPERR | FLASH_FLAG_WRPERR |
+	                       FLASH_FLAG_PGAERR | FLASH_FLAG_PGPERR | FLASH_FLAG_PGSERR);
+	for(uint32_t i = 0; i < num; i++)
+	{
+		status = HAL_FLASH_Program(FLASH_TYPEPROGRAM_WORD, addr + i*4, data[i]);
+		if(status == HAL_OK && *(volatile uint32_t *)(addr + i*4) != data[i])
+			status = HAL_ERROR;
+		if(status != HAL_OK)
+			break;
+	}
+	HAL_FLASH_Lock();
+
+	return status;
+}
+
+
+/**
+* @brief  Program a single word.
+*/
+HAL_StatusTypeDef Flash_Write_Word(uint32_t addr, uint32_t data)
+{
+	return Flash_Write_Words(addr, &data, 1);
+}
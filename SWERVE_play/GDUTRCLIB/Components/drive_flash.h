@@ -0,0 +1,27 @@
+#ifndef DRIVE_FLASH_H
+#define DRIVE_FLASH_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif  
+
+#include "stm32f4xx_hal.h"
+
+/* Exported macros -----------------------------------------------------------*/
+//STM32F407ZG 1MB flash，最后两个128KB扇区保留给参数存储，工程的IROM大小相应改为0xC0000
+#define FLASH_PARAM_SECTOR_A        FLASH_SECTOR_10
+#define FLASH_PARAM_SECTOR_B        FLASH_SECTOR_11
+#define FLASH_PARAM_ADDR_A          0x080C0000U
+#define FLASH_PARAM_ADDR_B          0x080E0000U
+#define FLASH_PARAM_SECTOR_SIZE     0x20000U
+
+/* Exported function declarations --------------------------------------------*/
+HAL_StatusTypeDef Flash_Erase_Sector(uint32_t sector);
+HAL_StatusTypeDef Flash_Write_Words(uint32_t addr, const uint32_t *data, uint32_t num);
+HAL_StatusTypeDef Flash_Write_Word(uint32_t addr, uint32_t data);
+
+#ifdef __cplusplus
+}
+#endif 
+
+#endif //  DRIVE_FLASH_H
@@ -2,7 +2,10 @@
  * @file drive_tim.c
  * @author Yang Jianyi (2807643517@qq.com)
  * @brief 1)tim底层驱动文件，用于实现定时器的初始化和延时函数。一般不使用阻塞式延时。
- * 		  2)需要获取当前时间时，可以使用Get_SystemTimer()函数。Get_SystemTimer()在类中的使用可以参考PID类(PID.cpp)或者ROS的通讯类(ROS.cpp)
+ * 		  2)需要获取当前时间时，包含sys_clock.h后调用Get_SystemTimer()/Get_SystemTimer64()，接口说明见sys_clock.h。
+ * 		    us时间 = 溢出次数 * 0x10000 + CNT(定时器1MHz计数，ARR为0xFFFF)。读取时先读溢出次数再读CNT，溢出次数在这期间变化则重读；
+ * 		    在与TIM4同优先级或更高优先级的中断中、或者关中断时调用，溢出中断还没执行，这时看更新标志，标志已置位且CNT较小说明已经溢出，
+ * 		    溢出次数按加1计算，因此关中断不超过半个溢出周期(约32ms)时时间不会回退。
  * @version 0.1
  * @date 2024-03-30
  * 
@@ -13,6 +16,7 @@
 #include "drive_tim.h"
 
 volatile uint32_t SystemTimerCnt;
+static Clock_Source_Fun clock_source = NULL;
 
 struct timer_manager_t
 {
@@ -37,6 +41,12 @@ void Timer_Init(TIM_HandleTypeDef* htim, EDelay_src src)
 	
 	Timer_Manager.htim_x = htim;
 	Timer_Manager.delay_ms_src = src;
+
+#if SYSTEM_TIMER_USE_DWT
+	CoreDebug->DEMCR |= CoreDebug_DEMCR_TRCENA_Msk;
+	DWT->CYCCNT = 0;
+	DWT->CTRL |= DWT_CTRL_CYCCNTENA_Msk;
+#endif
     
   	if(HAL_TIM_Base_Start_IT(Timer_Manager.htim_x)!=HAL_OK)
       	Error_Handler();
@@ -46,13 +56,70 @@ void Timer_Init(TIM_HandleTypeDef* htim, EDelay_src src)
 
 
 /**
-* @brief  Get the system tick from timer.
+* @brief  Get the system time from timer, monotonic and consistent with the overflow interrupt.
+* @param  None
+* @retval current time, us.
+*/
+uint64_t Get_SystemTimer64(void)
+{
+	uint32_t high, cnt, pending;
+	TIM_TypeDef *tim;
+
+	if(clock_source != NULL)
+		return clock_source();
+	if(Timer_Manager.htim_x == NULL)
+		return 0;
+
+	tim = Timer_Manager.htim_x->Instance;
+	do
+	{
+		high = SystemTimerCnt;
+		cnt = tim->CNT;
+		pending = tim->SR & TIM_SR_UIF;
+	}while(high != SystemTimerCnt);
+
+	//溢出中断还没有执行(被屏蔽或同优先级)，CNT较小说明是溢出之后读到的
+	if(pending && cnt < 0x8000)
+		high++;
+
+	return ((uint64_t)high << 16) | cnt;
+}
+
+
+/**
+* @brief  Low 32 bits of Get_SystemTimer64(), wraps every 71 minutes.
 * @param  None
-* @retval current tick.
+* @retval current time, us.
 */
 uint32_t Get_SystemTimer(void)
 {
-	return Timer_Manager.htim_x->Instance->CNT + SystemTimerCnt * 0xffff;
+	return (uint32_t)Get_SystemTimer64();
+}
+
+
+/**
+* @brief  Get the core cycle counter (DWT), for short intervals.
+* @param  None
+* @retval current cycle count.
+*/
+uint32_t Get_CycleCount(void)
+{
+#if SYSTEM_TIMER_USE_DWT
+	if(clock_source == NULL)
+		return DWT->CYCCNT;
+#endif
+	return (uint32_t)(Get_SystemTimer64() * SYSTEM_CYCLES_PER_US);
+}
+
+
+/**
+* @brief  Replace the clock source, for offline tests and simulation.
+* @param  source : returns time in us, NULL restores the hardware timer.
+* @retval None
+*/
+void SystemTimer_Source_Set(Clock_Source_Fun source)
+{
+	clock_source = source;
 }
 
 
@@ -127,7 +194,7 @@ void Set_PwmFreq(TIM_HandleTypeDef* htim, uint32_t freq)
 */
 void delay_us_nos(uint32_t cnt)
 {
-	uint32_t temp = cnt  + microsecond();
+	uint64_t temp = cnt  + microsecond();
 
 	while(temp >= microsecond());
 }
@@ -142,7 +209,7 @@ void delay_ms_nos(uint32_t cnt)
 {
 	if(Timer_Manager.htim_x != NULL && Timer_Manager.delay_ms_src == USE_MODULE_DELAY)
 	{
-		uint32_t temp = cnt * 1000 + microsecond();
+		uint64_t temp = (uint64_t)cnt * 1000 + microsecond();
 		while(temp >= microsecond());
 	}
 	else
@@ -7,9 +7,10 @@ extern "C" {
 
 #include "stm32f4xx_hal.h"
 #include "tim.h"
+#include "sys_clock.h"
 
 /* Private macros ------------------------------------------------------------*/
-#define microsecond()    Get_SystemTimer()
+#define microsecond()    Get_SystemTimer64()
 
 /* Private type --------------------------------------------------------------*/
 typedef struct{
@@ -33,7 +34,6 @@ void Update_SystemTick(void);
 void PWM_ReInit(uint16_t period, uint16_t prescaler, TIM_HandleTypeDef* htim, uint32_t channel);
 void Set_PwmDuty(TIM_HandleTypeDef* htim, uint32_t channel, uint16_t duty);
 void Set_PwmFreq(TIM_HandleTypeDef* htim, uint32_t freq);
-uint32_t Get_SystemTimer(void);
 void delay_ms_nos(uint32_t cnt);
 void delay_us_nos(uint32_t cnt);
 
@@ -10,9 +10,20 @@
  *        倒数第四位:crc8校验位: 1字节
  *        末尾两位:包尾: 0x0D 0x0A
  *        示例可查阅ROS.cpp文件
+ *        4)连续数据流(如ROS串口)可以用Uart_Stream_Init改为循环DMA接收，
+ *          由任务周期调用Uart_Stream_Peek/Uart_Stream_Consume读取，帧的拆分、拼接由上层解析(Frame_Parser)处理。
+ *          对应的DMA需要在cubeMX中配置为Circular模式。传入回调时打开空闲中断，回调只用于记录一段数据收完的时刻(如对时)，
+ *          参数为缓存和DMA当前的写位置，不能在回调中读取数据。
+ *        5)空闲中断接收可以用Uart_Init_Pool使用多块缓存轮流接收：空闲中断中先把DMA切换到一块空闲缓存，
+ *          再把收完的缓存交给回调，回调直接解析DMA缓存，不需要拷贝；回调返回1表示缓存留给任务处理，
+ *          处理完调用Uart_Rx_Release归还。没有空闲缓存时丢弃本帧并计入rx_dropped，不会覆盖正在处理的数据。
+ *        6)发送：Uart_Tx_Init为串口指定一块环形发送缓存，Uart_Transmit把数据拷贝进缓存后立即返回(任务和中断中都可调用)，
+ *          调用者的缓存可以马上重用。DMA空闲时立即发送，忙时新数据在缓存中排队，上一次DMA发送完成后(HAL_UART_TxCpltCallback中
+ *          调用Uart_Tx_Complete)把排队的所有数据合并为一次DMA发送，缓存回绕时分两次。缓存满时整条丢弃并计入tx_dropped。
+ *          各串口的发送互相独立，可以同时进行。
  * 
  * 注意：使用该文件需要在stm32f4xx_it.c中的串口中断服务函数中添加中断接收函数，例如:Uart_Receive_Handler(&usart1_manager);
- *        该文件中包含了串口1、串口2、串口3、串口6的回调函数，如有需要，可自行添加其他串口
+ *        该文件中包含了串口1、串口2、串口3、串口4、串口6的回调函数，如有需要，可自行添加其他串口
  * @version 0.1
  * @date 2024-04-03
  * 
@@ -21,65 +32,84 @@
  */
 
 #include "drive_uart.h"
+#include <string.h>
+#include "crc.h"
 
 usart_manager_t usart1_manager = {.call_back_fun = NULL};
 usart_manager_t usart2_manager = {.call_back_fun = NULL};
 usart_manager_t usart3_manager = {.call_back_fun = NULL};
+usart_manager_t uart4_manager = {.call_back_fun = NULL};
 usart_manager_t usart6_manager = {.call_back_fun = NULL}; 
 
 
 static void Uart_Rx_Idle_Callback(usart_manager_t *manager);
+static usart_manager_t *Uart_Manager_Get(UART_HandleTypeDef *huart);
+static void Uart_Tx_Start(usart_manager_t *manager);
 
 void Uart_Init(UART_HandleTypeDef *huart, uint8_t *Rxbuffer, uint16_t len, usart_call_back call_back_fun)
 {
-    if(huart == NULL)
-        Error_Handler();
-    else{}
+    Uart_Init_Pool(huart, Rxbuffer, len, 1, call_back_fun);
+}
 
-    if(huart->Instance == USART1)
-    {
-        usart1_manager.uart_handle = huart;
-        usart1_manager.rx_buffer = Rxbuffer;
-        usart1_manager.rx_buffer_size = len;
-        usart1_manager.call_back_fun = call_back_fun;
-        __HAL_UART_CLEAR_IDLEFLAG(huart);
-		__HAL_UART_ENABLE_IT(huart, UART_IT_IDLE);
-		HAL_UART_Receive_DMA(huart, Rxbuffer, len);
-    }
-    else if(huart->Instance == USART2)
-    {
-        usart2_manager.uart_handle = huart;
-        usart2_manager.rx_buffer = Rxbuffer;
-        usart2_manager.rx_buffer_size = len;
-        usart2_manager.call_back_fun = call_back_fun;
-        __HAL_UART_CLEAR_IDLEFLAG(huart);
-		__HAL_UART_ENABLE_IT(huart, UART_IT_IDLE);
-		HAL_UART_Receive_DMA(huart, Rxbuffer, len);
-    }
-    else if(huart->Instance == USART3)
-    {
-        usart3_manager.uart_handle = huart;
-        usart3_manager.rx_buffer = Rxbuffer;
-        usart3_manager.rx_buffer_size = len;
-        usart3_manager.call_back_fun = call_back_fun;
-        __HAL_UART_CLEAR_IDLEFLAG(huart);
-		__HAL_UART_ENABLE_IT(huart, UART_IT_IDLE);
-		HAL_UART_Receive_DMA(huart, Rxbuffer, len);
-    }
-    else if(huart->Instance == USART6)
-    {
-        usart6_manager.uart_handle = huart;
-        usart6_manager.rx_buffer = Rxbuffer;
-        usart6_manager.rx_buffer_size = len;
-        usart6_manager.call_back_fun = call_back_fun;
-        __HAL_UART_CLEAR_IDLEFLAG(huart);
-		__HAL_UART_ENABLE_IT(huart, UART_IT_IDLE);
-		HAL_UART_Receive_DMA(huart, Rxbuffer, len);
-    }
-    else
+
+/**
+ * @brief   Initialize idle-line reception with a pool of buffers
+ * @note    On idle, DMA is re-armed into a free buffer before the callback runs, so the callback
+ *          parses a buffer DMA no longer writes (no copy, no torn frame). A callback returning 1 keeps
+ *          the buffer until Uart_Rx_Release(). When no buffer is free the frame is dropped and counted.
+ *          With num = 1 the callback runs before re-arming and must return 0.
+ * @param   huart: serial port handle
+ * @param   Rxbuffer: num contiguous buffers of len bytes
+ * @param   len: size of one buffer
+ * @param   num: number of buffers, 1 ~ UART_RX_POOL_MAX
+ * @param   call_back_fun: user callback function
+ * @retval  None
+ */
+void Uart_Init_Pool(UART_HandleTypeDef *huart, uint8_t *Rxbuffer, uint16_t len, uint8_t num, usart_call_back call_back_fun)
+{
+    usart_manager_t *manager = Uart_Manager_Get(huart);
+    if(manager == NULL || Rxbuffer == NULL || num == 0 || num > UART_RX_POOL_MAX)
     {
         Error_Handler();
+        return;
     }
+
+    manager->uart_handle = huart;
+    manager->rx_pool = Rxbuffer;
+    manager->rx_pool_num = num;
+    manager->rx_active = 0;
+    manager->rx_free = (uint8_t)(((1U << num) - 1) & ~1U);
+    manager->rx_dropped = 0;
+    manager->rx_buffer = Rxbuffer;
+    manager->rx_buffer_size = len;
+    manager->call_back_fun = call_back_fun;
+    manager->stream_mode = 0;
+    __HAL_UART_CLEAR_IDLEFLAG(huart);
+	__HAL_UART_ENABLE_IT(huart, UART_IT_IDLE);
+	HAL_UART_Receive_DMA(huart, Rxbuffer, len);
+}
+
+
+/**
+ * @brief   Return a buffer kept by the callback to the driver
+ * @param   huart: serial port handle
+ * @param   buf: buffer passed to the callback
+ * @retval  None
+ */
+void Uart_Rx_Release(UART_HandleTypeDef *huart, uint8_t *buf)
+{
+    usart_manager_t *manager = Uart_Manager_Get(huart);
+    if(manager == NULL || manager->rx_pool == NULL || buf < manager->rx_pool)
+        return;
+
+    uint32_t index = (uint32_t)(buf - manager->rx_pool) / manager->rx_buffer_size;
+    if(index >= manager->rx_pool_num)
+        return;
+
+    uint32_t primask = __get_PRIMASK();
+    __disable_irq();
+    manager->rx_free |= (uint8_t)(1U << index);
+    __set_PRIMASK(primask);
 }
 
 
@@ -107,6 +137,21 @@ void Usart_Rx_Callback_Register(usart_manager_t *manager, usart_call_back fun)
  */
 void Uart_Receive_Handler(usart_manager_t *manager)
 {
+	if(manager->uart_handle == NULL)
+		return;
+
+	if(manager->stream_mode)
+	{
+		if(__HAL_UART_GET_FLAG(manager->uart_handle,UART_FLAG_IDLE)!=RESET)
+		{
+			__HAL_UART_CLEAR_IDLEFLAG(manager->uart_handle);
+			if(manager->call_back_fun != NULL)
+				manager->call_back_fun(manager->rx_buffer,
+					manager->rx_buffer_size - ((DMA_Stream_TypeDef*)manager->uart_handle->hdmarx->Instance)->NDTR);
+		}
+		return;
+	}
+
 	if(__HAL_UART_GET_FLAG(manager->uart_handle,UART_FLAG_IDLE)!=RESET)
 	{
 		Uart_Rx_Idle_Callback(manager);
@@ -126,44 +171,289 @@ static void Uart_Rx_Idle_Callback(usart_manager_t *manager)
 	assert_param(manager != NULL);
 	
     /* Private variables */
-	static uint16_t usart_rx_num;
+	uint16_t usart_rx_num;
+	uint8_t *done;
 
     /* clear idle it flag avoid idle interrupt all the time */
 	__HAL_UART_CLEAR_IDLEFLAG(manager->uart_handle);
 
-    /* clear DMA transfer complete flag */
-	HAL_UART_DMAStop(manager->uart_handle);
+    /* stop rx DMA only, tx DMA (telemetry) keeps running */
+	HAL_UART_AbortReceive(manager->uart_handle);
 
-    /* handle received data in idle interrupt */
 	usart_rx_num = manager->rx_buffer_size - ((DMA_Stream_TypeDef*)manager->uart_handle->hdmarx->Instance)->NDTR;
-	if(manager->call_back_fun != NULL)
-		manager->call_back_fun(manager->rx_buffer, usart_rx_num);
-	
+	done = manager->rx_buffer;
+
+    /* single buffer: handle received data in idle interrupt, then re-arm the same buffer */
+	if(manager->rx_pool_num <= 1)
+	{
+		if(manager->call_back_fun != NULL && usart_rx_num > 0)
+			manager->call_back_fun(done, usart_rx_num);
+		HAL_UART_Receive_DMA(manager->uart_handle, done, manager->rx_buffer_size);
+		return;
+	}
+
+    /* buffer pool: re-arm into a free buffer first, then hand the received one to the callback */
+	if(usart_rx_num == 0 || manager->rx_free == 0)
+	{
+		if(usart_rx_num > 0)
+			manager->rx_dropped++;
+		HAL_UART_Receive_DMA(manager->uart_handle, done, manager->rx_buffer_size);
+		return;
+	}
+
+	uint8_t last = manager->rx_active;
+	uint8_t next = 0;
+	while((manager->rx_free & (1U << next)) == 0)
+		next++;
+	manager->rx_free &= (uint8_t)~(1U << next);
+	manager->rx_active = next;
+	manager->rx_buffer = manager->rx_pool + next*manager->rx_buffer_size;
 	HAL_UART_Receive_DMA(manager->uart_handle, manager->rx_buffer, manager->rx_buffer_size);
+
+	if(manager->call_back_fun == NULL || manager->call_back_fun(done, usart_rx_num) == 0)
+		manager->rx_free |= (uint8_t)(1U << last);
+}
+
+
+/**
+ * @brief   Start circular DMA reception
+ * @param   huart: serial port handle, its rx DMA must be in circular mode
+ * @param   Rxbuffer: circular buffer
+ * @param   len: buffer size, must hold the bytes received between two reads
+ * @param   idle_fun: NULL: no idle interrupt; else called in the idle interrupt with the DMA write position,
+ *          only to timestamp the end of a burst, the data is read by Uart_Stream_Peek()
+ * @retval  None
+ */
+void Uart_Stream_Init(UART_HandleTypeDef *huart, uint8_t *Rxbuffer, uint16_t len, usart_call_back idle_fun)
+{
+    usart_manager_t *manager = Uart_Manager_Get(huart);
+    if(manager == NULL)
+    {
+        Error_Handler();
+        return;
+    }
+
+    manager->uart_handle = huart;
+    manager->rx_buffer = Rxbuffer;
+    manager->rx_buffer_size = len;
+    manager->call_back_fun = idle_fun;
+    manager->rx_pool = NULL;
+    manager->rx_pool_num = 0;
+    manager->stream_mode = 1;
+    manager->rx_read = 0;
+    __HAL_UART_CLEAR_IDLEFLAG(huart);
+    if(idle_fun != NULL)
+        __HAL_UART_ENABLE_IT(huart, UART_IT_IDLE);
+    else
+        __HAL_UART_DISABLE_IT(huart, UART_IT_IDLE);
+    HAL_UART_Receive_DMA(huart, Rxbuffer, len);
+}
+
+
+/**
+ * @brief   Get the unread bytes of a circular buffer
+ * @param   manager: serial port handle
+ * @param   data: return the first unread byte
+ * @retval  number of contiguous unread bytes, call again after Uart_Stream_Consume() for the wrapped part
+ */
+uint16_t Uart_Stream_Peek(usart_manager_t *manager, const uint8_t **data)
+{
+    uint16_t write = manager->rx_buffer_size - ((DMA_Stream_TypeDef*)manager->uart_handle->hdmarx->Instance)->NDTR;
+    if(write >= manager->rx_buffer_size)
+        write = 0;
+
+    *data = manager->rx_buffer + manager->rx_read;
+    if(write >= manager->rx_read)
+        return write - manager->rx_read;
+    else
+        return manager->rx_buffer_size - manager->rx_read;
+}
+
+
+/**
+ * @brief   Mark bytes returned by Uart_Stream_Peek() as read
+ */
+void Uart_Stream_Consume(usart_manager_t *manager, uint16_t len)
+{
+    manager->rx_read = (manager->rx_read + len) % manager->rx_buffer_size;
+}
+
+
+/**
+ * @brief   Give a port a transmit ring for Uart_Transmit()
+ * @param   huart: serial port handle, its tx DMA must be in normal mode
+ * @param   Txbuffer: ring buffer, holds len-1 bytes of pending data
+ * @param   len: ring size
+ * @retval  None
+ */
+void Uart_Tx_Init(UART_HandleTypeDef *huart, uint8_t *Txbuffer, uint16_t len)
+{
+    usart_manager_t *manager = Uart_Manager_Get(huart);
+    if(manager == NULL || Txbuffer == NULL || len < 2)
+    {
+        Error_Handler();
+        return;
+    }
+
+    manager->uart_handle = huart;
+    manager->tx_size = len;
+    manager->tx_head = 0;
+    manager->tx_tail = 0;
+    manager->tx_burst = 0;
+    manager->tx_bytes = 0;
+    manager->tx_bursts = 0;
+    manager->tx_dropped = 0;
+    manager->tx_ring = Txbuffer;
+}
+
+
+/**
+ * @brief   Copy a message into the transmit ring and start DMA if the port is idle
+ * @note    Can be called from tasks and interrupts. The message is queued whole or not at all.
+ * @param   huart: serial port handle, initialized by Uart_Tx_Init()
+ * @param   data: message, can be reused as soon as this function returns
+ * @param   len: message length
+ * @retval  1: queued, 0: ring full or port not initialized, message dropped
+ */
+uint8_t Uart_Transmit(UART_HandleTypeDef *huart, const uint8_t *data, uint16_t len)
+{
+    usart_manager_t *manager = Uart_Manager_Get(huart);
+    if(manager == NULL || manager->tx_ring == NULL || data == NULL || len == 0)
+        return 0;
+
+    uint32_t primask = __get_PRIMASK();
+    __disable_irq();
+
+    uint16_t head = manager->tx_head;
+    uint16_t used = (head + manager->tx_size - manager->tx_tail) % manager->tx_size;
+    if(len > manager->tx_size - 1 - used)
+    {
+        manager->tx_dropped++;
+        __set_PRIMASK(primask);
+        return 0;
+    }
+
+    uint16_t first = manager->tx_size - head;
+    if(first > len)
+        first = len;
+    memcpy(manager->tx_ring + head, data, first);
+    memcpy(manager->tx_ring, data + first, len - first);
+    manager->tx_head = (head + len) % manager->tx_size;
+
+    if(manager->tx_burst == 0)
+        Uart_Tx_Start(manager);
+    __set_PRIMASK(primask);
+    return 1;
 }
 
 
 /**
- * @brief 校验位函数Crc8
+ * @brief   Free space in the transmit ring, for senders that would rather wait than drop a message
+ * @param   huart: serial port handle
+ * @retval  bytes that Uart_Transmit() can queue now, 0 if the port has no transmit ring
+ */
+uint16_t Uart_Tx_Space(UART_HandleTypeDef *huart)
+{
+    usart_manager_t *manager = Uart_Manager_Get(huart);
+    if(manager == NULL || manager->tx_ring == NULL)
+        return 0;
+
+    uint16_t used = (manager->tx_head + manager->tx_size - manager->tx_tail) % manager->tx_size;
+    return manager->tx_size - 1 - used;
+}
+
+
+/**
+ * @brief   Release the finished burst and send everything queued meanwhile,
+ *          call in HAL_UART_TxCpltCallback
+ * @param   huart: serial port handle
+ * @retval  None
+ */
+void Uart_Tx_Complete(UART_HandleTypeDef *huart)
+{
+    usart_manager_t *manager = Uart_Manager_Get(huart);
+    if(manager == NULL || manager->tx_ring == NULL || manager->tx_burst == 0)
+        return;
+
+    uint32_t primask = __get_PRIMASK();
+    __disable_irq();
+    manager->tx_tail = (manager->tx_tail + manager->tx_burst) % manager->tx_size;
+    manager->tx_burst = 0;
+    Uart_Tx_Start(manager);
+    __set_PRIMASK(primask);
+}
+
+
+/**
+ * @brief   Start one DMA burst with all contiguous pending bytes, called with interrupts disabled
+ */
+static void Uart_Tx_Start(usart_manager_t *manager)
+{
+    uint16_t head = manager->tx_head;
+    uint16_t tail = manager->tx_tail;
+    if(head == tail)
+        return;
+
+    uint16_t len = (head > tail) ? (head - tail) : (manager->tx_size - tail);
+    if(HAL_UART_Transmit_DMA(manager->uart_handle, manager->tx_ring + tail, len) == HAL_OK)
+    {
+        manager->tx_burst = len;
+        manager->tx_bytes += len;
+        manager->tx_bursts++;
+    }
+}
+
+
+/**
+ * @brief   HAL aborts rx DMA on overrun/framing errors, restart reception here.
+ *          A tx DMA error ends the burst, the bytes are given up and the rest of the ring is sent.
+ */
+void HAL_UART_ErrorCallback(UART_HandleTypeDef *huart)
+{
+    usart_manager_t *manager = Uart_Manager_Get(huart);
+    if(manager == NULL)
+        return;
+
+    if(manager->tx_ring != NULL && manager->tx_burst != 0 && huart->gState == HAL_UART_STATE_READY)
+        Uart_Tx_Complete(huart);
+
+    if(manager->rx_buffer == NULL)
+        return;
+
+    if(huart->RxState == HAL_UART_STATE_READY)
+    {
+        manager->rx_read = 0;
+        HAL_UART_Receive_DMA(huart, manager->rx_buffer, manager->rx_buffer_size);
+    }
+}
+
+
+static usart_manager_t *Uart_Manager_Get(UART_HandleTypeDef *huart)
+{
+    if(huart == NULL)
+        return NULL;
+    if(huart->Instance == USART1)
+        return &usart1_manager;
+    if(huart->Instance == USART2)
+        return &usart2_manager;
+    if(huart->Instance == USART3)
+        return &usart3_manager;
+    if(huart->Instance == UART4)
+        return &uart4_manager;
+    if(huart->Instance == USART6)
+        return &usart6_manager;
+    return NULL;
+}
+
+
+/**
+ * @brief 校验位函数Crc8，查表计算，结果与原逐位计算相同
  * @param 传入数组
  * @param 当前数组长度
  * @return 检验值
 */
 unsigned char serial_get_crc8_value(unsigned char *tem_array, unsigned char len)
 {
-    unsigned char crc = 0;
-    unsigned char i;
-    while(len--)
-    {
-        crc ^= *tem_array++;
-        for(i = 0; i < 8; i++)
-        {
-            if(crc&0x01)
-                crc=(crc>>1)^0x8C;
-            else
-                crc >>= 1;
-        }
-    }
-    return crc;
+    return Crc8_Update(CRC8_INIT, tem_array, len);
 }
 
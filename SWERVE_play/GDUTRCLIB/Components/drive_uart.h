@@ -8,8 +8,12 @@ extern "C" {
 #endif 
 
 // define the uart call back function
+// return 0: buffer is released when the callback returns
+// return 1: the callback keeps the buffer, call Uart_Rx_Release() after parsing (buffer pool only)
 typedef uint32_t (*usart_call_back)(uint8_t *buf, uint16_t len);
 
+#define UART_RX_POOL_MAX 4
+
 /** 
 * @brief define the uart struct
 */
@@ -19,18 +23,43 @@ typedef struct
     uint16_t rx_buffer_size;
     uint8_t *rx_buffer;
     usart_call_back call_back_fun;
+    uint8_t *rx_pool;           /*!< rx_pool_num buffers of rx_buffer_size bytes */
+    uint8_t rx_pool_num;
+    uint8_t rx_active;          /*!< index of the buffer DMA is writing */
+    volatile uint8_t rx_free;   /*!< bit i set: buffer i is owned by the driver and not armed */
+    uint32_t rx_dropped;        /*!< frames dropped because every other buffer was held by the consumer */
+    uint8_t stream_mode;        /*!< 1: circular DMA, read by Uart_Stream_Peek()/Uart_Stream_Consume() */
+    uint16_t rx_read;           /*!< read index of the circular buffer */
+    uint8_t *tx_ring;           /*!< transmit ring, NULL: Uart_Transmit() is not used on this port */
+    uint16_t tx_size;
+    volatile uint16_t tx_head;  /*!< write index */
+    volatile uint16_t tx_tail;  /*!< first byte not yet sent */
+    volatile uint16_t tx_burst; /*!< bytes in the running DMA burst, 0: idle */
+    uint32_t tx_bytes;          /*!< bytes handed to DMA */
+    uint32_t tx_bursts;
+    uint32_t tx_dropped;        /*!< messages dropped because the ring was full */
 }usart_manager_t;
 
 
 extern usart_manager_t usart1_manager;
 extern usart_manager_t usart2_manager;
 extern usart_manager_t usart3_manager;
+extern usart_manager_t uart4_manager;
 extern usart_manager_t usart6_manager;
 
 
 void Uart_Init(UART_HandleTypeDef *huart, uint8_t *Rxbuffer, uint16_t len, usart_call_back call_back_fun);
+void Uart_Init_Pool(UART_HandleTypeDef *huart, uint8_t *Rxbuffer, uint16_t len, uint8_t num, usart_call_back call_back_fun);
+void Uart_Rx_Release(UART_HandleTypeDef *huart, uint8_t *buf);
 void Usart_Rx_Callback_Register(usart_manager_t *manager, usart_call_back fun);
 void Uart_Receive_Handler(usart_manager_t *manager);
+void Uart_Stream_Init(UART_HandleTypeDef *huart, uint8_t *Rxbuffer, uint16_t len, usart_call_back idle_fun);
+uint16_t Uart_Stream_Peek(usart_manager_t *manager, const uint8_t **data);
+void Uart_Stream_Consume(usart_manager_t *manager, uint16_t len);
+void Uart_Tx_Init(UART_HandleTypeDef *huart, uint8_t *Txbuffer, uint16_t len);
+uint8_t Uart_Transmit(UART_HandleTypeDef *huart, const uint8_t *data, uint16_t len);
+uint16_t Uart_Tx_Space(UART_HandleTypeDef *huart);
+void Uart_Tx_Complete(UART_HandleTypeDef *huart);
 
 unsigned char serial_get_crc8_value(unsigned char *tem_array, unsigned char len);
 
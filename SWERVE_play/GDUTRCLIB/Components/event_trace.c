@@ -0,0 +1,239 @@
+/**
+ * @file event_trace.c
+ * @author Yang JianYi
+ * @brief 事件跟踪的记录和发送，说明见event_trace.h。
+ *        快照从USART2发送，帧格式与调参相同：0x55 0xAA + 数据长度 + 数据 + crc8 + 0x0D 0x0A，数据区(小端)：
+ *        [0] 0x30 快照开始   [1:5] uint32 第一条记录的序号   [5:7] uint16 记录条数   [7:9] uint16 每us的周期数
+ *        [0] 0x31 名字表     [1] 0任务/1队列   [2] 个数k，之后k个，每个9字节：编号、名字(8字节，不足补0)
+ *        [0] 0x32 记录       [1] 条数n         [2:6] uint32 本帧第一条的序号，之后n条记录，每条8字节(Trace_Event_t)
+ *        一次快照依次发送0x30、两个0x31、若干0x32。每ms最多发送一帧，串口发送缓存不够时等下一次。
+ * @version 0.1
+ * @date 2024-06-30
+ *
+ * @copyright Copyright (c) 2024
+ *
+ */
+#include "event_trace.h"
+
+#if USE_EVENT_TRACE
+#include "data_pool.h"
+#include "task.h"
+#include "sys_clock.h"
+#include <string.h>
+
+#define TRACE_UART          huart2
+#define TRACE_NAME_LEN      8
+#define TRACE_FRAME_EVENTS  30      //每帧的记录数，数据区6+30*8=246字节
+
+enum
+{
+    TRACE_MSG_BEGIN = 0x30,
+    TRACE_MSG_NAMES,
+    TRACE_MSG_EVENTS,
+};
+
+typedef enum
+{
+    DRAIN_BEGIN = 0,
+    DRAIN_TASKS,
+    DRAIN_QUEUES,
+    DRAIN_EVENTS,
+}Drain_State_e;
+
+static volatile Trace_Event_t trace_buf[TRACE_BUF_LEN] CCM_RAM;
+static volatile uint32_t trace_head = 0;        //下一条记录的序号
+static volatile uint32_t trace_stop = 0;        //触发后停止记录的序号
+static volatile uint8_t trace_frozen = 0;       //已触发，序号到trace_stop后不再记录
+
+static QueueHandle_t trace_queue[TRACE_MAX_QUEUES];
+static uint8_t trace_queues = 0;
+
+static Drain_State_e drain_state = DRAIN_BEGIN;
+static uint32_t drain_index = 0;
+static TaskStatus_t drain_status[TRACE_MAX_TASKS] CCM_RAM;
+static uint8_t drain_buff[TRACE_FRAME_EVENTS*8 + 6 + 6];
+
+#if (TRACE_BUF_LEN & (TRACE_BUF_LEN - 1)) != 0 || TRACE_BUF_LEN <= TRACE_POST_LEN
+#error "TRACE_BUF_LEN must be a power of 2 and larger than TRACE_POST_LEN"
+#endif
+
+
+/**
+ * @brief 记录一条事件，可以在任务和中断中调用。
+ *        占位置和读时间戳在同一次LDREX/STREX之间，期间发生中断时STREX失败重来，记录的顺序与时间顺序一致
+ */
+void Trace_Record(uint8_t type, uint8_t id, uint16_t arg)
+{
+    uint32_t index, cycles;
+    do
+    {
+        index = __LDREXW(&trace_head);
+        if(trace_frozen && (int32_t)(index - trace_stop) >= 0)
+        {
+            __CLREX();
+            return;
+        }
+        cycles = Get_CycleCount();
+    }while(__STREXW(index + 1, &trace_head));
+
+    //先清类型再写内容，发送时类型为0的是没有写完的记录
+    volatile Trace_Event_t *e = &trace_buf[index & (TRACE_BUF_LEN - 1)];
+    e->type = 0;
+    e->cycles = cycles;
+    e->id = id;
+    e->arg = arg;
+    e->type = type;
+}
+
+
+/**
+ * @brief 登记要跟踪的队列，名字取队列注册表中的名字(vQueueAddToRegistry)。没有登记的队列和信号量不记录
+ */
+void Trace_Queue_Regist(void *queue)
+{
+    if(queue == NULL || trace_queues >= TRACE_MAX_QUEUES)
+        return;
+
+    trace_queue[trace_queues++] = (QueueHandle_t)queue;
+    vQueueSetQueueNumber((QueueHandle_t)queue, trace_queues);
+}
+
+
+/**
+ * @brief 触发一次快照：记录触发点，再记录TRACE_POST_LEN条后停止。上一次快照还没发送完时忽略
+ * @param reason 触发原因，记录在触发点的参数中
+ */
+void Trace_Trigger(uint16_t reason)
+{
+    if(trace_frozen)
+        return;
+
+    Trace_Record(TRACE_TRIGGER, 0, reason);
+    trace_stop = trace_head + TRACE_POST_LEN;
+    trace_frozen = 1;
+}
+
+
+static uint8_t *Put_Name(uint8_t *p, const char *name)
+{
+    memset(p, 0, TRACE_NAME_LEN);
+    if(name != NULL)
+        strncpy((char *)p, name, TRACE_NAME_LEN);
+    return p + TRACE_NAME_LEN;
+}
+
+
+/**
+ * @brief 打包并放入串口发送缓存
+ * @return uint8_t 1:已发送 0:发送缓存不够，下次重发
+ */
+static uint8_t Frame_Send(uint8_t len)
+{
+    if(Uart_Tx_Space(&TRACE_UART) < len + 6)
+        return 0;
+
+    drain_buff[0] = 0x55;
+    drain_buff[1] = 0xAA;
+    drain_buff[2] = len;
+    drain_buff[3+len] = serial_get_crc8_value(drain_buff, 3+len);
+    drain_buff[4+len] = 0x0D;
+    drain_buff[5+len] = 0x0A;
+    return Uart_Transmit(&TRACE_UART, drain_buff, len + 6);
+}
+
+
+/**
+ * @brief 调试任务中每ms调用一次，触发后记录停止时发送一帧快照，全部发送完后重新开始记录
+ */
+void Trace_Drain(void)
+{
+    uint8_t *p = drain_buff + 3;
+    uint8_t n = 0;
+    UBaseType_t i, tasks;
+
+    if(trace_frozen == 0 || (int32_t)(trace_head - trace_stop) < 0)
+        return;
+
+    switch(drain_state)
+    {
+        case DRAIN_BEGIN:
+        {
+            uint32_t first = trace_stop > TRACE_BUF_LEN ? trace_stop - TRACE_BUF_LEN : 0;
+            uint16_t count = (uint16_t)(trace_stop - first);
+            uint16_t cycles_per_us = SYSTEM_CYCLES_PER_US;
+            p[0] = TRACE_MSG_BEGIN;
+            memcpy(p + 1, &first, 4);
+            memcpy(p + 5, &count, 2);
+            memcpy(p + 7, &cycles_per_us, 2);
+            if(Frame_Send(9))
+            {
+                drain_index = first;
+                drain_state = DRAIN_TASKS;
+            }
+            break;
+        }
+
+        case DRAIN_TASKS:
+        {
+            tasks = uxTaskGetSystemState(drain_status, TRACE_MAX_TASKS, NULL);
+            p[0] = TRACE_MSG_NAMES;
+            p[1] = 0;
+            p += 3;
+            for(i=0; i<tasks; i++, n++)
+            {
+                *p++ = (uint8_t)drain_status[i].xTaskNumber;
+                p = Put_Name(p, drain_status[i].pcTaskName);
+            }
+            drain_buff[5] = n;
+            if(Frame_Send((uint8_t)(p - drain_buff - 3)))
+                drain_state = DRAIN_QUEUES;
+            break;
+        }
+
+        case DRAIN_QUEUES:
+            p[0] = TRACE_MSG_NAMES;
+            p[1] = 1;
+            p[2] = trace_queues;
+            p += 3;
+            for(n=0; n<trace_queues; n++)
+            {
+                *p++ = n + 1;
+                p = Put_Name(p, pcQueueGetName(trace_queue[n]));
+            }
+            if(Frame_Send((uint8_t)(p - drain_buff - 3)))
+                drain_state = DRAIN_EVENTS;
+            break;
+
+        case DRAIN_EVENTS:
+        {
+            uint32_t first = drain_index;
+            p[0] = TRACE_MSG_EVENTS;
+            memcpy(p + 2, &first, 4);
+            p += 6;
+            for(; n<TRACE_FRAME_EVENTS && first + n != trace_stop; n++)
+            {
+                volatile Trace_Event_t *e = &trace_buf[(first + n) & (TRACE_BUF_LEN - 1)];
+                Trace_Event_t event;
+                event.cycles = e->cycles;
+                event.type = e->type;
+                event.id = e->id;
+                event.arg = e->arg;
+                memcpy(p, &event, 8);
+                p += 8;
+            }
+            drain_buff[4] = n;
+            if(Frame_Send((uint8_t)(p - drain_buff - 3)))
+            {
+                drain_index += n;
+                if(drain_index == trace_stop)
+                {
+                    drain_state = DRAIN_BEGIN;
+                    trace_frozen = 0;
+                }
+            }
+            break;
+        }
+    }
+}
+
+#endif
@@ -0,0 +1,95 @@
+/**
+ * @file event_trace.h
+ * @author Yang JianYi
+ * @brief 事件跟踪：把任务切换、中断进出、队列收发和用户标记带时间戳记录到RAM环形缓存，用于查看延时尖峰时任务和中断的先后顺序。
+ *        1) 任务切换、队列收发由FreeRTOS的trace宏记录(本文件在FreeRTOSConfig.h中包含)，队列只记录用Trace_Queue_Regist登记过的；
+ *           中断在stm32f4xx_it.c的入口和出口调用TRACE_ISR_ENTER/TRACE_ISR_EXIT，编号为IRQn；
+ *           用户标记TRACE_MARK_BEGIN/TRACE_MARK_END，编号见Trace_Mark_e。
+ *        2) 每条记录8字节：DWT周期计数、类型、编号、参数。写入时用LDREX/STREX占一个位置再写入，不关中断，
+ *           任务和中断可以同时记录，一条约几十个周期。
+ *        3) 串口带宽(115200约11KB/s)远低于事件产生的速度，因此平时循环覆盖，只保留最近TRACE_BUF_LEN条；
+ *           调用Trace_Trigger()后再记录TRACE_POST_LEN条就停止，由Trace_Drain()在后台从USART2发送，发送完重新开始记录。
+ *           底盘任务周期超过TRACE_TRIGGER_US时自动触发，见chassis_task.cpp。
+ *        帧格式见event_trace.c，上位机工具Tools/trace_export.py把一次快照转换为Chrome trace/Perfetto的JSON。
+ * @version 0.1
+ * @date 2024-06-30
+ *
+ * @copyright Copyright (c) 2024
+ *
+ */
+#ifndef EVENT_TRACE_H
+#define EVENT_TRACE_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stdint.h>
+
+#define USE_EVENT_TRACE     0       //打开后FreeRTOS和中断的跟踪点生效；关闭时所有跟踪点和接口为空，不占用CCM
+#define TRACE_BUF_LEN       1024    //记录条数，2的幂，每条8字节，放在CCM
+#define TRACE_POST_LEN      256     //触发之后继续记录的条数，其余为触发之前的
+#define TRACE_TRIGGER_US    1500    //底盘任务两次循环间隔超过该值时触发，us
+#define TRACE_MAX_QUEUES    6
+#define TRACE_MAX_TASKS     10
+
+typedef enum
+{
+    TRACE_TASK_IN = 1,      //任务切入，编号为任务号(uxTCBNumber)
+    TRACE_ISR_ENTER,        //中断进入，编号为IRQn
+    TRACE_ISR_EXIT,
+    TRACE_QUEUE_SEND,       //编号为Trace_Queue_Regist的顺序(从1开始)，参数为操作前队列中的数量
+    TRACE_QUEUE_RECV,
+    TRACE_MARK_BEGIN,       //用户标记，编号见Trace_Mark_e
+    TRACE_MARK_END,
+    TRACE_TRIGGER,          //触发点，参数为触发原因(周期超出的us数，超过0xFFFF按0xFFFF)
+}Trace_Type_e;
+
+typedef enum
+{
+    TRACE_MARK_CONTROL = 1, //底盘控制(Control + Motor_Control)
+}Trace_Mark_e;
+
+typedef struct Trace_Event_t
+{
+    uint32_t cycles;        //DWT周期计数，168MHz
+    uint8_t type;           //Trace_Type_e，0表示正在写入
+    uint8_t id;
+    uint16_t arg;
+}Trace_Event_t;
+
+#if USE_EVENT_TRACE
+void Trace_Record(uint8_t type, uint8_t id, uint16_t arg);
+void Trace_Queue_Regist(void *queue);
+void Trace_Trigger(uint16_t reason);
+void Trace_Drain(void);
+
+#define TRACE_ISR_ENTER()       Trace_Record(TRACE_ISR_ENTER, (uint8_t)(__get_IPSR() - 16), 0)
+#define TRACE_ISR_EXIT()        Trace_Record(TRACE_ISR_EXIT, (uint8_t)(__get_IPSR() - 16), 0)
+#define TRACE_MARK_BEGIN(id)    Trace_Record(TRACE_MARK_BEGIN, (id), 0)
+#define TRACE_MARK_END(id)      Trace_Record(TRACE_MARK_END, (id), 0)
+
+//FreeRTOS跟踪宏，在tasks.c和queue.c中展开，可以访问pxCurrentTCB和队列结构体
+#define traceTASK_SWITCHED_IN()     Trace_Record(TRACE_TASK_IN, (uint8_t)pxCurrentTCB->uxTCBNumber, 0)
+#define TRACE_QUEUE_OP(type, q)     do{ if((q)->uxQueueNumber != 0) \
+                                        Trace_Record((type), (uint8_t)(q)->uxQueueNumber, (uint16_t)(q)->uxMessagesWaiting); }while(0)
+#define traceQUEUE_SEND(q)              TRACE_QUEUE_OP(TRACE_QUEUE_SEND, q)
+#define traceQUEUE_SEND_FROM_ISR(q)     TRACE_QUEUE_OP(TRACE_QUEUE_SEND, q)
+#define traceQUEUE_RECEIVE(q)           TRACE_QUEUE_OP(TRACE_QUEUE_RECV, q)
+#define traceQUEUE_RECEIVE_FROM_ISR(q)  TRACE_QUEUE_OP(TRACE_QUEUE_RECV, q)
+#else
+#define Trace_Record(type, id, arg)
+#define Trace_Queue_Regist(queue)
+#define Trace_Trigger(reason)
+#define Trace_Drain()
+#define TRACE_ISR_ENTER()
+#define TRACE_ISR_EXIT()
+#define TRACE_MARK_BEGIN(id)
+#define TRACE_MARK_END(id)
+#endif
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif //  EVENT_TRACE_H
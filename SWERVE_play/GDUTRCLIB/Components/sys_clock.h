@@ -0,0 +1,42 @@
+/**
+ * @file sys_clock.h
+ * @author Yang JianYi
+ * @brief 系统时钟接口，全工程统一从这里取us时间，实现在drive_tim.c(TIM4)。不依赖HAL，类中只需要包含这个头文件。
+ *        1) Get_SystemTimer64()返回64位单调递增的us时间(溢出次数32位，约8.9年回绕)，在任务、中断中调用都不会回退(关中断的情况见drive_tim.c)；
+ *        2) Get_SystemTimer()为其低32位，约71分钟回绕一次，计算间隔时按无符号减法(now - last)，回绕时结果仍然正确；
+ *        3) Get_CycleCount()为DWT周期计数器(SYSTEM_TIMER_USE_DWT打开时)，168MHz下约25s回绕，用于测量短时间间隔，
+ *           分辨率约6ns，除以SYSTEM_CYCLES_PER_US得到us；
+ *        4) SystemTimer_Source_Set()替换时钟来源，用于离线测试或仿真，传入NULL恢复硬件定时器。
+ *           替换后三个函数都从同一个来源取时间，所有模块看到的是同一个时钟。
+ * @version 0.1
+ * @date 2024-06-29
+ *
+ * @copyright Copyright (c) 2024
+ *
+ */
+#ifndef SYS_CLOCK_H
+#define SYS_CLOCK_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stdint.h>
+
+#ifndef SYSTEM_TIMER_USE_DWT
+#define SYSTEM_TIMER_USE_DWT    1       //打开DWT周期计数器，Get_CycleCount()可用，关闭时由us时间换算
+#endif
+#define SYSTEM_CYCLES_PER_US    168     //内核时钟168MHz
+
+typedef uint64_t (*Clock_Source_Fun)(void);
+
+uint64_t Get_SystemTimer64(void);
+uint32_t Get_SystemTimer(void);
+uint32_t Get_CycleCount(void);
+void SystemTimer_Source_Set(Clock_Source_Fun source);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif //  SYS_CLOCK_H
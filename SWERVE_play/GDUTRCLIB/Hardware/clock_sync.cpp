@@ -0,0 +1,192 @@
+/**
+ * @file clock_sync.cpp
+ * @author Yang JianYi
+ * @brief 时钟同步的实现。请求在通讯任务中记录，t3在串口发送中断中记录，换算在控制任务中使用，
+ *        多个成员一起读写的地方关中断，保证读到的是同一个样本的结果。
+ * @version 0.1
+ * @date 2024-06-21
+ *
+ * @copyright Copyright (c) 2024
+ *
+ */
+#include "clock_sync.h"
+#include "stm32f4xx_hal.h"
+
+#define DRIFT_MAX   500e-6f     //晶振频率差不会超过该值，超过说明样本有问题
+
+
+/**
+ * @brief 收到一次对时请求
+ *
+ * @param seq 本次请求序号，1~255
+ * @param t1 上位机发出本次请求的时刻，上位机时钟
+ * @param t2 收到本次请求的时刻，本地时钟
+ * @param last_seq 上一次请求的序号
+ * @param last_t4 上位机收到上一次应答的时刻，0表示没有收到
+ */
+void Clock_Sync::Request(uint8_t seq, uint32_t t1, uint32_t t2, uint8_t last_seq, uint32_t last_t4)
+{
+    uint32_t primask = __get_PRIMASK();
+    __disable_irq();
+    bool done = (last_seq != 0 && last_seq == req_seq && t3_valid && last_t4 != 0);
+    uint32_t s_t1 = req_t1, s_t2 = req_t2, s_t3 = req_t3;
+
+    req_seq = seq;
+    req_t1 = t1;
+    req_t2 = t2;
+    t3_valid = false;
+    __set_PRIMASK(primask);
+
+    if(done)
+        Sample(s_t1, s_t2, s_t3, last_t4);
+}
+
+
+/**
+ * @brief 带有应答的帧开始发送，只记录第一次，上位机以最先收到的那一帧为准
+ */
+void Clock_Sync::Tx_Stamp(uint8_t seq, uint32_t t3)
+{
+    uint32_t primask = __get_PRIMASK();
+    __disable_irq();
+    if(seq != 0 && seq == req_seq && t3_valid == false)
+    {
+        req_t3 = t3;
+        t3_valid = true;
+    }
+    __set_PRIMASK(primask);
+}
+
+
+/**
+ * @brief 获取需要放入应答的数据
+ * @return false 没有请求
+ */
+bool Clock_Sync::get_echo(uint8_t *seq, uint32_t *t1, uint32_t *t2) const
+{
+    uint32_t primask = __get_PRIMASK();
+    __disable_irq();
+    *seq = req_seq;
+    *t1 = req_t1;
+    *t2 = req_t2;
+    __set_PRIMASK(primask);
+    return *seq != 0;
+}
+
+
+/**
+ * @brief 加入一组完整的样本，t1、t4为上位机时钟，t2、t3为本地时钟
+ */
+void Clock_Sync::Sample(uint32_t t1, uint32_t t2, uint32_t t3, uint32_t t4)
+{
+    uint32_t rtt = (t4 - t1) - (t3 - t2);
+    if((int32_t)rtt < 0)
+        rtt = 0;
+
+    //往返延时不对称时偏差的误差最大为delay/2，只使用接近最小延时的样本
+    if(samples == 0 || rtt < delay_min)
+        delay_min = rtt;
+    else
+        delay_min += (rtt - delay_min) / 64;
+    delay = rtt;
+    if(samples > 0 && rtt > delay_min + Delay_Margin)
+    {
+        rejected++;
+        return;
+    }
+
+    //t2、t3的中点对应上位机t1、t4的中点
+    uint32_t a = t2 - t1, b = t3 - t4;
+    uint32_t theta = a + (uint32_t)((int32_t)(b - a) / 2);
+    uint32_t mid = t2 + (t3 - t2) / 2;
+
+    uint32_t primask = __get_PRIMASK();
+    __disable_irq();
+    if(samples == 0)
+    {
+        offset = theta;
+        frac = 0;
+        drift = 0;
+    }
+    else
+    {
+        float dt = (float)(int32_t)(mid - ref);
+        float err = (float)(int32_t)(theta - offset) - frac - drift*dt;
+        float adj = drift*dt + Kp*err + frac;
+        int32_t step = (int32_t)(adj < 0 ? adj - 0.5f : adj + 0.5f);
+        offset += (uint32_t)step;
+        frac = adj - (float)step;
+        if(dt > 0)
+            drift += Ki*err/dt;
+        if(drift > DRIFT_MAX)
+            drift = DRIFT_MAX;
+        else if(drift < -DRIFT_MAX)
+            drift = -DRIFT_MAX;
+    }
+    ref = mid;
+    samples++;
+    __set_PRIMASK(primask);
+}
+
+
+/**
+ * @brief 本地时刻对应的偏差，调用时中断已关闭
+ */
+int32_t Clock_Sync::Offset_At(uint32_t local) const
+{
+    float k = frac + drift*(float)(int32_t)(local - ref);
+    return (int32_t)offset + (int32_t)(k < 0 ? k - 0.5f : k + 0.5f);
+}
+
+
+/**
+ * @brief 本地时刻换算为上位机时刻
+ */
+uint32_t Clock_Sync::To_Host(uint32_t local) const
+{
+    uint32_t primask = __get_PRIMASK();
+    __disable_irq();
+    uint32_t host = local - (uint32_t)Offset_At(local);
+    __set_PRIMASK(primask);
+    return host;
+}
+
+
+/**
+ * @brief 上位机时刻换算为本地时刻
+ */
+uint32_t Clock_Sync::To_Local(uint32_t host) const
+{
+    uint32_t primask = __get_PRIMASK();
+    __disable_irq();
+    uint32_t local = host + offset;
+    local = host + (uint32_t)Offset_At(local);
+    __set_PRIMASK(primask);
+    return local;
+}
+
+
+/**
+ * @brief 收到过足够的样本且最近一个样本没有超时
+ */
+bool Clock_Sync::is_synced(uint32_t local_now) const
+{
+    return samples >= 3 && (local_now - ref) < Timeout;
+}
+
+
+Clock_Sync_Stats_t Clock_Sync::get_stats(void) const
+{
+    Clock_Sync_Stats_t stats;
+    uint32_t primask = __get_PRIMASK();
+    __disable_irq();
+    stats.offset = (int32_t)offset;
+    stats.drift_ppm = drift*1e6f;
+    stats.delay = delay;
+    stats.delay_min = delay_min;
+    stats.samples = samples;
+    stats.rejected = rejected;
+    __set_PRIMASK(primask);
+    stats.synced = samples >= 3;
+    return stats;
+}
@@ -0,0 +1,71 @@
+/**
+ * @file clock_sync.h
+ * @author Yang JianYi
+ * @brief 与上位机的时钟同步(NTP方式)。上位机发出请求时刻t1(上位机时钟)，下位机收到时刻t2、发出应答时刻t3(本地时钟)，
+ *        上位机收到应答时刻t4，得到一组样本：
+ *            偏差 offset = ((t2-t1) + (t3-t4))/2   (本地时钟 - 上位机时钟)
+ *            往返延时 delay = (t4-t1) - (t3-t2)
+ *        偏差和频率差(drift)用PI环路跟踪，往返延时明显大于最小值的样本(排队、重发造成的不对称延时)直接丢弃。
+ *        上位机在下一次请求中带回上一次的t4，下位机和上位机各自得到同样的样本。
+ *        本地时间为Get_SystemTimer()的32位us，间隔的计算见sys_clock.h。
+ *        To_Host/To_Local可以在任务和中断中调用。
+ * @version 0.1
+ * @date 2024-06-21
+ *
+ * @copyright Copyright (c) 2024
+ *
+ */
+#pragma once
+#ifdef __cplusplus
+
+#include <stdint.h>
+
+//同步状态
+typedef struct Clock_Sync_Stats_t
+{
+    int32_t offset;         //本地时钟 - 上位机时钟，us
+    float drift_ppm;        //本地时钟相对上位机快多少，ppm
+    uint32_t delay;         //最近一个样本的往返延时，us
+    uint32_t delay_min;     //往返延时的最小值(缓慢上升以适应链路变化)，us
+    uint32_t samples;       //接受的样本数
+    uint32_t rejected;      //延时过大被丢弃的样本数
+    bool synced;
+}Clock_Sync_Stats_t;
+
+class Clock_Sync
+{
+public:
+    Clock_Sync(){}
+
+    float Kp = 0.3f;                    /*!< 偏差修正比例 */
+    float Ki = 0.05f;                   /*!< 频率修正比例 */
+    uint32_t Delay_Margin = 500;        /*!< 往返延时超过最小值该值以上的样本丢弃，us */
+    uint32_t Timeout = 10000000;        /*!< 超过该时间没有新样本认为失去同步，us */
+
+    void Request(uint8_t seq, uint32_t t1, uint32_t t2, uint8_t last_seq, uint32_t last_t4);
+    void Tx_Stamp(uint8_t seq, uint32_t t3);
+    bool get_echo(uint8_t *seq, uint32_t *t1, uint32_t *t2) const;
+
+    void Sample(uint32_t t1, uint32_t t2, uint32_t t3, uint32_t t4);
+    uint32_t To_Host(uint32_t local) const;
+    uint32_t To_Local(uint32_t host) const;
+    bool is_synced(uint32_t local_now) const;
+    Clock_Sync_Stats_t get_stats(void) const;
+
+private:
+    //正在进行的一次交换，seq为0表示没有
+    uint8_t req_seq = 0;
+    uint32_t req_t1 = 0, req_t2 = 0, req_t3 = 0;
+    bool t3_valid = false;
+
+    uint32_t offset = 0;        //ref时刻的偏差，本地 - 上位机，按uint32回绕
+    float frac = 0;             //offset的小数部分
+    float drift = 0;            //频率差，us/us
+    uint32_t ref = 0;           //最近一个样本的本地时刻
+    uint32_t delay = 0, delay_min = 0;
+    uint32_t samples = 0, rejected = 0;
+
+    int32_t Offset_At(uint32_t local) const;
+};
+
+#endif
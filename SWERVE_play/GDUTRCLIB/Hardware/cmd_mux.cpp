@@ -0,0 +1,157 @@
+/**
+ * @file cmd_mux.cpp
+ * @author Yang JianYi
+ * @brief 速度指令仲裁的实现，来源数很少，每个周期遍历所有来源即可。
+ *        来源的指令由提交方写入邮箱，Select读取每个邮箱的最新值，两边都不需要临界区。
+ * @version 0.1
+ * @date 2024-06-22
+ *
+ * @copyright Copyright (c) 2024
+ *
+ */
+#include "cmd_mux.h"
+
+
+/**
+ * @brief 添加一个指令来源
+ *
+ * @param priority 优先级，数值越小越高
+ * @param timeout_us 超过该时间没有新指令认为来源失效
+ * @return int 来源号，超出数量时返回-1
+ */
+int Cmd_Mux::Add_Source(uint8_t priority, uint32_t timeout_us, CMD_HANDOVER handover)
+{
+    if(sources >= CMD_MUX_MAX_SOURCE)
+        return -1;
+
+    source[sources].priority = priority;
+    source[sources].timeout = timeout_us;
+    source[sources].handover = handover;
+    source[sources].expired = 0;
+    return sources++;
+}
+
+
+/**
+ * @brief 来源收到一条新指令
+ * @param now 收到指令的时刻，us
+ */
+void Cmd_Mux::Submit(int src, const Robot_Twist_t &twist, uint32_t now)
+{
+    if(src < 0 || src >= sources)
+        return;
+
+    Cmd_t cmd;
+    cmd.twist = twist;
+    cmd.valid = true;
+    source[src].cmd.Write(cmd, now);
+}
+
+
+/**
+ * @brief 来源主动放弃控制，下一次Select时切换
+ */
+void Cmd_Mux::Release(int src)
+{
+    if(src < 0 || src >= sources)
+        return;
+
+    Cmd_t cmd = {{0}};
+    cmd.valid = false;
+    source[src].cmd.Write(cmd, 0);
+}
+
+
+/**
+ * @brief 读取来源的最新指令
+ *
+ * @param age 输出指令的时间，us。Submit的时刻可能比Select取的now稍晚，此时为负
+ * @return uint32_t 指令序号，0表示没有收到过指令或这条指令已经超时
+ */
+uint32_t Cmd_Mux::Read(int src, uint32_t now, Cmd_t *cmd, int32_t *age) const
+{
+    uint32_t stamp;
+    uint32_t seq = source[src].cmd.Read(cmd, &stamp);
+    if(seq == 0 || seq == source[src].expired)
+        return 0;
+    *age = (int32_t)(now - stamp);
+    return seq;
+}
+
+
+bool Cmd_Mux::is_live(int src, uint32_t now) const
+{
+    if(src < 0 || src >= sources)
+        return false;
+
+    Cmd_t cmd;
+    int32_t age;
+    if(Read(src, now, &cmd, &age) == 0 || cmd.valid == false)
+        return false;
+    return age < 0 || (uint32_t)age <= source[src].timeout;
+}
+
+
+/**
+ * @brief 选择本周期的来源，每个控制周期调用一次
+ *
+ * @param twist 输出本周期的指令，没有有效来源时为零速度
+ * @return int 当前来源，-1表示没有
+ */
+int Cmd_Mux::Select(uint32_t now, Robot_Twist_t *twist)
+{
+    Cmd_t cmd[CMD_MUX_MAX_SOURCE];
+    int32_t age[CMD_MUX_MAX_SOURCE];
+    bool live[CMD_MUX_MAX_SOURCE];
+    int best = -1;
+    bool lost = false;
+
+    for(int i=0; i<sources; i++)
+    {
+        uint32_t seq = Read(i, now, &cmd[i], &age[i]);
+        live[i] = (seq != 0 && cmd[i].valid);
+
+        //超时的指令记下序号，之后不再当作有效，避免时间戳回绕后又被当作有效
+        if(live[i] && age[i] > 0 && (uint32_t)age[i] > source[i].timeout)
+        {
+            source[i].expired = seq;
+            live[i] = false;
+            if(i == active)
+                lost = true;        //Release不算超时
+        }
+        if(live[i] && (best < 0 || source[i].priority < source[best].priority))
+            best = i;
+    }
+
+    int next = active;
+    if(active >= 0 && live[active] == false)
+        next = -1;
+
+    if(next < 0)
+        next = best;
+    else if(best >= 0 && source[best].priority < source[next].priority && source[best].handover == CMD_PREEMPT)
+        next = best;
+
+    if(next >= 0)
+    {
+        *twist = cmd[next].twist;
+        stats.active_age = age[next] > 0 ? (uint32_t)age[next] : 0;
+    }
+    else
+    {
+        Robot_Twist_t stop = {0};
+        stop.chassis_mode = NORMAL;
+        *twist = stop;
+        stats.active_age = 0;
+    }
+
+    if(next != active)
+    {
+        stats.switches++;
+        if(next < 0 && lost)
+            stats.watchdog_stops++;
+        active = next;
+        stats.active = (int8_t)next;
+    }
+    return active;
+}
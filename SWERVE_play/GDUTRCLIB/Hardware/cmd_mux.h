@@ -0,0 +1,80 @@
+/**
+ * @file cmd_mux.h
+ * @author Yang JianYi
+ * @brief 底盘速度指令仲裁。每个指令来源(ROS、航模手柄、内部自动程序等)一个通道，来源收到指令时调用Submit，
+ *        主动放弃控制时调用Release；控制任务每个周期调用一次Select，得到本周期生效的指令。
+ *        1) 通道在超时时间内有指令且没有Release时为有效；当前来源失效的那个周期就切换到其他有效来源，
+ *           没有有效来源时输出零速度(看门狗停车)。
+ *        2) 优先级数值越小越高。交接方式：CMD_PREEMPT 有效时立即从低优先级来源接管；
+ *           CMD_WAIT 等当前来源失效或Release后才接管。当前没有来源时选择优先级最高的有效来源。
+ *        每个来源的指令放在一个最新值邮箱(mailbox.h)中，Submit/Release不关中断，可以在任务或中断中调用，
+ *        但同一个来源只能由一个任务(或中断)提交；Select只在控制任务中调用。
+ * @version 0.1
+ * @date 2024-06-22
+ *
+ * @copyright Copyright (c) 2024
+ *
+ */
+#pragma once
+#ifdef __cplusplus
+
+#include <stdint.h>
+#include "data_pool.h"
+#include "mailbox.h"
+
+#define CMD_MUX_MAX_SOURCE 4
+
+typedef enum CMD_HANDOVER
+{
+    CMD_PREEMPT,
+    CMD_WAIT
+}CMD_HANDOVER;
+
+//仲裁状态
+typedef struct Cmd_Mux_Stats_t
+{
+    int8_t active;              //当前来源，-1表示没有(零速度)
+    uint32_t active_age;        //当前来源最近一条指令的时间，us
+    uint32_t switches;          //来源切换次数
+    uint32_t watchdog_stops;    //当前来源超时、没有其他来源而停车的次数
+}Cmd_Mux_Stats_t;
+
+class Cmd_Mux
+{
+public:
+    Cmd_Mux(){}
+
+    int Add_Source(uint8_t priority, uint32_t timeout_us, CMD_HANDOVER handover);
+    void Submit(int src, const Robot_Twist_t &twist, uint32_t now);
+    void Release(int src);
+    int Select(uint32_t now, Robot_Twist_t *twist);
+
+    bool is_live(int src, uint32_t now) const;
+    int get_active(void) const { return active; }
+    Cmd_Mux_Stats_t get_stats(void) const { return stats; }
+
+private:
+    typedef struct
+    {
+        Robot_Twist_t twist;
+        bool valid;             //false表示来源Release
+    }Cmd_t;
+
+    typedef struct
+    {
+        uint8_t priority;
+        uint32_t timeout;
+        CMD_HANDOVER handover;
+        Mailbox<Cmd_t> cmd;     //最近一条指令，邮箱的时间戳为指令的时刻
+        uint32_t expired;       //已超时的指令序号，只由Select修改，时间戳回绕后同一条指令也不会再生效
+    }Source_t;
+
+    Source_t source[CMD_MUX_MAX_SOURCE];
+    int sources = 0;
+    int active = -1;
+    Cmd_Mux_Stats_t stats = {-1, 0, 0, 0};
+
+    uint32_t Read(int src, uint32_t now, Cmd_t *cmd, int32_t *age) const;
+};
+
+#endif
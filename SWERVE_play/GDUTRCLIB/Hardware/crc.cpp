@@ -0,0 +1,172 @@
+/**
+ * @file crc.cpp
+ * @author Yang JianYi
+ * @brief 查表法CRC和硬件CRC单元的实现。
+ *        256项的表由constexpr函数逐项计算(C++11的constexpr函数只能有一条return语句，用递归代替循环)，
+ *        用宏展开成初始化列表，编译期生成，不占用RAM，也不需要上电初始化。
+ *        硬件CRC单元计算的是CRC-32/MPEG-2(不反射、无结果异或)，输入输出按位反转后结果与zlib的CRC-32相同：
+ *        crc32(data) = ~rbit(HW(rbit(word)...))，数据按小端字输入。
+ * @version 0.1
+ * @date 2024-06-20
+ *
+ * @copyright Copyright (c) 2024
+ *
+ */
+#include "crc.h"
+#include "stm32f4xx_hal.h"
+
+#define CRC8_POLY   0x8CU
+#define CRC16_POLY  0xA001U
+#define CRC32_POLY  0xEDB88320U
+
+static constexpr uint32_t Crc_Entry(uint32_t crc, uint32_t poly, int bits)
+{
+    return bits == 0 ? crc : Crc_Entry((crc & 1) ? (crc >> 1) ^ poly : (crc >> 1), poly, bits - 1);
+}
+
+#define CRC_T4(f, i)    f(i), f(i+1), f(i+2), f(i+3)
+#define CRC_T16(f, i)   CRC_T4(f, i), CRC_T4(f, i+4), CRC_T4(f, i+8), CRC_T4(f, i+12)
+#define CRC_T64(f, i)   CRC_T16(f, i), CRC_T16(f, i+16), CRC_T16(f, i+32), CRC_T16(f, i+48)
+#define CRC_T256(f)     CRC_T64(f, 0), CRC_T64(f, 64), CRC_T64(f, 128), CRC_T64(f, 192)
+
+#define CRC8_ENTRY(i)   (uint8_t)Crc_Entry(i, CRC8_POLY, 8)
+#define CRC16_ENTRY(i)  (uint16_t)Crc_Entry(i, CRC16_POLY, 8)
+#define CRC32_ENTRY(i)  Crc_Entry(i, CRC32_POLY, 8)
+
+static constexpr uint8_t crc8_table[256] = { CRC_T256(CRC8_ENTRY) };
+static constexpr uint16_t crc16_table[256] = { CRC_T256(CRC16_ENTRY) };
+static constexpr uint32_t crc32_table[256] = { CRC_T256(CRC32_ENTRY) };
+
+static_assert(crc8_table[128] == CRC8_POLY, "crc8 table");
+static_assert(crc32_table[128] == CRC32_POLY, "crc32 table");
+
+
+uint8_t Crc8_Update(uint8_t crc, const uint8_t *data, uint32_t len)
+{
+    while(len--)
+        crc = crc8_table[crc ^ *data++];
+    return crc;
+}
+
+
+uint16_t Crc16_Update(uint16_t crc, const uint8_t *data, uint32_t len)
+{
+    while(len--)
+        crc = (crc >> 8) ^ crc16_table[(crc ^ *data++) & 0xFF];
+    return crc;
+}
+
+
+/**
+ * @param crc 上一段的结果，首段为CRC32_INIT
+ */
+uint32_t Crc32_Update(uint32_t crc, const uint8_t *data, uint32_t len)
+{
+    crc = ~crc;
+    while(len--)
+        crc = (crc >> 8) ^ crc32_table[(crc ^ *data++) & 0xFF];
+    return ~crc;
+}
+
+
+/**
+ * @brief 打开硬件CRC时钟并复位到初值，开始一次新的计算
+ */
+void Crc32_Hw_Reset(void)
+{
+    __HAL_RCC_CRC_CLK_ENABLE();
+    CRC->CR = CRC_CR_RESET;
+}
+
+
+/**
+ * @brief 向硬件CRC单元输入words个字，返回到目前为止所有输入的CRC-32(与Crc32_Update的结果相同)
+ *        每个字4个时钟周期，可以分多次调用
+ */
+uint32_t Crc32_Hw_Update(const uint32_t *data, uint32_t words)
+{
+    while(words--)
+        CRC->DR = __RBIT(*data++);
+    return ~__RBIT(CRC->DR);
+}
+
+
+#define BENCH_SIZE 256
+#define BENCH_LOOP 20
+
+static uint32_t bench_buff[BENCH_SIZE/4];
+static volatile uint32_t bench_out = 0;    //volatile防止编译器把整个循环优化掉
+
+
+//原serial_get_crc8_value的实现，只用于对比
+static uint8_t Crc8_Bitwise(const uint8_t *data, uint32_t len)
+{
+    uint8_t crc = 0;
+    while(len--)
+    {
+        crc ^= *data++;
+        for(int i=0; i<8; i++)
+        {
+            if(crc & 0x01)
+                crc = (crc >> 1) ^ CRC8_POLY;
+            else
+                crc >>= 1;
+        }
+    }
+    return crc;
+}
+
+
+static inline void Cycle_Counter_Init(void)
+{
+    CoreDebug->DEMCR |= CoreDebug_DEMCR_TRCENA_Msk;
+    DWT->CYCCNT = 0;
+    DWT->CTRL |= DWT_CTRL_CYCCNTENA_Msk;
+}
+
+
+/**
+ * @brief 对256字节的数据分别测量各种CRC每字节的平均时钟周期，测试期间关中断
+ *        使用方法：在data_pool.h中打开USE_CRC_BENCH，调试任务启动时会执行一次，结果在keil的watch窗口中查看crc_bench变量。
+ */
+void Crc_Benchmark(Crc_Bench_t *result)
+{
+    const uint8_t *p = (const uint8_t *)bench_buff;
+    uint32_t start = 0;
+
+    for(int i=0; i<BENCH_SIZE/4; i++)
+        bench_buff[i] = 0x9E3779B9U * (i + 1);
+
+    Cycle_Counter_Init();
+    __disable_irq();
+
+    start = DWT->CYCCNT;
+    for(int i=0; i<BENCH_LOOP; i++)
+        bench_out = Crc8_Bitwise(p, BENCH_SIZE);
+    result->crc8_bitwise = (float)(DWT->CYCCNT - start) / (BENCH_LOOP*BENCH_SIZE);
+
+    start = DWT->CYCCNT;
+    for(int i=0; i<BENCH_LOOP; i++)
+        bench_out = Crc8_Update(CRC8_INIT, p, BENCH_SIZE);
+    result->crc8_table = (float)(DWT->CYCCNT - start) / (BENCH_LOOP*BENCH_SIZE);
+
+    start = DWT->CYCCNT;
+    for(int i=0; i<BENCH_LOOP; i++)
+        bench_out = Crc16_Update(CRC16_INIT, p, BENCH_SIZE);
+    result->crc16_table = (float)(DWT->CYCCNT - start) / (BENCH_LOOP*BENCH_SIZE);
+
+    start = DWT->CYCCNT;
+    for(int i=0; i<BENCH_LOOP; i++)
+        bench_out = Crc32_Update(CRC32_INIT, p, BENCH_SIZE);
+    result->crc32_table = (float)(DWT->CYCCNT - start) / (BENCH_LOOP*BENCH_SIZE);
+
+    start = DWT->CYCCNT;
+    for(int i=0; i<BENCH_LOOP; i++)
+    {
+        Crc32_Hw_Reset();
+        bench_out = Crc32_Hw_Update(bench_buff, BENCH_SIZE/4);
+    }
+    result->crc32_hw = (float)(DWT->CYCCNT - start) / (BENCH_LOOP*BENCH_SIZE);
+
+    __enable_irq();
+}
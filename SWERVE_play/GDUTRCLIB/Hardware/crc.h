@@ -0,0 +1,52 @@
+/**
+ * @file crc.h
+ * @author Yang JianYi
+ * @brief 查表法CRC，表在编译期由constexpr函数生成，放在flash中，每字节一次查表和一次异或。
+ *        CRC8  : 多项式0x8C(反射)，初值0，与原serial_get_crc8_value相同，用于0x55 0xAA串口帧
+ *        CRC16 : CRC-16/MODBUS，多项式0xA001(反射)，初值0xFFFF
+ *        CRC32 : CRC-32(zlib)，多项式0xEDB88320(反射)，初值、结果异或0xFFFFFFFF
+ *        所有函数都可以分段计算：把上一段的返回值作为下一段的crc参数传入，例如按DMA接收的分块逐块计算，
+ *        结果与整段一次计算相同。首段传入CRC8_INIT、CRC16_INIT、CRC32_INIT。
+ *        Crc32_Hw_xxx使用STM32F4的硬件CRC单元计算同样的CRC-32，只能按4字节对齐的字计算，适合flash记录等按字组织的数据；
+ *        串口帧是按字节的CRC8，硬件单元的多项式固定为0x04C11DB7，不能用于串口帧。
+ *        性能对比见crc.cpp中的Crc_Benchmark()。
+ * @version 0.1
+ * @date 2024-06-20
+ *
+ * @copyright Copyright (c) 2024
+ *
+ */
+#pragma once
+#include <stdint.h>
+
+#define CRC8_INIT   0x00
+#define CRC16_INIT  0xFFFF
+#define CRC32_INIT  0x00000000U
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+uint8_t Crc8_Update(uint8_t crc, const uint8_t *data, uint32_t len);
+uint16_t Crc16_Update(uint16_t crc, const uint8_t *data, uint32_t len);
+uint32_t Crc32_Update(uint32_t crc, const uint8_t *data, uint32_t len);
+
+//硬件CRC单元只有一个且不能设置初值，Reset与之后的Update之间不能插入其他使用者
+void Crc32_Hw_Reset(void);
+uint32_t Crc32_Hw_Update(const uint32_t *data, uint32_t words);
+
+#ifdef __cplusplus
+}
+
+typedef struct Crc_Bench_t
+{
+    float crc8_bitwise;     //原逐位计算的CRC8，每字节平均时钟周期
+    float crc8_table;       //查表CRC8，每字节平均时钟周期
+    float crc16_table;
+    float crc32_table;
+    float crc32_hw;         //硬件CRC单元，每字节平均时钟周期
+}Crc_Bench_t;
+
+void Crc_Benchmark(Crc_Bench_t *result);
+
+#endif
@@ -0,0 +1,95 @@
+/**
+ * @file fastmath.cpp
+ * @author Yang JianYi
+ * @brief fastmath与libm的性能对比，使用DWT周期计数器测量单次调用的平均时钟周期。
+ *        使用方法：在data_pool.h中打开USE_FASTMATH_BENCH，调试任务启动时会执行一次，结果在keil的watch窗口中查看fastmath_bench_xxx变量。
+ * @version 0.1
+ * @date 2024-06-02
+ *
+ * @copyright Copyright (c) 2024
+ *
+ */
+#include "fastmath.h"
+#include "stm32f4xx_hal.h"
+#include <math.h>
+
+#define BENCH_LOOP 1000
+
+static volatile float bench_in = 0.3f;    //volatile防止编译器把整个循环优化掉
+static volatile float bench_out = 0;
+
+
+static inline void Cycle_Counter_Init(void)
+{
+    CoreDebug->DEMCR |= CoreDebug_DEMCR_TRCENA_Msk;
+    DWT->CYCCNT = 0;
+    DWT->CTRL |= DWT_CTRL_CYCCNTENA_Msk;
+}
+
+
+/**
+ * @brief 分别测量sin+cos、atan2、sqrt三组函数的平均耗时，测试期间关中断，避免任务切换影响结果
+ *
+ * @param sincos_res 原底盘坐标变换使用的double版cos()+sin()，对比fast_sincosf()
+ * @param atan2_res  atan2f()对比fast_atan2f()
+ * @param sqrt_res   double版sqrt()对比fast_sqrtf()
+ */
+void FastMath_Benchmark(FastMath_Bench_t *sincos_res, FastMath_Bench_t *atan2_res, FastMath_Bench_t *sqrt_res)
+{
+    uint32_t start = 0;
+    float x = 0, s = 0, c = 0;
+
+    Cycle_Counter_Init();
+    __disable_irq();
+
+    start = DWT->CYCCNT;
+    for(int i=0; i<BENCH_LOOP; i++)
+    {
+        x = bench_in + i;
+        bench_out = (float)(cos((double)x) + sin((double)x));
+    }
+    sincos_res->libm_cycles = (DWT->CYCCNT - start) / BENCH_LOOP;
+
+    start = DWT->CYCCNT;
+    for(int i=0; i<BENCH_LOOP; i++)
+    {
+        x = bench_in + i;
+        fast_sincosf(x, &s, &c);
+        bench_out = s + c;
+    }
+    sincos_res->fast_cycles = (DWT->CYCCNT - start) / BENCH_LOOP;
+
+    start = DWT->CYCCNT;
+    for(int i=0; i<BENCH_LOOP; i++)
+    {
+        x = bench_in - i;
+        bench_out = atan2f(x, bench_in);
+    }
+    atan2_res->libm_cycles = (DWT->CYCCNT - start) / BENCH_LOOP;
+
+    start = DWT->CYCCNT;
+    for(int i=0; i<BENCH_LOOP; i++)
+    {
+        x = bench_in - i;
+        bench_out = fast_atan2f(x, bench_in);
+    }
+    atan2_res->fast_cycles = (DWT->CYCCNT - start) / BENCH_LOOP;
+
+    start = DWT->CYCCNT;
+    for(int i=0; i<BENCH_LOOP; i++)
+    {
+        x = bench_in + i;
+        bench_out = (float)sqrt((double)x);
+    }
+    sqrt_res->libm_cycles = (DWT->CYCCNT - start) / BENCH_LOOP;
+
+    start = DWT->CYCCNT;
+    for(int i=0; i<BENCH_LOOP; i++)
+    {
+        x = bench_in + i;
+        bench_out = fast_sqrtf(x);
+    }
+    sqrt_res->fast_cycles = (DWT->CYCCNT - start) / BENCH_LOOP;
+
+    __enable_irq();
+}
@@ -0,0 +1,138 @@
+/**
+ * @file fastmath.h
+ * @author Yang JianYi
+ * @brief 单精度快速数学函数，用于替换控制回路中的double版cos/sin/sqrt以及libm的atan2f。
+ *        M4内核的FPU只支持单精度，double运算全部由软件模拟，控制回路中应尽量只使用这里的函数。
+ *        误差(在主机上对double版libm逐点扫描得到)：
+ *        fast_sinf/fast_cosf : |x|<=1e4 rad 时绝对误差 < 3e-7 (9阶奇多项式，[-PI/2,PI/2]上的近似极小化逼近)
+ *        fast_atan2f         : 绝对误差 < 2e-6 rad (约 1.1e-4 度)
+ *        fast_sqrtf          : 使用硬件VSQRT指令，结果正确舍入(0.5ulp)，负数输入返回0
+ *        性能对比见fastmath.cpp中的FastMath_Benchmark()。
+ * @version 0.1
+ * @date 2024-06-02
+ *
+ * @copyright Copyright (c) 2024
+ *
+ */
+#pragma once
+#ifdef __cplusplus
+
+#include <stdint.h>
+
+#define FAST_PI         3.14159265358979f
+#define FAST_HALF_PI    1.57079632679490f
+#define FAST_TWO_PI     6.28318530717959f
+#define FAST_INV_TWO_PI 0.159154943091895f
+#define FAST_DEG2RAD    0.0174532925199433f
+#define FAST_RAD2DEG    57.2957795130823f
+
+
+/**
+ * @brief 单精度开方，Cortex-M4F上编译为一条VSQRT.F32指令
+ * @param x 输入，小于等于0时返回0
+ */
+static inline float fast_sqrtf(float x)
+{
+    if(x <= 0.0f)
+        return 0.0f;
+#if defined(__CC_ARM)
+    return __sqrtf(x);
+#else
+    return __builtin_sqrtf(x);
+#endif
+}
+
+
+/**
+ * @brief 把角度约束到[-PI, PI]，2*PI拆成高低两部分，保证大角度时的精度
+ */
+static inline float fast_wrap_pi(float x)
+{
+    float k = x * FAST_INV_TWO_PI;
+    k = (float)(int32_t)(k + (k >= 0 ? 0.5f : -0.5f));
+    return (x - k * 6.28125f) - k * 1.93530717958e-3f;
+}
+
+
+/**
+ * @brief 单精度正弦
+ * @param x 弧度
+ */
+static inline float fast_sinf(float x)
+{
+    x = fast_wrap_pi(x);
+
+    //折叠到[-PI/2, PI/2]
+    if(x > FAST_HALF_PI)
+        x = FAST_PI - x;
+    else if(x < -FAST_HALF_PI)
+        x = -FAST_PI - x;
+
+    float x2 = x * x;
+    return x * (0.99999997659380f + x2 * (-0.16666647636542f + x2 * (8.3328998494628e-3f
+             + x2 * (-1.9800899116833e-4f + x2 * 2.5904908673396e-6f))));
+}
+
+
+/**
+ * @brief 单精度余弦
+ * @param x 弧度
+ */
+static inline float fast_cosf(float x)
+{
+    //cos(x) = sin(PI/2 - |x|)，先约束范围再平移，避免大角度时加PI/2丢失精度
+    x = fast_wrap_pi(x);
+    return fast_sinf(FAST_HALF_PI - (x < 0 ? -x : x));
+}
+
+
+/**
+ * @brief 同时计算正弦和余弦，坐标变换时使用
+ */
+static inline void fast_sincosf(float x, float *s, float *c)
+{
+    *s = fast_sinf(x);
+    *c = fast_cosf(x);
+}
+
+
+/**
+ * @brief 单精度反正切，输出范围[-PI, PI]，与atan2f的象限约定一致
+ * @param y
+ * @param x
+ */
+static inline float fast_atan2f(float y, float x)
+{
+    float ax = x < 0 ? -x : x;
+    float ay = y < 0 ? -y : y;
+    float mx = ax > ay ? ax : ay;
+    float mn = ax > ay ? ay : ax;
+
+    if(mx == 0.0f)
+        return 0.0f;
+
+    //z在[0,1]内，atan(z)使用11阶奇多项式逼近
+    float z = mn / mx;
+    float z2 = z * z;
+    float r = z * (0.99997722f + z2 * (-0.33262284f + z2 * (0.19354040f
+            + z2 * (-0.11642651f + z2 * (0.05264736f + z2 * -0.01171913f)))));
+
+    if(ay > ax)
+        r = FAST_HALF_PI - r;
+    if(x < 0)
+        r = FAST_PI - r;
+    if(y < 0)
+        r = -r;
+    return r;
+}
+
+
+typedef struct FastMath_Bench_t
+{
+    uint32_t libm_cycles;   //libm(sin/cos/sqrt为double版，atan2f为单精度)单次平均时钟周期
+    uint32_t fast_cycles;   //fastmath单次平均时钟周期
+}FastMath_Bench_t;
+
+void FastMath_Benchmark(FastMath_Bench_t *sincos_res, FastMath_Bench_t *atan2_res, FastMath_Bench_t *sqrt_res);
+
+#endif
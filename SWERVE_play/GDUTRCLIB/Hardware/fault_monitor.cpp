@@ -0,0 +1,165 @@
+/**
+ * @file fault_monitor.cpp
+ * @author Yang JianYi
+ * @brief 电机故障监测的实现，时间为Get_SystemTimer()的us时间戳。
+ * @version 0.1
+ * @date 2024-06-14
+ *
+ * @copyright Copyright (c) 2024
+ *
+ */
+#include "fault_monitor.h"
+
+
+/**
+ * @brief 添加一个电机通道
+ * @return int 通道号，超出数量时返回-1
+ */
+int Fault_Monitor::Add_Channel(const Fault_Threshold_t &threshold)
+{
+    if(channels >= FAULT_MAX_CHANNEL)
+        return -1;
+
+    this->threshold[channels] = threshold;
+    Channel_State_t init = {0};
+    state[channels] = init;
+    return channels++;
+}
+
+
+/**
+ * @brief 条件持续debounce_us后返回true
+ *
+ * @param since 条件开始的时间，0表示条件不成立
+ */
+bool Fault_Monitor::Debounce(uint32_t *since, bool active, uint32_t now, uint32_t debounce_us)
+{
+    if(active == false)
+    {
+        *since = 0;
+        return false;
+    }
+
+    if(*since == 0)
+        *since = now ? now : 1;
+    return (now - *since) >= debounce_us;
+}
+
+
+/**
+ * @brief 更新一个电机的故障状态，每个控制周期对每个电机调用一次
+ *
+ * @param sample 电机反馈
+ * @param now 当前时间，us
+ */
+void Fault_Monitor::Update(int ch, const Fault_Sample_t &sample, uint32_t now)
+{
+    if(ch < 0 || ch >= channels)
+        return;
+
+    const Fault_Threshold_t &th = threshold[ch];
+    Channel_State_t &st = state[ch];
+    uint8_t active = FAULT_NONE;
+
+    if(st.is_init == false)
+    {
+        st.last_rx_cnt = sample.rx_cnt;
+        st.last_rx_time = now;
+        st.healthy_since = now;
+        st.angle_valid = false;
+        st.is_init = true;
+    }
+
+    //反馈超时
+    bool new_frame = sample.rx_cnt != st.last_rx_cnt;
+    if(new_frame)
+    {
+        //编码器跳变：两帧之间的角度变化远大于转速积分。上电、清除后的第一帧只记录角度，
+        //此前的角度可能是还没有收到反馈的初值或者修改零点之前的值
+        if(th.encoder_jump > 0 && st.angle_valid)
+        {
+            float expect = sample.speed * (float)(now - st.last_rx_time) * 1e-6f;
+            float jump = sample.angle - st.last_angle - expect;
+            if(jump > th.encoder_jump || jump < -th.encoder_jump)
+                active |= FAULT_ENCODER_JUMP;
+        }
+        st.last_rx_cnt = sample.rx_cnt;
+        st.last_rx_time = now;
+        st.last_angle = sample.angle;
+        st.angle_valid = true;
+    }
+    else if(th.stale_us > 0 && (now - st.last_rx_time) > th.stale_us)
+    {
+        active |= FAULT_STALE;
+    }
+
+    //过流、过温
+    float current = sample.current < 0 ? -sample.current : sample.current;
+    if(Debounce(&st.current_since, th.current_max > 0 && current > th.current_max, now, th.debounce_us))
+        active |= FAULT_OVER_CURRENT;
+
+    //过温恢复时留5度回差
+    float temp_limit = (st.faults & FAULT_OVER_TEMP) ? th.temp_max - 5 : th.temp_max;
+    if(Debounce(&st.temp_since, th.temp_max > 0 && sample.temp > temp_limit, now, th.debounce_us))
+        active |= FAULT_OVER_TEMP;
+
+    //故障置位、恢复
+    uint8_t last = st.faults;
+    st.faults |= active;
+    if(active != FAULT_NONE)
+    {
+        st.healthy_since = now;
+    }
+    else if(st.faults != FAULT_NONE && th.recovery == FAULT_AUTO_CLEAR
+            && (now - st.healthy_since) >= th.recover_us)
+    {
+        st.faults &= FAULT_ENCODER_JUMP;
+    }
+
+    if(st.faults != last)
+    {
+        Summary_Update();
+        event_cnt++;
+        if(callback != 0)
+            callback(ch, st.faults);
+    }
+}
+
+
+/**
+ * @brief 清除一个通道锁存的故障，并从下一次Update重新开始检测(编码器跳变从下一帧反馈重新开始比较)。
+ *        修改舵向零点、重新回零时调用，没有故障时也会重新开始
+ */
+void Fault_Monitor::Clear(int ch)
+{
+    if(ch < 0 || ch >= channels)
+        return;
+
+    uint8_t last = state[ch].faults;
+    state[ch].faults = FAULT_NONE;
+    state[ch].current_since = 0;
+    state[ch].temp_since = 0;
+    state[ch].is_init = false;
+    if(last == FAULT_NONE)
+        return;
+
+    Summary_Update();
+    event_cnt++;
+    if(callback != 0)
+        callback(ch, FAULT_NONE);
+}
+
+
+void Fault_Monitor::Clear_All(void)
+{
+    for(int i=0; i<channels; i++)
+        Clear(i);
+}
+
+
+void Fault_Monitor::Summary_Update(void)
+{
+    all_faults = FAULT_NONE;
+    for(int i=0; i<channels; i++)
+        all_faults |= state[i].faults;
+}
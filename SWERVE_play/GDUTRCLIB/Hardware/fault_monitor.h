@@ -0,0 +1,103 @@
+/**
+ * @file fault_monitor.h
+ * @author Yang JianYi
+ * @brief 电机故障监测。每个电机一个通道，每个控制周期调用一次Update传入该电机的反馈，整体耗时O(电机数)。
+ *        检测项：过流、过温、反馈超时(CAN帧计数不再增加)、编码器跳变(角度变化与转速积分不符)。
+ *        过流、过温需要持续debounce_us才置位；故障置位后锁存，按Fault_Threshold_t::recovery决定恢复方式：
+ *        FAULT_AUTO_CLEAR 故障条件消失recover_us后自动清除；FAULT_LATCH 必须调用Clear()清除。
+ *        编码器跳变说明舵向零点已经不可信，始终锁存，重新回零(Swerve_Chassis::Rehome)或调参工具的reset命令清除。
+ *        故障发生和清除时调用注册的回调(事件驱动，例如蜂鸣器)，查询接口只读取已经算好的标志位。
+ * @version 0.1
+ * @date 2024-06-14
+ *
+ * @copyright Copyright (c) 2024
+ *
+ */
+#pragma once
+#ifdef __cplusplus
+
+#include <stdint.h>
+
+#define FAULT_MAX_CHANNEL 8
+
+//故障类型，按位组合
+#define FAULT_NONE          0x00
+#define FAULT_OVER_CURRENT  0x01
+#define FAULT_OVER_TEMP     0x02
+#define FAULT_STALE         0x04
+#define FAULT_ENCODER_JUMP  0x08
+
+typedef enum FAULT_RECOVERY
+{
+    FAULT_AUTO_CLEAR,
+    FAULT_LATCH
+}FAULT_RECOVERY;
+
+//单个电机的故障阈值，阈值为0表示不检测该项
+typedef struct Fault_Threshold_t
+{
+    float current_max;          //电流上限，单位与Fault_Sample_t::current相同
+    float temp_max;             //温度上限，度
+    uint32_t stale_us;          //反馈超时时间，us
+    float encoder_jump;         //单次反馈的角度变化与转速积分之差的上限，度
+    uint32_t debounce_us;       //过流、过温持续该时间才认为故障
+    uint32_t recover_us;        //自动恢复时，故障条件消失后等待的时间
+    FAULT_RECOVERY recovery;
+}Fault_Threshold_t;
+
+//单个电机本周期的反馈
+typedef struct Fault_Sample_t
+{
+    float current;
+    float temp;
+    float angle;                //度
+    float speed;                //度/s，用于编码器跳变检测
+    uint32_t rx_cnt;            //CAN帧计数，不变说明没有收到新的反馈
+}Fault_Sample_t;
+
+//故障事件回调，faults为该通道当前的故障位，为0表示已恢复
+typedef void (*Fault_Callback)(int ch, uint8_t faults);
+
+class Fault_Monitor
+{
+public:
+    Fault_Monitor(){}
+
+    int Add_Channel(const Fault_Threshold_t &threshold);
+    void Update(int ch, const Fault_Sample_t &sample, uint32_t now);
+    void Clear(int ch);
+    void Clear_All(void);
+    void Callback_Regist(Fault_Callback fun) { callback = fun; }
+
+    uint8_t get_faults(int ch) const { return (ch >= 0 && ch < channels) ? state[ch].faults : FAULT_NONE; }
+    uint8_t get_all(void) const { return all_faults; }
+    bool is_ok(void) const { return all_faults == FAULT_NONE; }
+    uint32_t get_event_cnt(void) const { return event_cnt; }
+
+    Fault_Threshold_t threshold[FAULT_MAX_CHANNEL];
+
+private:
+    typedef struct
+    {
+        uint8_t faults;             //锁存的故障位
+        uint32_t current_since;     //过流开始时间，0表示未过流
+        uint32_t temp_since;
+        uint32_t healthy_since;     //故障条件全部消失的时间
+        uint32_t last_rx_cnt;
+        uint32_t last_rx_time;
+        float last_angle;
+        bool angle_valid;           //last_angle来自收到的反馈帧
+        bool is_init;
+    }Channel_State_t;
+
+    Channel_State_t state[FAULT_MAX_CHANNEL];
+    int channels = 0;
+    uint8_t all_faults = FAULT_NONE;    //所有通道故障位的或，供底盘快速查询
+    uint32_t event_cnt = 0;
+    Fault_Callback callback = 0;
+
+    bool Debounce(uint32_t *since, bool active, uint32_t now, uint32_t debounce_us);
+    void Summary_Update(void);
+};
+
+#endif
@@ -0,0 +1,305 @@
+/**
+ * @file kinematics.h
+ * @author Yang JianYi
+ * @brief 底盘运动学的公共部分，舵轮、全向轮、麦轮底盘共用。坐标系：x向前，y向左，逆时针为正。
+ *        每个轮子(或舵轮模组)用它在底盘坐标系中的安装位置描述，逆运动学的每一行都是底盘速度(vx, vy, wz)的线性组合：
+ *        1) 全向轮/麦轮 Add_Wheel：轮子的滚动方向为drive_angle，轮面线速度 = (v + wz × p)·u，
+ *           u = d + k*n，d为滚动方向，n为d逆时针旋转90度，k为辊子系数(全向轮为0，45度辊子的麦轮为±1)；
+ *        2) 舵轮模组 Add_Module：模组接地点的速度(vx_i, vy_i) = v + wz × p，占两行，舵向角和轮速由该矢量得到。
+ *        正运动学(里程计)用逆运动学矩阵的伪逆 (A^T A)^-1 A^T 求最小二乘解，伪逆在构造时计算一次，
+ *        运行时只有 3*行数 次乘加。
+ *        轮子数和行数为模板参数，存储空间按实际大小分配，运行时的循环在编译期展开。
+ *        底盘的运动学策略：Omni_Kinematics<N>、Mecanum_Kinematics、Swerve_Kinematics<N>，在构造函数中添加轮子。
+ *        输出的轮速单位为m/s，换算到电机转速由各底盘自己处理(减速比、电机速度单位不同)。
+ * @version 0.1
+ * @date 2024-06-10
+ *
+ * @copyright Copyright (c) 2024
+ *
+ */
+#pragma once
+#ifdef __cplusplus
+
+#include "data_pool.h"
+#include "fastmath.h"
+
+/**
+ * @brief 编译期展开的循环，Unroll<0, N>::Run(f) 依次调用 f(0) ... f(N-1)
+ */
+template<int I, int N>
+struct Unroll
+{
+    template<class Fun>
+    static inline void Run(const Fun &f)
+    {
+        f(I);
+        Unroll<I+1, N>::Run(f);
+    }
+};
+
+template<int N>
+struct Unroll<N, N>
+{
+    template<class Fun>
+    static inline void Run(const Fun &f) {}
+};
+
+
+template<int N_ENTRY, int N_ROWS>
+class Chassis_Kinematics
+{
+public:
+    static const int WHEELS = N_ENTRY;  //轮子(模组)数
+    static const int ROWS = N_ROWS;     //逆运动学输出的行数，舵轮模组每个占两行
+
+    /**
+     * @brief 单个全向轮/麦轮的轮面线速度，m/s
+     */
+    float Wheel_Speed(Robot_Twist_t twist, int index) const
+    {
+        return Row_Dot(twist, first_row[index]);
+    }
+
+    /**
+     * @brief 单个舵轮模组接地点的速度矢量，m/s
+     */
+    void Module_Velocity(Robot_Twist_t twist, int index, float *vx, float *vy) const
+    {
+        *vx = Row_Dot(twist, first_row[index]);
+        *vy = Row_Dot(twist, first_row[index]+1);
+    }
+
+    /**
+     * @brief 逆运动学，按行输出
+     * @param out 输出数组，长度为ROWS
+     */
+    void Inverse(Robot_Twist_t twist, float *out) const
+    {
+        Unroll<0, N_ROWS>::Run([&](int i){ out[i] = Row_Dot(twist, i); });
+    }
+
+    /**
+     * @brief 底盘速度为twist时所有轮子中最大的轮面线速度(绝对值)，舵轮模组取速度矢量的模，用于轮速饱和处理
+     */
+    float Peak(Robot_Twist_t twist) const
+    {
+        float peak = 0;
+        Unroll<0, N_ENTRY>::Run([&](int i)
+        {
+            float v;
+            if(is_module[i])
+            {
+                float vx = Row_Dot(twist, first_row[i]);
+                float vy = Row_Dot(twist, first_row[i]+1);
+                v = fast_sqrtf(vx*vx + vy*vy);
+            }
+            else
+            {
+                v = Row_Dot(twist, first_row[i]);
+                if(v < 0)
+                    v = -v;
+            }
+
+            if(v > peak)
+                peak = v;
+        });
+        return peak;
+    }
+
+    /**
+     * @brief 正运动学，由各轮实测速度求底盘速度的最小二乘解
+     *
+     * @param measure 各行的实测值，排列与Inverse()的输出相同，舵轮模组为(v*cos(angle), v*sin(angle))
+     * @param twist 输出，只写linear.x、linear.y、angular.z
+     * @return false 轮子布置不足以确定底盘速度
+     */
+    bool Forward(const float *measure, Robot_Twist_t *twist) const
+    {
+        if(pinv_valid == false)
+            return false;
+
+        float res[3] = {0};
+        Unroll<0, N_ROWS>::Run([&](int i)
+        {
+            res[0] += pinv[0][i] * measure[i];
+            res[1] += pinv[1][i] * measure[i];
+            res[2] += pinv[2][i] * measure[i];
+        });
+
+        twist->linear.x = res[0];
+        twist->linear.y = res[1];
+        twist->angular.z = res[2];
+        return true;
+    }
+
+protected:
+    Chassis_Kinematics(){}
+
+    /**
+     * @brief 添加一个全向轮或麦轮
+     *
+     * @param px 轮子接地点的x坐标，m
+     * @param py 轮子接地点的y坐标，m
+     * @param drive_angle 电机正转时轮子的滚动方向，rad，0为x正方向
+     * @param roller_k 辊子系数，全向轮为0，45度辊子的麦轮为±1，符号由辊子的倾斜方向决定
+     */
+    bool Add_Wheel(float px, float py, float drive_angle, float roller_k = 0)
+    {
+        if(entries >= N_ENTRY || rows + 1 > N_ROWS)
+            return false;
+
+        float s, c;
+        fast_sincosf(drive_angle, &s, &c);
+        float ux = c - roller_k*s;
+        float uy = s + roller_k*c;
+
+        A[rows][0] = ux;
+        A[rows][1] = uy;
+        A[rows][2] = -py*ux + px*uy;
+
+        first_row[entries] = rows;
+        is_module[entries] = false;
+        rows += 1;
+        entries++;
+        return true;
+    }
+
+    /**
+     * @brief 添加一个舵轮模组
+     *
+     * @param px 模组接地点的x坐标，m
+     * @param py 模组接地点的y坐标，m
+     */
+    bool Add_Module(float px, float py)
+    {
+        if(entries >= N_ENTRY || rows + 2 > N_ROWS)
+            return false;
+
+        A[rows][0] = 1;
+        A[rows][1] = 0;
+        A[rows][2] = -py;
+        A[rows+1][0] = 0;
+        A[rows+1][1] = 1;
+        A[rows+1][2] = px;
+
+        first_row[entries] = rows;
+        is_module[entries] = true;
+        rows += 2;
+        entries++;
+        return true;
+    }
+
+    /**
+     * @brief 计算伪逆 (A^T A)^-1 A^T，所有轮子添加完后调用。A^T A为3x3对称矩阵，用伴随矩阵求逆
+     */
+    void Pinv_Update(void)
+    {
+        float M[3][3] = {{0}}, inv[3][3];
+
+        for(int i=0; i<3; i++)
+            for(int j=0; j<3; j++)
+                for(int k=0; k<rows; k++)
+                    M[i][j] += A[k][i]*A[k][j];
+
+        inv[0][0] = M[1][1]*M[2][2] - M[1][2]*M[2][1];
+        inv[0][1] = M[0][2]*M[2][1] - M[0][1]*M[2][2];
+        inv[0][2] = M[0][1]*M[1][2] - M[0][2]*M[1][1];
+        inv[1][0] = M[1][2]*M[2][0] - M[1][0]*M[2][2];
+        inv[1][1] = M[0][0]*M[2][2] - M[0][2]*M[2][0];
+        inv[1][2] = M[0][2]*M[1][0] - M[0][0]*M[1][2];
+        inv[2][0] = M[1][0]*M[2][1] - M[1][1]*M[2][0];
+        inv[2][1] = M[0][1]*M[2][0] - M[0][0]*M[2][1];
+        inv[2][2] = M[0][0]*M[1][1] - M[0][1]*M[1][0];
+
+        float det = M[0][0]*inv[0][0] + M[0][1]*inv[1][0] + M[0][2]*inv[2][0];
+        if(det < 1e-9f && det > -1e-9f)
+        {
+            pinv_valid = false;
+            return;
+        }
+
+        for(int i=0; i<3; i++)
+            for(int k=0; k<rows; k++)
+            {
+                float sum = 0;
+                for(int j=0; j<3; j++)
+                    sum += inv[i][j]*A[k][j];
+                pinv[i][k] = sum / det;
+            }
+        pinv_valid = true;
+    }
+
+private:
+    float A[N_ROWS][3] = {{0}};         /*!< 逆运动学矩阵，每行对应(vx, vy, wz)的系数 */
+    float pinv[3][N_ROWS] = {{0}};      /*!< A的伪逆，用于正运动学 */
+    uint8_t first_row[N_ENTRY] = {0};   /*!< 每个轮子(模组)在A中的第一行 */
+    bool is_module[N_ENTRY] = {false};
+    int rows = 0;
+    int entries = 0;
+    bool pinv_valid = false;
+
+    float Row_Dot(Robot_Twist_t twist, int row) const
+    {
+        return A[row][0]*twist.linear.x + A[row][1]*twist.linear.y + A[row][2]*twist.angular.z;
+    }
+};
+
+
+/**
+ * @brief 全向轮底盘，轮子沿切向安装在半径为Chassis_Radius的圆上，滚动方向为安装角度+90度
+ *        3轮：安装角度30、120、-90度；4轮：安装角度-135、135、45、-45度
+ */
+template<int N>
+class Omni_Kinematics : public Chassis_Kinematics<N, N>
+{
+public:
+    Omni_Kinematics(float Chassis_Radius)
+    {
+        static_assert(N == 3 || N == 4, "omni chassis supports 3 or 4 wheels");
+        const float angle_3[3] = {FAST_PI/6, 2*FAST_PI/3, -FAST_HALF_PI};
+        const float angle_4[4] = {-3*FAST_PI/4, 3*FAST_PI/4, FAST_PI/4, -FAST_PI/4};
+        const float *angle = (N == 3) ? angle_3 : angle_4;
+
+        for(int i=0; i<N; i++)
+            this->Add_Wheel(Chassis_Radius*fast_cosf(angle[i]), Chassis_Radius*fast_sinf(angle[i]), angle[i]+FAST_HALF_PI);
+        this->Pinv_Update();
+    }
+};
+
+
+/**
+ * @brief 麦轮底盘，轮子顺序为左前、右前、右后、左后。辊子从上往下看呈X形，右侧电机镜像安装，正转时轮子向后滚动
+ *
+ * @param Wheel_Track 左右轮距
+ * @param Wheel_Base 前后轴距
+ */
+class Mecanum_Kinematics : public Chassis_Kinematics<4, 4>
+{
+public:
+    Mecanum_Kinematics(float Wheel_Track, float Wheel_Base)
+    {
+        Add_Wheel( Wheel_Base/2,  Wheel_Track/2, 0,        -1);
+        Add_Wheel( Wheel_Base/2, -Wheel_Track/2, FAST_PI,   1);
+        Add_Wheel(-Wheel_Base/2, -Wheel_Track/2, FAST_PI,  -1);
+        Add_Wheel(-Wheel_Base/2,  Wheel_Track/2, 0,         1);
+        Pinv_Update();
+    }
+};
+
+
+/**
+ * @brief 舵轮底盘，模组安装位置由x、y坐标数组给出
+ */
+template<int N>
+class Swerve_Kinematics : public Chassis_Kinematics<N, 2*N>
+{
+public:
+    Swerve_Kinematics(const float (&px)[N], const float (&py)[N])
+    {
+        for(int i=0; i<N; i++)
+            this->Add_Module(px[i], py[i]);
+        this->Pinv_Update();
+    }
+};
+
+#endif
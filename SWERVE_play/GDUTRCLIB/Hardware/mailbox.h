@@ -0,0 +1,96 @@
+/**
+ * @file mailbox.h
+ * @author Yang JianYi
+ * @brief 最新值邮箱，用于设定值、状态这类只关心最新一份的数据，事件流(CAN、串口发送、调参请求)仍用队列。
+ *        与队列不同，写入总是覆盖上一份：生产者比消费者快时消费者直接拿到最新值，不会按顺序执行过时的数据，
+ *        也不会因为队列满而丢掉最新的一份。每次写入带一个序号(写入次数)和时间戳，读取方用序号判断有没有新数据。
+ *        实现为DEPTH+1块缓存的顺序锁(默认DEPTH=1，两块)：写入方写不在读取范围内的那一块，写完再更新序号；
+ *        读取方读序号指向的那一块，读完时开始写的次数比这个序号前进不到DEPTH+1，说明这一块没有被改写
+ *        (连被打断后写了一半都没有)，否则重读。
+ *        1) 读取方优先级高于写入方时，写入方被打断在写的是另一块，读取方不会等待写入方，不会死锁；
+ *        2) 只有读取的过程中写入方又开始了DEPTH+1次写入才会重读，不需要关中断，写入、读取都可以在中断中调用。
+ *        每个邮箱只能有一个写入方(一个任务或一个中断)，读取方数量不限。
+ *        DEPTH>1时保留最近DEPTH份，可以用Read_At按序号读取，话题(topic.h)在此基础上增加登记和统计。
+ *        写入和读取都按值拷贝一份数据，数据较大时注意拷贝的时间。
+ * @version 0.1
+ * @date 2024-06-27
+ *
+ * @copyright Copyright (c) 2024
+ *
+ */
+#pragma once
+#ifdef __cplusplus
+
+#include <stdint.h>
+#include <stddef.h>
+#include "stm32f4xx.h"
+
+template<typename T, int DEPTH = 1>
+class Mailbox
+{
+public:
+    Mailbox(){}
+
+    /**
+     * @brief 写入新值，覆盖最早的一份
+     * @param stamp 数据的时刻，us
+     */
+    void Write(const T &value, uint32_t stamp)
+    {
+        uint32_t next = seq + 1;
+        writing = next;
+        __DMB();
+        slot[next % SLOTS].value = value;
+        slot[next % SLOTS].stamp = stamp;
+        __DMB();
+        seq = next;
+    }
+
+    /**
+     * @brief 读取最新值
+     * @param stamp 不为NULL时输出写入时的时间戳
+     * @return uint32_t 序号，即写入的次数，0表示还没有写入过(value不变)
+     */
+    uint32_t Read(T *value, uint32_t *stamp = NULL) const
+    {
+        uint32_t n;
+        do
+        {
+            n = seq;
+            if(n == 0)
+                return 0;
+        }while(Read_At(n, value, stamp) == false);
+        return n;
+    }
+
+    /**
+     * @brief 读取序号为n的数据
+     * @return bool false表示已被覆盖(或正在被改写)，或者还没有写入，此时value、stamp的内容无效
+     */
+    bool Read_At(uint32_t n, T *value, uint32_t *stamp = NULL) const
+    {
+        if(n == 0 || (int32_t)(seq - n) < 0)
+            return false;
+        __DMB();
+        *value = slot[n % SLOTS].value;
+        if(stamp != NULL)
+            *stamp = slot[n % SLOTS].stamp;
+        __DMB();
+        return writing - n < (uint32_t)SLOTS;
+    }
+
+    uint32_t get_seq(void) const { return seq; }
+    const volatile uint32_t *get_seq_addr(void) const { return &seq; }     //话题登记后用于统计，不复制计数
+
+private:
+    enum { SLOTS = DEPTH + 1 };
+    struct
+    {
+        T value;
+        uint32_t stamp;
+    }slot[SLOTS];
+    volatile uint32_t seq = 0;          //写完的次数，slot[seq % SLOTS]为最新值
+    volatile uint32_t writing = 0;      //开始写的次数，比seq大1时正在写下一块
+};
+
+#endif
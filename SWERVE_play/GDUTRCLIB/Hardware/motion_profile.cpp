@@ -0,0 +1,171 @@
+/**
+ * @file motion_profile.cpp
+ * @author Yang JianYi
+ * @brief 底盘速度规划器的实现。每个控制周期调用一次Update，传入目标速度和周期时间，返回本周期应执行的速度。
+ *        规划方法：
+ *        1) 计算速度误差矢量e，期望加速度沿e的方向，大小取 min(|e|/dt, 加速度上限, sqrt(2*J*|e|))，
+ *           最后一项保证加速度能在到达目标速度时刚好减到0(S型曲线的减速段)；
+ *        2) 加速度的变化量受jerk上限约束，按同一比例缩放各轴，保证加速度方向不被单轴限幅扭曲；
+ *        3) 速度越过目标时直接取目标值，避免在目标附近振荡。
+ * @version 0.1
+ * @date 2024-06-05
+ *
+ * @copyright Copyright (c) 2024
+ *
+ */
+#include "motion_profile.h"
+#include "fastmath.h"
+
+#define PROFILE_EPS 1e-4f
+
+
+/**
+ * @brief 计算沿单位方向u可用的最大标量值，每个轴的上限为limit[i]，为0的轴不限制
+ * @return 不受限制时返回-1
+ */
+static float Direction_Limit(const float *u, const float *limit, int n)
+{
+    float res = -1;
+    for(int i=0; i<n; i++)
+    {
+        float au = u[i] < 0 ? -u[i] : u[i];
+        if(limit[i] > 0 && au > PROFILE_EPS)
+        {
+            float l = limit[i] / au;
+            if(res < 0 || l < res)
+                res = l;
+        }
+    }
+    return res;
+}
+
+
+/**
+ * @brief 对n维速度矢量进行一步规划
+ */
+void TwistProfiler::Step(float *v, float *a, const float *target, const float *a_max, const float *j_max, int n, float dt)
+{
+    float e[2], u[2], a_des[2], da[2];
+    float e_norm = 0;
+
+    for(int i=0; i<n; i++)
+    {
+        e[i] = target[i] - v[i];
+        e_norm += e[i]*e[i];
+    }
+    e_norm = fast_sqrtf(e_norm);
+
+    //期望加速度，方向沿速度误差
+    float a_mag = 0;
+    if(e_norm > PROFILE_EPS)
+    {
+        for(int i=0; i<n; i++)
+            u[i] = e[i] / e_norm;
+
+        a_mag = e_norm / dt;
+
+        float a_lim = Direction_Limit(u, a_max, n);
+        if(a_lim >= 0 && a_mag > a_lim)
+            a_mag = a_lim;
+
+        float j_lim = Direction_Limit(u, j_max, n);
+        if(j_lim >= 0)
+        {
+            float a_brake = fast_sqrtf(2*j_lim*e_norm);
+            if(a_mag > a_brake)
+                a_mag = a_brake;
+        }
+    }
+    else
+    {
+        for(int i=0; i<n; i++)
+            u[i] = 0;
+    }
+
+    //加速度变化量按jerk上限同比例缩放
+    float k = 1;
+    for(int i=0; i<n; i++)
+    {
+        a_des[i] = u[i] * a_mag;
+        da[i] = a_des[i] - a[i];
+        float ada = da[i] < 0 ? -da[i] : da[i];
+        if(j_max[i] > 0 && ada*k > j_max[i]*dt)
+            k = j_max[i]*dt / ada;
+    }
+
+    float overshoot = 0;
+    for(int i=0; i<n; i++)
+    {
+        a[i] += k * da[i];
+        v[i] += a[i] * dt;
+        overshoot += (target[i] - v[i]) * e[i];
+    }
+
+    //越过目标速度
+    if(overshoot <= 0)
+    {
+        for(int i=0; i<n; i++)
+        {
+            v[i] = target[i];
+            a[i] = 0;
+        }
+    }
+}
+
+
+/**
+ * @brief 速度规划
+ *
+ * @param target 目标速度
+ * @param dt 控制周期，s
+ * @return Robot_Twist_t 规划后的速度，chassis_mode与target相同
+ */
+Robot_Twist_t TwistProfiler::Update(Robot_Twist_t target, float dt)
+{
+    if(dt > 0)
+    {
+        float lin_target[2] = {target.linear.x, target.linear.y};
+        float lin_a_max[2] = {Accel_Max.linear.x*Accel_Scale, Accel_Max.linear.y*Accel_Scale};
+        float lin_j_max[2] = {Jerk_Max.linear.x, Jerk_Max.linear.y};
+        float ang_a_max = Accel_Max.angular.z*Accel_Scale;
+        Step(&vel[0], &acc[0], lin_target, lin_a_max, lin_j_max, 2, dt);
+        Step(&vel[2], &acc[2], &target.angular.z, &ang_a_max, &Jerk_Max.angular.z, 1, dt);
+    }
+
+    Robot_Twist_t res = get_velocity();
+    res.chassis_mode = target.chassis_mode;
+    return res;
+}
+
+
+/**
+ * @brief 规划器清零，底盘重置或急停后调用
+ */
+void TwistProfiler::Reset(void)
+{
+    for(int i=0; i<3; i++)
+    {
+        vel[i] = 0;
+        acc[i] = 0;
+    }
+}
+
+
+Robot_Twist_t TwistProfiler::get_velocity() const
+{
+    Robot_Twist_t res = {0};
+    res.linear.x = vel[0];
+    res.linear.y = vel[1];
+    res.angular.z = vel[2];
+    return res;
+}
+
+
+Robot_Twist_t TwistProfiler::get_accel() const
+{
+    Robot_Twist_t res = {0};
+    res.linear.x = acc[0];
+    res.linear.y = acc[1];
+    res.angular.z = acc[2];
+    return res;
+}
@@ -0,0 +1,39 @@
+/**
+ * @file motion_profile.h
+ * @author Yang JianYi
+ * @brief 底盘速度规划器，在逆运动学解算之前对(vx, vy, wz)进行加速度和加加速度(jerk)限制，得到S型速度曲线。
+ *        平移速度(vx, vy)作为一个矢量进行规划，x、y两轴按同一比例缩放，保证加速过程中底盘的运动方向不变；
+ *        旋转速度wz单独规划。各轴的限制值独立配置，限制值为0表示该项不限制。
+ * @version 0.1
+ * @date 2024-06-05
+ *
+ * @copyright Copyright (c) 2024
+ *
+ */
+#pragma once
+#ifdef __cplusplus
+
+#include "data_pool.h"
+
+class TwistProfiler
+{
+public:
+    TwistProfiler(){}
+
+    Robot_Twist_t Accel_Max = {0};  /*!< 各轴最大加速度，m/s^2 或 rad/s^2 */
+    Robot_Twist_t Jerk_Max = {0};   /*!< 各轴最大加加速度，m/s^3 或 rad/s^3 */
+    float Accel_Scale = 1;          /*!< 加速度上限的缩放系数(0~1]，电流预算不足时由底盘降低 */
+
+    Robot_Twist_t Update(Robot_Twist_t target, float dt);
+    void Reset(void);
+
+    Robot_Twist_t get_velocity() const;
+    Robot_Twist_t get_accel() const;
+
+private:
+    float vel[3] = {0};     /*!< 规划器输出的速度 vx, vy, wz */
+    float acc[3] = {0};     /*!< 规划器当前的加速度 */
+    void Step(float *v, float *a, const float *target, const float *a_max, const float *j_max, int n, float dt);
+};
+
+#endif
@@ -57,6 +57,7 @@ public:
     virtual bool check_id(uint32_t StdID) const { return StdID == this->receive_id_init() + (uint8_t)ID; }
     float get_angle() const { return angle; }
 	float get_encoder() const { return encoder; }
+    uint32_t get_rx_cnt() const { return rx_cnt; }  /*!< 收到的反馈帧计数，用于反馈超时检测 */
 
     float encoder_offset = 0;
     float motor_descritoion = 1.0f;
@@ -65,6 +66,7 @@ public:
 protected:
     float angle = 0,  last_encoder = 0;
     bool encoder_is_init = false;
+    uint32_t rx_cnt = 0;
 
     virtual uint32_t receive_id_init() const { return 0; };
     virtual uint8_t motor_descritoion_init() const {return 1; };
@@ -90,6 +92,15 @@ protected:
         angle = total_encoder / ENCODER_ANGLE_RATIO();
     }
 
+    //重新开始多圈计数，last为下一帧判断过圈的基准，角度取离零点最近的一圈(-180~180度)
+    void turn_reset(uint16_t last)
+    {
+        int32_t diff = (int32_t)last - (int32_t)encoder_offset;
+        round_cnt = diff > 4096 ? -1 : (diff < -4096 ? 1 : 0);
+        last_encoder = last;
+        angle = (round_cnt*8192 + diff) / ENCODER_ANGLE_RATIO();
+    }
+
 private:
     int32_t round_cnt = 0;
     virtual int16_t ENCODER_MAX() const { return 8192; }
@@ -129,6 +140,7 @@ public:
         update_angle(can_rx_data);
         update_speed(can_rx_data);
         this->tarque = (int16_t)(can_rx_data[4] << 8 | can_rx_data[5]);    
+        this->rx_cnt++;
     }
     int16_t get_tarque() const { return this->tarque; }
     uint8_t get_temperature() const { return this->temperature; }
@@ -154,6 +166,8 @@ public:
         update_angle(can_rx_data);
         update_speed(can_rx_data);
         this->tarque = (int16_t)(can_rx_data[4] << 8 | can_rx_data[5]);    
+        this->temperature = can_rx_data[6];
+        this->rx_cnt++;
     }
 private:
     int16_t tarque = 0;
@@ -165,17 +179,20 @@ class Motor_GM6020 : public Motor_Speed
 {
 public:
     virtual ~Motor_GM6020(){}
-    virtual uint32_t recieve_id_init() const { return 0x204; }
+    virtual uint32_t receive_id_init() const { return 0x204; }
     virtual uint32_t send_id_low() const { return 0x1ff; }
     virtual uint32_t send_id_high() const { return 0x2ff; }
     virtual float MAX_CURRENT() const { return 30000; }
     uint16_t set_encoder_offset(uint16_t offset)
     {
         this->encoder_offset = offset;
-        this->last_encoder = offset;  
         this->encoder_is_init = true;
+        this->offset_is_set = true;
+        //运行中修改零点时从当前编码器值重新计圈，避免下一帧与零点比较多算一圈；还没有反馈时第一帧与零点比较
+        this->turn_reset(this->rx_cnt != 0 ? this->encoder : offset);
         return this->encoder;
     }
+    bool is_offset_set() const { return this->offset_is_set; }     //零点已标定，角度为绝对角度
     Motor_GM6020(uint8_t id) : Motor_Speed(id){}
     virtual void update(uint8_t can_rx_data[])
     {
@@ -183,6 +200,7 @@ public:
         this->update_speed(can_rx_data);
         this->tarque = (int16_t)(can_rx_data[4] << 8 | can_rx_data[5]);
         this->temperature = can_rx_data[6]; 
+        this->rx_cnt++;
     }
 
     int16_t get_tarque() const { return this->tarque; }
@@ -190,6 +208,7 @@ public:
 private:
     int16_t tarque = 0;
     uint8_t temperature = 0;
+    bool offset_is_set = false;
 };
 
 
@@ -206,10 +225,16 @@ public:
         {
             cmd = (Buffer->header.ExtId >> 8);   //获取对应的帧头
             update(Buffer->data);
+            this->rx_cnt++;
         }
     }
     virtual int32_t get_speed() const { return this->speed; }
     int16_t get_tarque() const { return this->tarque; }
+    float get_current() const { return this->tarque; }     //电机电流，mA
+    float get_temp_fet() const { return this->temp_fet; }
+    float get_temp_motor() const { return this->temp_motor; }
+    float get_input_current() const { return this->current_in; }
+    float get_voltage() const { return this->voltage_in; }
 
 protected:
     virtual void update(uint8_t can_rx_data[])
@@ -221,6 +246,10 @@ protected:
                 break;
             case CAN_PACKET_STATUS_4:
                 update_angle(can_rx_data);
+                update_status_4(can_rx_data);
+                break;
+            case CAN_PACKET_STATUS_5:
+                update_status_5(can_rx_data);
                 break;
             default:
                 break;
@@ -240,12 +269,32 @@ protected:
         angle = (float)(can_rx_data[6] << 8 | can_rx_data[7])/50.0f;
     }
 
+    //STATUS_4：MOS温度、电机温度、输入电流，需要在VESC Tool中打开STATUS_4的发送
+    void update_status_4(uint8_t can_rx_data[])
+    {
+        index=0;
+        this->temp_fet = (float)_tool_buffer_get_int16(can_rx_data, &index)/10.0f;
+        this->temp_motor = (float)_tool_buffer_get_int16(can_rx_data, &index)/10.0f;
+        this->current_in = (float)_tool_buffer_get_int16(can_rx_data, &index)/10.0f;   //A
+    }
+
+    //STATUS_5：转速计、母线电压，需要在VESC Tool中打开STATUS_5的发送
+    void update_status_5(uint8_t can_rx_data[])
+    {
+        index=4;
+        this->voltage_in = (float)_tool_buffer_get_int16(can_rx_data, &index)/10.0f;   //V
+    }
+
 private:
     uint8_t ID_check;
     uint16_t cmd;
     int index=0;
     float tarque=0;
     float duty=0;
+    float temp_fet=0;
+    float temp_motor=0;
+    float current_in=0;
+    float voltage_in=0;
 };
 
 
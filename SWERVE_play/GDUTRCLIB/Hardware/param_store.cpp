@@ -0,0 +1,390 @@
+/**
+ * @file param_store.cpp
+ * @author Yang JianYi
+ * @brief 参数存储的实现。flash擦除后为0xFF，编程只能把1写成0，所以记录头的magic放在最后单独编程：
+ *        magic为0xFFFFFFFF而后面已经有数据的记录是掉电时没写完的，按条目数跳过；条目数也不可信时把扇区标记为dirty。
+ * @version 0.1
+ * @date 2024-06-16
+ *
+ * @copyright Copyright (c) 2024
+ *
+ */
+#include "param_store.h"
+#include "crc.h"
+#include "FreeRTOS.h"
+#include "task.h"
+
+#define HEAD_WORDS  (sizeof(Record_Head_t)/4)
+#define BLANK       0xFFFFFFFFU
+
+Param_Store param_store;
+
+
+int Param_Store::Regist(const char *name, float *addr, float min, float max)
+{
+    return Add(name, PARAM_FLOAT, addr, min, max);
+}
+
+
+int Param_Store::Regist(const char *name, int32_t *addr, int32_t min, int32_t max)
+{
+    return Add(name, PARAM_INT32, addr, (float)min, (float)max);
+}
+
+
+int Param_Store::Regist(const char *name, uint32_t *addr, uint32_t min, uint32_t max)
+{
+    return Add(name, PARAM_UINT32, addr, (float)min, (float)max);
+}
+
+
+/**
+ * @brief 登记一个参数，同名参数重复登记时只更新地址和范围
+ * @return int 参数序号，注册表已满时返回-1
+ */
+int Param_Store::Add(const char *name, PARAM_TYPE type, void *addr, float min, float max)
+{
+    uint32_t id = (Hash(name) & ~0x3U) | (uint32_t)type;
+    int index = Find(name);
+
+    if(index < 0)
+    {
+        if(num >= PARAM_MAX_NUM)
+            return -1;
+        index = num++;
+    }
+
+    param[index].name = name;
+    param[index].id = id;
+    param[index].type = type;
+    param[index].addr = addr;
+    param[index].min = min;
+    param[index].max = max;
+    return index;
+}
+
+
+/**
+ * @brief 扫描两个扇区，把最新的有效记录加载到RAM，所有参数登记完后调用一次
+ * @return false flash中没有有效记录，参数保持默认值
+ */
+bool Param_Store::Load(void)
+{
+    Scan(&sector[0]);
+    Scan(&sector[1]);
+
+    if(sector[0].last == 0 && sector[1].last == 0)
+    {
+        //空的扇区之后直接追加；两个扇区都没有有效记录时从A开始
+        active = 0;
+        seq = 0;
+        loaded = false;
+        return false;
+    }
+
+    //序号按无符号差比较，回绕后仍然正确
+    if(sector[0].last == 0)
+        active = 1;
+    else if(sector[1].last == 0)
+        active = 0;
+    else
+        active = (int32_t)(sector[1].last_seq - sector[0].last_seq) > 0 ? 1 : 0;
+
+    const Record_Head_t *head = (const Record_Head_t *)sector[active].last;
+    const uint32_t *entry = (const uint32_t *)(head + 1);
+    uint32_t count = head->version_count & 0xFFFF;
+    seq = head->seq;
+
+    for(uint32_t i=0; i<count; i++)
+    {
+        for(int j=0; j<num; j++)
+        {
+            if(param[j].id == entry[2*i])
+            {
+                Value_Set(&param[j], entry[2*i+1]);
+                break;
+            }
+        }
+    }
+
+    loaded = true;
+    return true;
+}
+
+
+/**
+ * @brief 把所有参数的当前值保存为一条新记录
+ *        参数值在临界区内一次性拷贝，保存的是同一时刻的一组参数
+ * @return false 写入失败，flash中仍是上一条记录
+ */
+bool Param_Store::Commit(void)
+{
+    Record_Head_t *head = (Record_Head_t *)buff;
+    uint32_t *entry = buff + HEAD_WORDS;
+    uint32_t words = HEAD_WORDS + 2*num;
+
+    taskENTER_CRITICAL();
+    for(int i=0; i<num; i++)
+    {
+        entry[2*i] = param[i].id;
+        entry[2*i+1] = Value_Raw(&param[i]);
+    }
+    taskEXIT_CRITICAL();
+
+    head->magic = PARAM_MAGIC;
+    head->seq = seq + 1;
+    head->version_count = ((uint32_t)PARAM_VERSION << 16) | (uint32_t)num;
+    head->crc = Record_Crc(&head->seq, words - 1);
+
+    //当前扇区有空间时追加，否则(或追加失败)切换到另一个扇区，Prepare已经擦除过时不再擦除
+    Sector_State_t *s = &sector[active];
+    bool ok = false;
+    if(Has_Room(s))
+        ok = Write(s, words);
+
+    if(ok == false)
+    {
+        int other = active ^ 1;
+        s = &sector[other];
+        if(s->erased == false && Erase(s) == false)
+            return false;
+        if(Write(s, words) == false)
+            return false;
+        active = other;
+    }
+
+    seq = head->seq;
+    return true;
+}
+
+
+/**
+ * @brief 当前扇区放不下下一条记录时提前擦除另一个扇区，之后的Commit只需要编程。
+ *        需要擦除时CPU被挂起1~2s，只在机器人静止时调用；不需要擦除时立即返回
+ * @return false 擦除失败，下一次Commit时重试
+ */
+bool Param_Store::Prepare(void)
+{
+    if(Has_Room(&sector[active]))
+        return true;
+
+    Sector_State_t *s = &sector[active ^ 1];
+    return s->erased || Erase(s);
+}
+
+
+/**
+ * @brief 查找参数
+ * @return int 参数序号，不存在时返回-1
+ */
+int Param_Store::Find(const char *name) const
+{
+    for(int i=0; i<num; i++)
+    {
+        const char *a = param[i].name, *b = name;
+        while(*a != '\0' && *a == *b)
+        {
+            a++;
+            b++;
+        }
+        if(*a == *b)
+            return i;
+    }
+    return -1;
+}
+
+
+/**
+ * @brief 检查参数是否存在、值是否在范围内，不修改参数
+ */
+bool Param_Store::Check(int index, float value) const
+{
+    return index >= 0 && index < num && value >= param[index].min && value <= param[index].max;
+}
+
+
+/**
+ * @brief 修改参数的RAM值，不写flash
+ * @return false 参数不存在或超出范围
+ */
+bool Param_Store::Set(int index, float value)
+{
+    if(Check(index, value) == false)
+        return false;
+
+    Param_t *p = &param[index];
+    switch(p->type)
+    {
+        case PARAM_FLOAT:  *(float *)p->addr = value;               break;
+        case PARAM_INT32:  *(int32_t *)p->addr = (int32_t)value;    break;
+        case PARAM_UINT32: *(uint32_t *)p->addr = (uint32_t)value;  break;
+    }
+    return true;
+}
+
+
+float Param_Store::Get(int index) const
+{
+    if(index < 0 || index >= num)
+        return 0;
+
+    const Param_t *p = &param[index];
+    switch(p->type)
+    {
+        case PARAM_FLOAT:  return *(float *)p->addr;
+        case PARAM_INT32:  return (float)*(int32_t *)p->addr;
+        case PARAM_UINT32: return (float)*(uint32_t *)p->addr;
+    }
+    return 0;
+}
+
+
+/**
+ * @brief 扫描一个扇区，找到最新的有效记录和空闲位置
+ */
+void Param_Store::Scan(Sector_State_t *s)
+{
+    uint32_t addr = s->base, end = s->base + FLASH_PARAM_SECTOR_SIZE;
+
+    s->last = 0;
+    s->dirty = false;
+    s->erased = false;
+    while(addr + sizeof(Record_Head_t) <= end)
+    {
+        const Record_Head_t *head = (const Record_Head_t *)addr;
+        uint32_t count = head->version_count & 0xFFFF;
+        uint32_t words = HEAD_WORDS + 2*count;
+
+        if(head->magic == BLANK && head->seq == BLANK && head->version_count == BLANK && head->crc == BLANK)
+            break;      //空闲区
+
+        if((head->magic != PARAM_MAGIC && head->magic != BLANK) || head->version_count == BLANK
+           || addr + words*4 > end)
+        {
+            s->dirty = true;
+            break;
+        }
+
+        if(head->magic == PARAM_MAGIC && (head->version_count >> 16) == PARAM_VERSION
+           && Record_Crc(&head->seq, words - 1) == head->crc)
+        {
+            s->last = addr;
+            s->last_seq = head->seq;
+        }
+        addr += words*4;
+    }
+    s->free = addr;
+}
+
+
+/**
+ * @brief 擦除扇区，扇区中的旧记录全部丢弃
+ */
+bool Param_Store::Erase(Sector_State_t *s)
+{
+    if(Flash_Erase_Sector(s->sector) != HAL_OK)
+        return false;
+    s->free = s->base;
+    s->last = 0;
+    s->dirty = false;
+    s->erased = true;
+    return true;
+}
+
+
+/**
+ * @brief 扇区的空闲空间能否再写入一条完整的记录
+ */
+bool Param_Store::Has_Room(const Sector_State_t *s) const
+{
+    return s->dirty == false && s->free + (HEAD_WORDS + 2*num)*4 <= s->base + FLASH_PARAM_SECTOR_SIZE;
+}
+
+
+/**
+ * @brief 在扇区的空闲位置写入buff中的记录，magic最后写入
+ */
+bool Param_Store::Write(Sector_State_t *s, uint32_t words)
+{
+    uint32_t addr = s->free;
+
+    //写入失败时这部分空间已经不是0xFF，之后的记录从后面开始，扫描时按dirty处理
+    s->free += words*4;
+    s->erased = false;
+    if(Flash_Write_Words(addr + 4, buff + 1, words - 1) != HAL_OK
+       || Flash_Write_Word(addr, buff[0]) != HAL_OK)
+    {
+        s->dirty = true;
+        return false;
+    }
+
+    s->last = addr;
+    s->last_seq = buff[1];
+    return true;
+}
+
+
+/**
+ * @brief 从flash中的原始值设置参数，超出范围时保持原值
+ */
+bool Param_Store::Value_Set(Param_t *p, uint32_t raw)
+{
+    float value;
+    switch(p->type)
+    {
+        case PARAM_FLOAT:
+        {
+            union { uint32_t u; float f; } cvt;
+            cvt.u = raw;
+            value = cvt.f;
+            if(!(value >= p->min && value <= p->max))   //同时排除NaN
+                return false;
+            *(float *)p->addr = value;
+            return true;
+        }
+        case PARAM_INT32:
+            value = (float)(int32_t)raw;
+            break;
+        case PARAM_UINT32:
+            value = (float)raw;
+            break;
+        default:
+            return false;
+    }
+
+    if(value < p->min || value > p->max)
+        return false;
+    *(uint32_t *)p->addr = raw;
+    return true;
+}
+
+
+uint32_t Param_Store::Value_Raw(const Param_t *p) const
+{
+    return *(const uint32_t *)p->addr;
+}
+
+
+/**
+ * @brief FNV-1a哈希，参数名改变即视为新参数
+ */
+uint32_t Param_Store::Hash(const char *name)
+{
+    uint32_t hash = 2166136261U;
+    while(*name != '\0')
+    {
+        hash ^= (uint8_t)*name++;
+        hash *= 16777619U;
+    }
+    return hash;
+}
+
+
+/**
+ * @brief CRC32(多项式0xEDB88320)，记录按字组织，使用硬件CRC单元计算，结果与旧版本按字节计算的相同，已保存的记录仍然有效
+ */
+uint32_t Param_Store::Record_Crc(const uint32_t *data, uint32_t words)
+{
+    Crc32_Hw_Reset();
+    return Crc32_Hw_Update(data, words);
+}
@@ -0,0 +1,111 @@
+/**
+ * @file param_store.h
+ * @author Yang JianYi
+ * @brief 参数存储。把RAM中的可调参数(PID增益、舵向零点、速度和加速度上限等)登记到注册表，保存在内部flash的两个扇区中。
+ *        1) 每次保存(Commit)写入一条完整的记录：记录头(魔数、序号、格式版本、条目数、CRC32) + 若干(id, 值)；
+ *           id由参数名和类型计算，固件增删、调整参数顺序后旧记录仍可按名字加载，找不到的参数保持默认值；
+ *        2) 记录在当前扇区内顺序追加，魔数最后写入，掉电时只写了一半的记录没有魔数，加载时被忽略，保证保存是原子的；
+ *        3) 当前扇区写满后擦除另一个扇区并写到其开头，旧扇区保留到下一次切换，两个扇区轮流擦写(磨损均衡)；
+ *        4) 上电时扫描两个扇区，取序号最大且CRC正确的记录直接从flash读出，不需要擦写，耗时几百us。
+ *        使用方法：Regist登记参数(参数变量中预先写好默认值)，全部登记后调用Load，再把参数应用到各对象；
+ *        调参后调用Commit保存。切换扇区时擦除需要1~2s，期间CPU被挂起，只能在机器人静止时保存；
+ *        机器人静止时调用Prepare，当前扇区放不下下一条记录时提前擦除另一个扇区，之后的Commit不需要擦除。
+ * @version 0.1
+ * @date 2024-06-16
+ *
+ * @copyright Copyright (c) 2024
+ *
+ */
+#pragma once
+#ifdef __cplusplus
+
+#include <stdint.h>
+#include "drive_flash.h"
+
+#define PARAM_MAX_NUM       64
+#define PARAM_VERSION       1           //记录格式版本，记录格式改变时加1，旧版本的记录不再加载
+#define PARAM_MAGIC         0x5052414DU //"PRAM"
+
+typedef enum PARAM_TYPE
+{
+    PARAM_FLOAT = 0,
+    PARAM_INT32,
+    PARAM_UINT32
+}PARAM_TYPE;
+
+typedef struct Param_t
+{
+    const char *name;
+    uint32_t id;            //由名字和类型计算，保存在flash中
+    PARAM_TYPE type;
+    void *addr;             //RAM中参数变量的地址
+    float min;              //取值范围，加载和修改时超出范围的值被丢弃
+    float max;
+}Param_t;
+
+class Param_Store
+{
+public:
+    Param_Store(){}
+
+    int Regist(const char *name, float *addr, float min, float max);
+    int Regist(const char *name, int32_t *addr, int32_t min, int32_t max);
+    int Regist(const char *name, uint32_t *addr, uint32_t min, uint32_t max);
+
+    bool Load(void);
+    bool Commit(void);
+    bool Prepare(void);
+
+    int Find(const char *name) const;
+    bool Check(int index, float value) const;
+    bool Set(int index, float value);
+    float Get(int index) const;
+    const Param_t *get_param(int index) const { return (index >= 0 && index < num) ? &param[index] : 0; }
+    int get_num(void) const { return num; }
+    uint32_t get_seq(void) const { return seq; }
+    bool is_loaded(void) const { return loaded; }
+
+private:
+    //记录头，magic最后写入
+    typedef struct
+    {
+        uint32_t magic;
+        uint32_t seq;
+        uint32_t version_count;     //高16位格式版本，低16位条目数
+        uint32_t crc;               //seq、version_count和所有条目的CRC32
+    }Record_Head_t;
+
+    typedef struct
+    {
+        uint32_t base;              //扇区起始地址
+        uint32_t sector;            //FLASH_SECTOR_x
+        uint32_t free;              //下一条记录的写入地址
+        uint32_t last;              //最新有效记录的地址，0表示没有
+        uint32_t last_seq;
+        bool dirty;                 //存在无法解析的数据，下次保存时切换到另一个扇区
+        bool erased;                //本次上电后已擦除且还没有写入，切换到该扇区时不需要再擦除
+    }Sector_State_t;
+
+    Param_t param[PARAM_MAX_NUM];
+    int num = 0;
+    Sector_State_t sector[2] = {{FLASH_PARAM_ADDR_A, FLASH_PARAM_SECTOR_A, FLASH_PARAM_ADDR_A, 0, 0, false, false},
+                                {FLASH_PARAM_ADDR_B, FLASH_PARAM_SECTOR_B, FLASH_PARAM_ADDR_B, 0, 0, false, false}};
+    int active = 0;                 //最新记录所在的扇区
+    uint32_t seq = 0;               //最新记录的序号，0表示flash中没有记录
+    bool loaded = false;
+    uint32_t buff[sizeof(Record_Head_t)/4 + 2*PARAM_MAX_NUM];
+
+    int Add(const char *name, PARAM_TYPE type, void *addr, float min, float max);
+    void Scan(Sector_State_t *s);
+    bool Erase(Sector_State_t *s);
+    bool Has_Room(const Sector_State_t *s) const;
+    bool Write(Sector_State_t *s, uint32_t words);
+    bool Value_Set(Param_t *p, uint32_t raw);
+    uint32_t Value_Raw(const Param_t *p) const;
+    static uint32_t Hash(const char *name);
+    static uint32_t Record_Crc(const uint32_t *data, uint32_t words);
+};
+
+extern Param_Store param_store;
+
+#endif
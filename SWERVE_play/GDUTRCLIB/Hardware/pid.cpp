@@ -11,50 +11,22 @@
  */
 #include "pid.h"
 
-SystemTick_Fun PidTimer::get_systemTick = NULL;
 
 uint8_t PidTimer::update_timeStamp(void)
 {
-    uint32_t now_time=0;
+    uint32_t now_time = Get_SystemTimer();
 
-    //Check get sysClock
-    if(PidTimer::get_systemTick != NULL)
+    if(last_time == 0)
     {
-        if(last_time == 0)
-        {
-            last_time = PidTimer::get_systemTick();
-            return 1;
-        }
-        now_time = PidTimer::get_systemTick();
-
-        //overflow
-        if(now_time < last_time)
-            dt = (float)((now_time + 0xFFFFFFFF) - last_time);  //now_time is 32bit, use 0XFFFFFFFF to avoid overflow
-        else
-            dt = (float)(now_time - last_time);
-        
         last_time = now_time;
-        
-        dt *= 0.000001f;
-
-        return 0;
-    }
-    else
-    {
         dt = 0;
         return 1;
     }
-}
 
-uint8_t PidTimer::getMicroTick_regist(uint32_t (*getTick_fun)(void))
-{
-    if(getTick_fun != NULL)
-    {
-        PidTimer::get_systemTick = getTick_fun;
-        return 1;
-    }
-    else 
-        return 0;
+    //无符号减法，32位回绕时仍然正确
+    dt = (float)(now_time - last_time) * 0.000001f;
+    last_time = now_time;
+    return 0;
 }
 
 float PID::Adjust(void)
@@ -6,16 +6,11 @@
 #include <stdint.h>
 #include "filter.h"
 #include "tool.h"
-
-typedef uint32_t (*SystemTick_Fun)(void);
+#include "sys_clock.h"
 
 class PidTimer : public Tools
 {
-public:
-    static uint8_t getMicroTick_regist(uint32_t (*getTick_fun)(void));
-
 protected:
-    static SystemTick_Fun get_systemTick;
     float  dt;
     uint32_t last_time;
     uint8_t update_timeStamp();
@@ -28,6 +23,8 @@ public:
     PID(){};
     float Adjust();
     void PID_Param_Init(float _Kp, float _Ki, float _Kd, float _I_Term_Max, float _Out_Max, float DeadZone);
+    void set_out_max(float _Out_Max) { Out_Max = _Out_Max; }
+    float get_out_max() const { return Out_Max; }
 
     /**
      * @brief PID模式初始化
@@ -0,0 +1,113 @@
+/**
+ * @file power_budget.cpp
+ * @author Yang JianYi
+ * @brief 电池电流预算分配的实现，通道数很少(底盘8个电机)，分配时按优先级逐级遍历即可。
+ * @version 0.1
+ * @date 2024-06-12
+ *
+ * @copyright Copyright (c) 2024
+ *
+ */
+#include "power_budget.h"
+
+
+/**
+ * @brief 添加一个通道
+ *
+ * @param priority 优先级，数值越小越先分配
+ * @return int 通道号，超出数量时返回-1
+ */
+int Power_Budget::Add_Channel(uint8_t priority)
+{
+    if(channels >= POWER_MAX_CHANNEL)
+        return -1;
+
+    this->priority[channels] = priority;
+    this->demand[channels] = 0;
+    this->scale[channels] = 1;
+    return channels++;
+}
+
+
+/**
+ * @brief 设置通道本周期的估计电流
+ * @param current 母线侧电流，A，回馈(负值)按0处理
+ */
+void Power_Budget::Set_Demand(int ch, float current)
+{
+    if(ch < 0 || ch >= channels)
+        return;
+    demand[ch] = current > 0 ? current : 0;
+}
+
+
+/**
+ * @brief 设置母线电压实测值
+ * @param voltage 母线电压，V，小于等于0表示没有测量值，此时不降额
+ */
+void Power_Budget::Set_Bus(float voltage)
+{
+    bus_valid = voltage > 0;
+    bus_voltage = voltage;
+}
+
+
+/**
+ * @brief 计算本周期的预算并按优先级分配
+ */
+void Power_Budget::Allocate(void)
+{
+    float budget = Current_Max, total = 0;
+
+    for(int i=0; i<channels; i++)
+        total += demand[i];
+
+    //低压降额
+    if(bus_valid && bus_voltage < Voltage_Derate && Voltage_Derate > Voltage_Cutoff)
+    {
+        float k = (bus_voltage - Voltage_Cutoff) / (Voltage_Derate - Voltage_Cutoff);
+        if(k < 0)
+            k = 0;
+        budget = Current_Min + (Current_Max - Current_Min)*k;
+    }
+
+    //按优先级从高到低逐级分配
+    float remaining = budget;
+    int level = -1;
+    bool limited = false;
+    for(;;)
+    {
+        int next = 256;
+        for(int i=0; i<channels; i++)
+            if(priority[i] > level && priority[i] < next)
+                next = priority[i];
+        if(next == 256)
+            break;
+        level = next;
+
+        float level_demand = 0;
+        for(int i=0; i<channels; i++)
+            if(priority[i] == level)
+                level_demand += demand[i];
+
+        float k = 1;
+        if(level_demand > remaining)
+        {
+            k = level_demand > 0 ? remaining / level_demand : 1;
+            limited = true;
+        }
+
+        for(int i=0; i<channels; i++)
+            if(priority[i] == level)
+                scale[i] = k;
+        remaining -= level_demand*k;
+    }
+
+    telemetry.bus_voltage = bus_voltage;
+    telemetry.budget = budget;
+    telemetry.demand = total;
+    telemetry.granted = budget - remaining;
+    telemetry.usage = budget > 0 ? telemetry.granted / budget : 1;
+    if(limited)
+        telemetry.limit_cnt++;
+}
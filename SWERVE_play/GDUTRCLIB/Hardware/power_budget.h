@@ -0,0 +1,62 @@
+/**
+ * @file power_budget.h
+ * @author Yang JianYi
+ * @brief 电池电流预算分配。每个控制周期根据母线电压算出本周期允许的总电流，再按优先级把预算分给各电机：
+ *        优先级数值小的先分配，同一优先级内按估计电流同比例缩放，预算不足时低优先级的通道先被削减。
+ *        母线电压低于Voltage_Derate时预算线性降额，到Voltage_Cutoff时只保留Current_Min，防止电池掉压复位。
+ *        通道电流能测量的直接用测量值(如VESC上报的输入电流)，没有独立的母线电流测量，控制板等其他负载从Current_Max中预留。
+ *        使用方法：Add_Channel添加通道，每周期Set_Demand、Set_Bus后调用Allocate，用get_scale获取各通道的缩放系数。
+ * @version 0.1
+ * @date 2024-06-12
+ *
+ * @copyright Copyright (c) 2024
+ *
+ */
+#pragma once
+#ifdef __cplusplus
+
+#include <stdint.h>
+
+#define POWER_MAX_CHANNEL 8
+
+//电流预算遥测数据
+typedef struct Power_Telemetry_t
+{
+    float bus_voltage;      //母线电压，V
+    float budget;           //本周期可用的总电流，A
+    float demand;           //各通道估计电流之和，A
+    float granted;          //分配出去的电流，A
+    float usage;            //granted/budget
+    uint32_t limit_cnt;     //预算不足、发生削减的周期数
+}Power_Telemetry_t;
+
+class Power_Budget
+{
+public:
+    Power_Budget(){}
+
+    float Current_Max = 60;         /*!< 电池或保险丝允许的总电流，A */
+    float Current_Min = 5;          /*!< 电压降到Voltage_Cutoff时保留的电流，保证高优先级通道仍可控制，A */
+    float Voltage_Derate = 22.0f;   /*!< 低于该电压开始降额，V */
+    float Voltage_Cutoff = 19.0f;   /*!< 预算降到Current_Min的电压，V */
+
+    int Add_Channel(uint8_t priority);
+    void Set_Demand(int ch, float current);
+    void Set_Bus(float voltage);
+    void Allocate(void);
+
+    float get_scale(int ch) const { return (ch >= 0 && ch < channels) ? scale[ch] : 1.0f; }
+    Power_Telemetry_t get_telemetry(void) const { return telemetry; }
+
+private:
+    float demand[POWER_MAX_CHANNEL] = {0};
+    float scale[POWER_MAX_CHANNEL] = {0};
+    uint8_t priority[POWER_MAX_CHANNEL] = {0};
+    int channels = 0;
+
+    float bus_voltage = 0;
+    bool bus_valid = false;
+    Power_Telemetry_t telemetry = {0};
+};
+
+#endif
@@ -1,4 +1,121 @@
 #include "serial_tool.h"
+#include <string.h>
+
+
+/**
+ * @brief 追加接收到的字节
+ *        缓存满时丢弃最旧的字节，说明解析不及时，计入overflow
+ */
+void Frame_Parser::Push(const uint8_t *data, uint16_t len)
+{
+    Discard(consumed);
+    consumed = 0;
+
+    if(len > FRAME_PARSER_SIZE)
+    {
+        stats.overflow += len - FRAME_PARSER_SIZE;
+        data += len - FRAME_PARSER_SIZE;
+        len = FRAME_PARSER_SIZE;
+    }
+
+    if(start + count + len > FRAME_PARSER_SIZE)
+    {
+        if(count + len > FRAME_PARSER_SIZE)
+        {
+            uint16_t drop = count + len - FRAME_PARSER_SIZE;
+            stats.overflow += drop;
+            start += drop;
+            count -= drop;
+            synced = false;
+        }
+        memmove(buffer, buffer + start, count);
+        start = 0;
+    }
+
+    memcpy(buffer + start + count, data, len);
+    count += len;
+}
+
+
+/**
+ * @brief 取出下一帧
+ *
+ * @param payload 数据区指针，在下一次调用Push或Next之前有效
+ * @param len 数据长度
+ * @return false 缓存中没有完整的帧，剩余的半帧留到下一次Push
+ */
+bool Frame_Parser::Next(const uint8_t **payload, uint8_t *len)
+{
+    Discard(consumed);
+    consumed = 0;
+
+    while(count > 0)
+    {
+        const uint8_t *p = buffer + start;
+
+        if(p[0] != 0x55)
+        {
+            Discard(1);
+            continue;
+        }
+        if(count < 2)
+            return false;
+        if(p[1] != 0xAA)
+        {
+            Discard(1);
+            continue;
+        }
+        if(count < 3)
+            return false;
+
+        uint8_t n = p[2];
+        if((payload_len != 0 && n != payload_len) || n + 6 > FRAME_PARSER_SIZE)
+        {
+            stats.length_error++;
+            Discard(1);
+            continue;
+        }
+        if(count < n + 6)
+            return false;
+
+        if(p[n+4] != 0x0D || p[n+5] != 0x0A || p[n+3] != serial_get_crc8_value((unsigned char *)p, n+3))
+        {
+            stats.crc_error++;
+            Discard(1);
+            continue;
+        }
+
+        stats.good++;
+        synced = true;
+        consumed = n + 6;
+        *payload = p + 3;
+        *len = n;
+        return true;
+    }
+    return false;
+}
+
+
+/**
+ * @brief 丢弃缓存开头的n个字节。帧之外的字节被丢弃说明失去同步
+ */
+void Frame_Parser::Discard(uint16_t n)
+{
+    if(n == 0)
+        return;
+
+    if(consumed == 0 && synced)
+    {
+        synced = false;
+        stats.resync++;
+    }
+    if(n > count)
+        n = count;
+    start += n;
+    count -= n;
+    if(count == 0)
+        start = 0;
+}
 
 
 
@@ -1,6 +1,7 @@
 #pragma once
 #include "stdint.h"
 #include "data_pool.h"
+#include "drive_uart.h"
 
 #ifdef __cplusplus
 
@@ -19,16 +20,55 @@ public:
         return tail;
     }
 
-    void Serial_SendData(UART_HandleTypeDef *huart, uint8_t *data, uint16_t len)
+    //数据拷贝到串口发送缓存后返回，data可以立即重用
+    uint8_t Serial_SendData(UART_HandleTypeDef *huart, uint8_t *data, uint16_t len)
     {
-        TxMsg.huart = huart;
-        TxMsg.len = len;
-        TxMsg.data_addr = data;
-        xQueueSend(UART_TxPort, &TxMsg, 0);
+        return Uart_Transmit(huart, data, len);
     }
 private:
     unsigned char serial_get_crc8_value(unsigned char *tem_array, unsigned char len);
-    UART_TxMsg TxMsg;
+};
+
+
+#define FRAME_PARSER_SIZE 128   //解析缓存大小，最长帧为FRAME_PARSER_SIZE字节
+
+//帧解析统计
+typedef struct Frame_Parser_Stats_t
+{
+    uint32_t good;              //校验通过的帧数
+    uint32_t crc_error;         //帧头、长度正确，但crc或帧尾错误的帧数
+    uint32_t length_error;      //长度字节不合法的次数
+    uint32_t resync;            //失去同步、开始丢弃字节寻找帧头的次数
+    uint32_t overflow;          //解析不及时、缓存满被丢弃的字节数
+}Frame_Parser_Stats_t;
+
+/**
+ * @brief 0x55 0xAA + 长度 + 数据 + crc8 + 0x0D 0x0A 格式的字节流解析。
+ *        数据可以按任意长度分段Push，半帧留到下一次Push，一次Push中的多帧依次由Next取出。
+ *        帧头、长度、帧尾、crc任一项不对时只丢弃一个字节，从下一个字节重新寻找帧头，错误帧内部的真实帧不会丢失。
+ */
+class Frame_Parser
+{
+public:
+    /**
+     * @param payload_len 数据长度，不为0时只接受该长度的帧
+     */
+    Frame_Parser(uint8_t payload_len = 0) : payload_len(payload_len){}
+
+    void Push(const uint8_t *data, uint16_t len);
+    bool Next(const uint8_t **payload, uint8_t *len);
+    Frame_Parser_Stats_t get_stats(void) const { return stats; }
+
+private:
+    uint8_t buffer[FRAME_PARSER_SIZE];
+    uint16_t start = 0;         //未解析数据的起始位置
+    uint16_t count = 0;         //未解析的字节数
+    uint16_t consumed = 0;      //上一次Next返回的帧长度，下一次调用时才丢弃，保证返回的指针在此之前有效
+    uint8_t payload_len;
+    bool synced = false;
+    Frame_Parser_Stats_t stats = {0};
+
+    void Discard(uint16_t n);
 };
 
 
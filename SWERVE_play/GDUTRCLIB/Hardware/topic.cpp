@@ -0,0 +1,76 @@
+/**
+ * @file topic.cpp
+ * @author Yang JianYi
+ * @brief 话题的登记和统计。话题都是全局对象，构造时加入链表，之后不再删除，遍历时不需要加锁。
+ * @version 0.1
+ * @date 2024-06-28
+ *
+ * @copyright Copyright (c) 2024
+ *
+ */
+#include "topic.h"
+#include <string.h>
+
+Topic_Base *Topic_Base::list = NULL;
+
+
+Topic_Base::Topic_Base(const char *name, const volatile uint32_t *seq) : seq(seq), name(name)
+{
+    //全局对象在启动时依次构造，此时还没有任务和中断
+    next = list;
+    list = this;
+}
+
+
+/**
+ * @brief 按名字查找话题
+ * @return Topic_Base* 没有时返回NULL
+ */
+Topic_Base *Topic_Base::Find(const char *name)
+{
+    for(Topic_Base *topic = list; topic != NULL; topic = topic->next)
+    {
+        if(strcmp(topic->name, name) == 0)
+            return topic;
+    }
+    return NULL;
+}
+
+
+void Topic_Base::Latency_Record(int32_t latency)
+{
+    if(latency < 0)
+        latency = 0;
+    this->latency = latency;
+    if((uint32_t)latency > window_max)
+        window_max = latency;
+}
+
+
+/**
+ * @brief 计算发布频率，结束一个统计周期，由统计任务周期调用
+ * @param now 当前时刻，us
+ */
+void Topic_Base::Stats_Update(uint32_t now)
+{
+    uint32_t n = *seq;
+    uint32_t dt = now - last_time;
+    if(dt > 0 && last_time != 0)
+        rate = (uint32_t)((uint64_t)(n - last_seq) * 1000000 / dt);
+    last_seq = n;
+    last_time = now;
+    latency_max = window_max;
+    window_max = 0;
+}
+
+
+Topic_Stats_t Topic_Base::get_stats(void) const
+{
+    Topic_Stats_t stats;
+    stats.published = *seq;
+    stats.rate = rate;
+    stats.latency = latency;
+    stats.latency_max = latency_max;
+    stats.overrun = overrun;
+    return stats;
+}
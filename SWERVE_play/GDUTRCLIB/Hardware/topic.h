@@ -0,0 +1,153 @@
+/**
+ * @file topic.h
+ * @author Yang JianYi
+ * @brief 话题(发布/订阅)。每个话题只有一个发布方(一个任务或一个中断)，订阅方数量不限，增加订阅方不会增加发布方的开销。
+ *        1) Topic<T, DEPTH> 的数据就是一个Mailbox<T, DEPTH>(mailbox.h)：保存最近DEPTH份数据，发布不关中断，
+ *           可以在中断中发布，读取方拷贝后检查这一块有没有开始被改写，被改写时重读。话题只在邮箱上增加名字登记和统计。
+ *           发布和读取各拷贝一次数据，不是零拷贝。
+ *        2) Subscriber 记录自己读到的序号：Fetch取最新值(设定值、状态)，Next按顺序取(DEPTH份以内的事件)，
+ *           来不及读取被覆盖的条数计入overrun。取到新数据时记录从发布到取到的延时。
+ *        3) 话题在构造时登记到静态链表，可以按名字查找、遍历；发布频率由Topic_Base::Stats_Update按序号差计算，
+ *           统计在任务监视(task_monitor.cpp)中进行，发布方只写数据和序号。
+ *        时间戳为us，由发布方给出。
+ * @version 0.1
+ * @date 2024-06-28
+ *
+ * @copyright Copyright (c) 2024
+ *
+ */
+#pragma once
+#ifdef __cplusplus
+
+#include <stdint.h>
+#include <stddef.h>
+#include "mailbox.h"
+
+//话题统计
+typedef struct Topic_Stats_t
+{
+    uint32_t published;     //发布次数
+    uint32_t rate;          //最近一个统计周期的发布频率，Hz
+    uint32_t latency;       //最近一次订阅方取到新数据时距发布的时间，us
+    uint32_t latency_max;   //最近一个统计周期内延时的最大值，us
+    uint32_t overrun;       //按顺序读取的订阅方来不及读、被覆盖的条数
+}Topic_Stats_t;
+
+class Topic_Base
+{
+public:
+    const char *get_name(void) const { return name; }
+    uint32_t get_seq(void) const { return *seq; }
+    Topic_Stats_t get_stats(void) const;
+    void Stats_Update(uint32_t now);
+
+    //订阅方调用，多个订阅方同时记录时可能丢掉一次最大值，只用于统计。发布时刻晚于订阅方的now时按0记录
+    void Latency_Record(int32_t latency);
+    void Overrun_Record(uint32_t lost) { overrun += lost; }
+
+    static Topic_Base *First(void) { return list; }
+    Topic_Base *Next(void) const { return next; }
+    static Topic_Base *Find(const char *name);
+
+protected:
+    Topic_Base(const char *name, const volatile uint32_t *seq);
+
+private:
+    const volatile uint32_t *seq;       //邮箱中发布完成的次数
+    static Topic_Base *list;
+    Topic_Base *next;
+    const char *name;
+
+    uint32_t latency = 0, latency_max = 0, window_max = 0;
+    uint32_t overrun = 0;
+    uint32_t rate = 0, last_seq = 0, last_time = 0;
+};
+
+
+//邮箱作为第一个基类，先于Topic_Base构造，登记时计数已经存在
+template<typename T, int DEPTH = 1>
+class Topic : private Mailbox<T, DEPTH>, public Topic_Base
+{
+    typedef Mailbox<T, DEPTH> Box;
+public:
+    Topic(const char *name) : Box(), Topic_Base(name, Box::get_seq_addr()){}
+
+    using Topic_Base::get_seq;
+
+    /**
+     * @brief 发布，只能由一个任务或一个中断调用
+     * @param stamp 数据的时刻，us
+     */
+    void Publish(const T &value, uint32_t stamp) { Box::Write(value, stamp); }
+
+    /**
+     * @brief 读取序号为n的数据
+     * @return bool false表示已被覆盖(或正在被改写)，或者还没有发布
+     */
+    bool Read(uint32_t n, T *value, uint32_t *stamp) const { return Box::Read_At(n, value, stamp); }
+
+    /**
+     * @brief 读取最新值，不记录延时
+     * @return uint32_t 序号，0表示还没有发布过
+     */
+    uint32_t Read_Latest(T *value, uint32_t *stamp = NULL) const { return Box::Read(value, stamp); }
+};
+
+
+template<typename T, int DEPTH = 1>
+class Subscriber
+{
+public:
+    Subscriber(Topic<T, DEPTH> &topic) : topic(topic){}
+
+    /**
+     * @brief 有新数据时取最新值，中间没读到的数据跳过
+     * @param now 当前时刻，us，用于统计延时
+     * @return bool 没有新数据时返回false，value不变
+     */
+    bool Fetch(T *value, uint32_t now)
+    {
+        uint32_t stamp;
+        if(topic.get_seq() == last)
+            return false;
+        last = topic.Read_Latest(value, &stamp);
+        this->stamp = stamp;
+        topic.Latency_Record((int32_t)(now - stamp));
+        return true;
+    }
+
+    /**
+     * @brief 按发布顺序取下一条，落后超过DEPTH条时跳到最早的一条并记录overrun
+     * @return bool 没有未读数据时返回false
+     */
+    bool Next(T *value, uint32_t now)
+    {
+        uint32_t stamp;
+        for(;;)
+        {
+            uint32_t head = topic.get_seq();
+            if(head == last)
+                return false;
+            if(head - last > (uint32_t)DEPTH)
+            {
+                topic.Overrun_Record(head - last - DEPTH);
+                last = head - DEPTH;
+            }
+            if(topic.Read(last + 1, value, &stamp))
+                break;
+        }
+        last++;
+        this->stamp = stamp;
+        topic.Latency_Record((int32_t)(now - stamp));
+        return true;
+    }
+
+    uint32_t get_stamp(void) const { return stamp; }       //最近取到的数据的时间戳
+
+private:
+    Topic<T, DEPTH> &topic;
+    uint32_t last = 0;          //最近取到的序号
+    uint32_t stamp = 0;
+};
+
+#endif
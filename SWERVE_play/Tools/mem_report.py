@@ -0,0 +1,139 @@
+#!/usr/bin/env python3
+# -*- coding: utf-8 -*-
+"""
+链接后的RAM用量报告：读取Keil生成的 .map，按工程分组(uvprojx中的Group)统计各部分占用的SRAM和CCM，
+并与预算比较，超出时返回1，可以放在Keil的 After Build 中执行。
+
+    python mem_report.py                                   # 默认读取 MDK-ARM/MOTOR_CPP/MOTOR_CPP.map
+    python mem_report.py --map build.map --top 10          # 同时列出占用最多的10个目标文件
+    python mem_report.py --budget USER/Module=4096 --budget GDUTRCLIB/Application=8192
+
+区域的上限取 .map 中的Max，即分散加载文件(MDK-ARM/stm32f407_ccm.sct)中的大小。
+"""
+import argparse
+import os
+import re
+import sys
+import xml.etree.ElementTree as ET
+
+HERE = os.path.dirname(os.path.abspath(__file__))
+ROOT = os.path.dirname(HERE)
+DEFAULT_MAP = os.path.join(ROOT, 'MDK-ARM', 'MOTOR_CPP', 'MOTOR_CPP.map')
+DEFAULT_PROJ = os.path.join(ROOT, 'MDK-ARM', 'MOTOR_CPP.uvprojx')
+
+REGION = re.compile(r'Execution Region (\S+) \(Exec base: (0x[0-9a-fA-F]+).*?Size: (0x[0-9a-fA-F]+), Max: (0x[0-9a-fA-F]+)')
+SIZES = re.compile(r'^\s*(\d+)\s+(\d+)\s+(\d+)\s+(\d+)\s+(\d+)\s+(\d+)\s+(\S+)\s*$')
+ENTRY = re.compile(r'^\s*0x[0-9a-fA-F]+\s+\S+\s+(0x[0-9a-fA-F]+)\s+(Zero|Data|Code)\s+\S+\s+\d+\s+.*\s(\S+\.o)\s*$')
+
+
+def load_groups(proj):
+    """目标文件名 -> 工程分组，Keil的目标文件名为源文件名的小写"""
+    groups = {}
+    if not os.path.exists(proj):
+        return groups
+    for group in ET.parse(proj).getroot().iter('Group'):
+        name = group.findtext('GroupName')
+        for f in group.iter('FileName'):
+            stem = os.path.splitext(f.text)[0].lower()
+            groups[stem + '.o'] = name
+    return groups
+
+
+def parse_map(path):
+    regions = []            # (名字, 基地址, 大小, 上限)
+    objects = {}            # 目标文件 -> (RW, ZI)
+    libraries = {}          # 库 -> (RW, ZI)
+    placed = {}             # (区域, 目标文件) -> 字节
+    region = None
+    table = None
+    with open(path, errors='replace') as f:
+        for line in f:
+            m = REGION.search(line)
+            if m:
+                region = m.group(1)
+                regions.append((region, int(m.group(2), 16), int(m.group(3), 16), int(m.group(4), 16)))
+                continue
+            if 'Image component sizes' in line:
+                region = None
+            if 'Object Name' in line:
+                table = objects
+                continue
+            if 'Library Member Name' in line:
+                table = None            # 库按整个库统计
+                continue
+            if 'Library Name' in line:
+                table = libraries
+                continue
+            if region is not None:
+                m = ENTRY.match(line)
+                if m and m.group(2) != 'Code':
+                    key = (region, m.group(3))
+                    placed[key] = placed.get(key, 0) + int(m.group(1), 16)
+                continue
+            if table is not None:
+                m = SIZES.match(line)
+                if m:
+                    table[m.group(7)] = (int(m.group(4)), int(m.group(5)))
+    return regions, objects, libraries, placed
+
+
+def main():
+    ap = argparse.ArgumentParser(description='RAM usage per subsystem from a Keil map file')
+    ap.add_argument('--map', default=DEFAULT_MAP)
+    ap.add_argument('--project', default=DEFAULT_PROJ)
+    ap.add_argument('--top', type=int, default=0, help='list the N largest objects')
+    ap.add_argument('--budget', action='append', default=[], metavar='GROUP=BYTES',
+                    help='fail when a group uses more RAM than BYTES, can be repeated')
+    a = ap.parse_args()
+
+    groups = load_groups(a.project)
+    regions, objects, libraries, placed = parse_map(a.map)
+    ccm = [r[0] for r in regions if r[1] == 0x10000000]
+
+    usage = {}
+    for obj, (rw, zi) in objects.items():
+        g = groups.get(obj, 'other')
+        in_ccm = sum(placed.get((r, obj), 0) for r in ccm)
+        u = usage.setdefault(g, [0, 0, 0])
+        u[0] += rw
+        u[1] += zi
+        u[2] += in_ccm
+    for lib, (rw, zi) in libraries.items():
+        u = usage.setdefault('C library', [0, 0, 0])
+        u[0] += rw
+        u[1] += zi
+
+    failed = False
+    print('%-24s %8s %8s %8s %8s' % ('region', 'base', 'used', 'max', 'use'))
+    for name, base, size, limit in regions:
+        if name.startswith('ER_'):
+            continue
+        print('%-24s %08x %8d %8d %7.1f%%' % (name, base, size, limit, 100.0 * size / limit if limit else 0))
+        failed |= size > limit
+
+    print('\n%-24s %8s %8s %8s %8s' % ('subsystem', 'RW', 'ZI', 'SRAM', 'CCM'))
+    total = [0, 0, 0]
+    for g in sorted(usage, key=lambda k: -(usage[k][0] + usage[k][1])):
+        rw, zi, c = usage[g]
+        print('%-24s %8d %8d %8d %8d' % (g, rw, zi, rw + zi - c, c))
+        total = [total[0] + rw, total[1] + zi, total[2] + c]
+    print('%-24s %8d %8d %8d %8d' % ('total', total[0], total[1], total[0] + total[1] - total[2], total[2]))
+
+    if a.top > 0:
+        print('\n%-32s %-24s %8s' % ('object', 'subsystem', 'RAM'))
+        biggest = sorted(objects.items(), key=lambda kv: -(kv[1][0] + kv[1][1]))[:a.top]
+        for obj, (rw, zi) in biggest:
+            print('%-32s %-24s %8d' % (obj, groups.get(obj, 'other'), rw + zi))
+
+    for b in a.budget:
+        g, limit = b.rsplit('=', 1)
+        used = sum(usage.get(g, [0, 0, 0])[:2])
+        if used > int(limit, 0):
+            print('over budget: %s uses %d bytes, budget %s' % (g, used, limit))
+            failed = True
+    if failed:
+        sys.exit(1)
+
+
+if __name__ == '__main__':
+    main()
@@ -0,0 +1,192 @@
+#!/usr/bin/env python3
+# -*- coding: utf-8 -*-
+"""
+串口在线调参上位机，协议见 USER/Module/param_tuner.cpp。需要 pyserial。
+
+    python param_tune.py -p COM5 list
+    python param_tune.py -p /dev/ttyUSB0 get rudder.pos.kp heading.kp
+    python param_tune.py -p /dev/ttyUSB0 set rudder.pos.kp=100 rudder.pos.kd=0.3
+    python param_tune.py -p /dev/ttyUSB0 sweep heading.kp 0.04 0.12 0.02 --dwell 3
+    python param_tune.py -p /dev/ttyUSB0 commit
+    python param_tune.py -p /dev/ttyUSB0 reset           # 清除锁存的故障并重新回零
+
+也可以作为模块在脚本中使用：
+    t = Tuner('/dev/ttyUSB0'); t.set(**{'heading.kp': 0.1}); t.commit()
+"""
+import argparse
+import struct
+import sys
+import time
+
+import serial
+
+CMD_INFO, CMD_FIND, CMD_GET, CMD_SET, CMD_COMMIT, CMD_REVERT, CMD_RESET = 1, 2, 3, 4, 5, 6, 7
+ACK = 0x80
+STATUS = {0: 'ok', 1: 'bad command', 2: 'no such parameter', 3: 'out of range', 4: 'flash write failed',
+          5: 'robot moving, stop the chassis before commit'}
+TYPES = {0: 'float', 1: 'int32', 2: 'uint32'}
+
+
+def crc8(data):
+    """与下位机serial_get_crc8_value相同"""
+    crc = 0
+    for b in data:
+        crc ^= b
+        for _ in range(8):
+            crc = (crc >> 1) ^ 0x8C if crc & 1 else crc >> 1
+    return crc
+
+
+def pack(payload):
+    frame = bytes([0x55, 0xAA, len(payload)]) + payload
+    return frame + bytes([crc8(frame), 0x0D, 0x0A])
+
+
+class TuneError(Exception):
+    pass
+
+
+class Tuner(object):
+    def __init__(self, port, baud=115200, timeout=0.5):
+        self.ser = serial.Serial(port, baud, timeout=timeout)
+        self.seq = 0
+        self.index = {}         # 参数名 -> (序号, 类型, 最小值, 最大值)
+
+    def request(self, cmd, args=b'', timeout=3.0):
+        self.seq = (self.seq + 1) & 0xFF
+        self.ser.reset_input_buffer()
+        self.ser.write(pack(bytes([cmd, self.seq]) + args))
+
+        buf = b''
+        deadline = time.time() + timeout
+        while time.time() < deadline:
+            buf += self.ser.read(self.ser.in_waiting or 1)
+            while True:
+                start = buf.find(b'\x55\xaa')
+                if start < 0 or len(buf) < start + 3:
+                    break
+                buf = buf[start:]
+                n = buf[2]
+                if len(buf) < n + 6:
+                    break
+                frame, buf = buf[:n + 6], buf[n + 6:]
+                if frame[-2:] != b'\r\n' or crc8(frame[:n + 3]) != frame[n + 3]:
+                    continue
+                payload = frame[3:3 + n]
+                if payload[0] == cmd | ACK and payload[1] == self.seq:
+                    if payload[2] != 0:
+                        raise TuneError('%s%s' % (STATUS.get(payload[2], payload[2]),
+                                                  ' (index %d)' % payload[3] if len(payload) > 3 else ''))
+                    return payload[3:]
+        raise TuneError('timeout')
+
+    def info(self, index):
+        r = self.request(CMD_INFO, bytes([index]))
+        _, num, typ = r[0], r[1], r[2]
+        value, lo, hi = struct.unpack('<fff', r[3:15])
+        name = r[15:].decode('ascii', 'replace')
+        self.index[name] = (index, typ, lo, hi)
+        return num, name, TYPES.get(typ, typ), value, lo, hi
+
+    def list(self):
+        result = []
+        num, i = 1, 0
+        while i < num:
+            num, name, typ, value, lo, hi = self.info(i)
+            result.append((i, name, typ, value, lo, hi))
+            i += 1
+        return result
+
+    def find(self, name):
+        if name not in self.index:
+            r = self.request(CMD_FIND, name.encode('ascii'))
+            self.index[name] = (r[0], r[1], None, None)
+        return self.index[name][0]
+
+    def get(self, *names):
+        idx = [self.find(n) for n in names]
+        r = self.request(CMD_GET, bytes([len(idx)] + idx))
+        values = {}
+        for k in range(r[0]):
+            i, v = struct.unpack('<Bf', r[1 + 5 * k:6 + 5 * k])
+            values[names[idx.index(i)]] = v
+        return values
+
+    def set(self, **values):
+        """一次请求修改多个参数，下位机在同一个控制周期之前全部生效"""
+        args = bytes([len(values)])
+        for name, v in values.items():
+            args += struct.pack('<Bf', self.find(name), float(v))
+        self.request(CMD_SET, args)
+
+    def commit(self):
+        return struct.unpack('<I', self.request(CMD_COMMIT, timeout=5.0))[0]
+
+    def revert(self):
+        self.request(CMD_REVERT)
+
+    def reset(self):
+        self.request(CMD_RESET)
+
+
+def frange(start, stop, step):
+    n = int(round((stop - start) / step))
+    return [start + k * step for k in range(n + 1)]
+
+
+def main():
+    ap = argparse.ArgumentParser(description='chassis parameter tuning over UART')
+    ap.add_argument('-p', '--port', required=True)
+    ap.add_argument('-b', '--baud', type=int, default=115200)
+    sub = ap.add_subparsers(dest='cmd')
+    sub.add_parser('list')
+    g = sub.add_parser('get')
+    g.add_argument('names', nargs='+')
+    s = sub.add_parser('set')
+    s.add_argument('pairs', nargs='+', help='name=value')
+    w = sub.add_parser('sweep', help='step one parameter, restoring the original value at the end')
+    w.add_argument('name')
+    w.add_argument('start', type=float)
+    w.add_argument('stop', type=float)
+    w.add_argument('step', type=float)
+    w.add_argument('--dwell', type=float, default=2.0, help='seconds at each value')
+    sub.add_parser('commit')
+    sub.add_parser('revert')
+    sub.add_parser('reset', help='clear latched motor faults and re-home the rudders')
+    a = ap.parse_args()
+
+    t = Tuner(a.port, a.baud)
+    try:
+        if a.cmd == 'list':
+            for i, name, typ, value, lo, hi in t.list():
+                print('%3d %-24s %-6s %12g  [%g, %g]' % (i, name, typ, value, lo, hi))
+        elif a.cmd == 'get':
+            for k, v in t.get(*a.names).items():
+                print('%s = %g' % (k, v))
+        elif a.cmd == 'set':
+            t.set(**dict((p.split('=')[0], float(p.split('=')[1])) for p in a.pairs))
+        elif a.cmd == 'sweep':
+            origin = t.get(a.name)[a.name]
+            try:
+                for v in frange(a.start, a.stop, a.step):
+                    t.set(**{a.name: v})
+                    print('%s = %g' % (a.name, v))
+                    sys.stdout.flush()
+                    time.sleep(a.dwell)
+            finally:
+                t.set(**{a.name: origin})
+        elif a.cmd == 'commit':
+            print('saved, record %d' % t.commit())
+        elif a.cmd == 'revert':
+            t.revert()
+        elif a.cmd == 'reset':
+            t.reset()
+        else:
+            ap.print_help()
+    except TuneError as e:
+        print('error: %s' % e)
+        sys.exit(1)
+
+
+if __name__ == '__main__':
+    main()
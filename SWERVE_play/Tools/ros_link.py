@@ -0,0 +1,146 @@
+#!/usr/bin/env python3
+# -*- coding: utf-8 -*-
+"""
+ROS串口(USART3)的上位机参考实现：对时、带时间戳的控制帧、遥测解析。协议见 USER/Module/ROS.cpp、telemetry.cpp。需要 pyserial。
+
+    python ros_link.py -p /dev/ttyUSB0 monitor              # 只对时，打印偏差、往返延时、遥测延时
+    python ros_link.py -p /dev/ttyUSB0 cmd 0.5 0 0 --time 3  # 以50Hz发送带时间戳的速度指令3s
+
+时间为上位机单调时钟的us，取低32位。下位机对时后按同一个时基给遥测打时间戳、计算控制帧的帧龄。
+"""
+import argparse
+import struct
+import time
+
+import serial
+
+MSG_TELEMETRY, MSG_SYNC, MSG_CMD = 0x10, 0x20, 0x21
+TELEMETRY_PAYLOAD = 95
+STATUS_CLOCK_SYNC = 0x08
+
+
+def crc8(data):
+    """与下位机serial_get_crc8_value相同"""
+    crc = 0
+    for b in data:
+        crc ^= b
+        for _ in range(8):
+            crc = (crc >> 1) ^ 0x8C if crc & 1 else crc >> 1
+    return crc
+
+
+def pack(payload):
+    frame = bytes([0x55, 0xAA, len(payload)]) + payload
+    return frame + bytes([crc8(frame), 0x0D, 0x0A])
+
+
+def now_us():
+    return int(time.monotonic() * 1e6) & 0xFFFFFFFF
+
+
+def s32(x):
+    x &= 0xFFFFFFFF
+    return x - (1 << 32) if x & 0x80000000 else x
+
+
+class RosLink(object):
+    def __init__(self, port, baud=921600):
+        self.ser = serial.Serial(port, baud, timeout=0.01)
+        self.buf = b''
+        self.seq = 0                # 当前对时请求序号
+        self.last = (0, 0)          # 上一次请求的(序号, t4)
+        self.t1 = 0
+        self.offset = None          # 下位机时钟 - 上位机时钟，us
+        self.delay = None
+        self.latency = None         # 遥测采样时刻到上位机收到的时间，us
+        self.cmd_age = None         # 下位机报告的控制帧帧龄，us
+        self.stale = 0
+
+    def sync(self):
+        """发出对时请求，带回上一次的t4"""
+        self.seq = self.seq % 255 + 1
+        self.t1 = now_us()
+        self.ser.write(pack(struct.pack('<BBIBI', MSG_SYNC, self.seq, self.t1, self.last[0], self.last[1])))
+
+    def cmd(self, x, y, z, ctrl_mode=0, ctrl_flag=1, chassis_init=0, status=(0, 0, 0, 0)):
+        body = struct.pack('<fffBBB4B', x, y, z, ctrl_mode, ctrl_flag, chassis_init, *status)
+        self.ser.write(pack(bytes([MSG_CMD]) + body + struct.pack('<I', now_us())))
+
+    def poll(self):
+        """读取并处理所有遥测帧，返回本次收到的帧数"""
+        self.buf += self.ser.read(self.ser.in_waiting or 1)
+        frames = 0
+        while True:
+            start = self.buf.find(b'\x55\xaa')
+            if start < 0 or len(self.buf) < start + 3:
+                break
+            self.buf = self.buf[start:]
+            n = self.buf[2]
+            if len(self.buf) < n + 6:
+                break
+            frame = self.buf[:n + 6]
+            if frame[-2:] != b'\r\n' or crc8(frame[:n + 3]) != frame[n + 3]:
+                self.buf = self.buf[1:]
+                continue
+            self.buf = self.buf[n + 6:]
+            if n == TELEMETRY_PAYLOAD and frame[3] == MSG_TELEMETRY:
+                self.telemetry(frame[3:3 + n], now_us())
+                frames += 1
+        return frames
+
+    def telemetry(self, p, t4):
+        status = p[69]
+        host_stamp, echo_seq, t1, t2, t3 = struct.unpack('<IBIII', p[74:91])
+        age, self.stale = struct.unpack('<HH', p[91:95])
+        self.cmd_age = None if age == 0xFFFF else age * 100
+        if status & STATUS_CLOCK_SYNC:
+            self.latency = s32(t4 - host_stamp)
+
+        # 同一个请求的应答出现在多帧中，只用最先收到的一帧
+        if echo_seq == self.seq and t1 == self.t1 and self.last[0] != self.seq:
+            self.last = (self.seq, t4)
+            self.delay = s32((t4 - t1) - (t3 - t2))
+            a, b = s32(t2 - t1), s32(t3 - t4)
+            self.offset = a + (b - a) // 2
+
+
+def main():
+    ap = argparse.ArgumentParser(description='ROS link clock sync and timestamped commands')
+    ap.add_argument('-p', '--port', required=True)
+    ap.add_argument('-b', '--baud', type=int, default=921600)
+    ap.add_argument('--sync-period', type=float, default=1.0, help='seconds between sync requests')
+    sub = ap.add_subparsers(dest='cmd')
+    sub.add_parser('monitor')
+    c = sub.add_parser('cmd')
+    c.add_argument('x', type=float)
+    c.add_argument('y', type=float)
+    c.add_argument('z', type=float)
+    c.add_argument('--time', type=float, default=2.0)
+    c.add_argument('--rate', type=float, default=50.0)
+    a = ap.parse_args()
+
+    link = RosLink(a.port, a.baud)
+    end = time.time() + (a.time if a.cmd == 'cmd' else 1e9)
+    next_sync = next_cmd = next_print = time.time()
+    try:
+        while time.time() < end:
+            t = time.time()
+            if t >= next_sync:
+                link.sync()
+                next_sync = t + a.sync_period
+            if a.cmd == 'cmd' and t >= next_cmd:
+                link.cmd(a.x, a.y, a.z)
+                next_cmd = t + 1.0 / a.rate
+            link.poll()
+            if t >= next_print:
+                print('offset %s us  rtt %s us  telemetry latency %s us  cmd age %s us  stale %d'
+                      % (link.offset, link.delay, link.latency, link.cmd_age, link.stale))
+                next_print = t + 1.0
+        if a.cmd == 'cmd':
+            link.cmd(0, 0, 0, ctrl_flag=1)
+    except KeyboardInterrupt:
+        pass
+
+
+if __name__ == '__main__':
+    main()
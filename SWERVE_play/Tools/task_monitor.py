@@ -0,0 +1,142 @@
+#!/usr/bin/env python3
+# -*- coding: utf-8 -*-
+"""
+任务负载监视上位机，接收USART2上的任务负载帧和话题统计帧并打印，帧格式见 USER/Module/task_monitor.cpp。需要 pyserial。
+与调参(param_tune.py)共用串口，两个工具不能同时打开串口。
+
+    python task_monitor.py -p /dev/ttyUSB0                 # 每帧打印一张表
+    python task_monitor.py -p COM5 --count 60 --csv load.csv   # 记录60个周期，每行一个任务
+    python task_monitor.py -p /dev/ttyUSB0 --stack 512,chassic=2048,user_debug=1024,Air_Joy=1024
+                                                            # 按每个任务的栈大小(字节，见service_config.h)显示已用比例
+"""
+import argparse
+import csv
+import struct
+import sys
+
+import serial
+
+from param_tune import crc8
+
+MSG_ID = 0x20
+TOPIC_ID = 0x21
+NAME_LEN = 8
+TOPIC_NAME_LEN = 12
+STATES = {0: 'run', 1: 'ready', 2: 'block', 3: 'susp', 4: 'del'}
+
+
+def frames(ser):
+    """逐帧返回数据区，校验失败的帧丢弃"""
+    buf = b''
+    while True:
+        buf += ser.read(ser.in_waiting or 1)
+        while True:
+            start = buf.find(b'\x55\xaa')
+            if start < 0 or len(buf) < start + 3:
+                break
+            buf = buf[start:]
+            n = buf[2]
+            if len(buf) < n + 6:
+                break
+            frame = buf[:n + 6]
+            if frame[-2:] != b'\r\n' or crc8(frame[:n + 3]) != frame[n + 3]:
+                buf = buf[2:]
+                continue
+            buf = buf[n + 6:]
+            yield frame[3:3 + n]
+
+
+def name(raw):
+    return raw.split(b'\0', 1)[0].decode('ascii', 'replace')
+
+
+def decode(p):
+    stamp, window, load, n, m = struct.unpack('<IIHBB', p[1:13])
+    tasks, queues = [], []
+    k = 13
+    for _ in range(n):
+        cpu, free, prio, state = struct.unpack('<HHBB', p[k + NAME_LEN:k + NAME_LEN + 6])
+        tasks.append((name(p[k:k + NAME_LEN]), cpu / 100.0, free, prio, STATES.get(state, state)))
+        k += NAME_LEN + 6
+    for _ in range(m):
+        used, peak, size = p[k + NAME_LEN], p[k + NAME_LEN + 1], p[k + NAME_LEN + 2]
+        queues.append((name(p[k:k + NAME_LEN]), used, peak, size))
+        k += NAME_LEN + 3
+    return stamp, window, load / 100.0, tasks, queues
+
+
+def decode_topics(p):
+    topics = []
+    k = 2
+    for _ in range(p[1]):
+        rate, latency, latency_max, overrun = struct.unpack('<HHHH', p[k + TOPIC_NAME_LEN:k + TOPIC_NAME_LEN + 8])
+        topics.append((name(p[k:k + TOPIC_NAME_LEN]), rate, latency, latency_max, overrun))
+        k += TOPIC_NAME_LEN + 8
+    return topics
+
+
+def parse_stack(text):
+    """'512,chassic=2048' -> (512, {'chassic': 2048})，没有名字的为其余任务的栈大小"""
+    default, sizes = 0, {}
+    for item in filter(None, (text or '').split(',')):
+        if '=' in item:
+            k, v = item.split('=')
+            sizes[k] = int(v)
+        else:
+            default = int(item)
+    return default, sizes
+
+
+def main():
+    ap = argparse.ArgumentParser(description='per-task CPU load and stack high-water from the chassis')
+    ap.add_argument('-p', '--port', required=True)
+    ap.add_argument('-b', '--baud', type=int, default=115200)
+    ap.add_argument('--count', type=int, default=0, help='stop after N reports, 0 for no limit')
+    ap.add_argument('--csv', help='append one row per task per report')
+    ap.add_argument('--stack', help='stack size in bytes, default[,task=bytes...], shows the used share')
+    a = ap.parse_args()
+
+    ser = serial.Serial(a.port, a.baud, timeout=0.5)
+    stack_default, stack_sizes = parse_stack(a.stack)
+    out = None
+    if a.csv:
+        f = open(a.csv, 'a', newline='')
+        out = csv.writer(f)
+        out.writerow(['stamp_us', 'window_us', 'task', 'cpu_percent', 'stack_free', 'priority', 'state'])
+
+    reports = 0
+    try:
+        for p in frames(ser):
+            if len(p) >= 2 and p[0] == TOPIC_ID:
+                print('%-14s %6s %9s %9s %8s' % ('topic', 'Hz', 'lat us', 'max us', 'overrun'))
+                for t, rate, latency, latency_max, overrun in decode_topics(p):
+                    print('%-14s %6d %9d %9d %8d' % (t, rate, latency, latency_max, overrun))
+                sys.stdout.flush()
+                continue
+            if len(p) < 13 or p[0] != MSG_ID:
+                continue
+            stamp, window, load, tasks, queues = decode(p)
+            print('\n%.3f s  window %.1f ms  cpu %.2f%%' % (stamp / 1e6, window / 1e3, load))
+            print('%-10s %7s %7s %5s %6s' % ('task', 'cpu%', 'free', 'prio', 'state'))
+            for t, cpu, free, prio, state in sorted(tasks, key=lambda x: -x[1]):
+                size = stack_sizes.get(t, stack_default)
+                used = ' %3d%%' % (100 - 100 * free // size) if size else ''
+                print('%-10s %7.2f %7d %5d %6s%s' % (t, cpu, free, prio, state, used))
+                if out:
+                    out.writerow([stamp, window, t, cpu, free, prio, state])
+            print('%-10s %7s %7s %5s' % ('queue', 'used', 'peak', 'size'))
+            for q, used, peak, size in queues:
+                print('%-10s %7d %7d %5d' % (q, used, peak, size))
+            sys.stdout.flush()
+            reports += 1
+            if a.count and reports >= a.count:
+                break
+    except KeyboardInterrupt:
+        pass
+    finally:
+        if out:
+            f.close()
+
+
+if __name__ == '__main__':
+    main()
@@ -0,0 +1,165 @@
+#!/usr/bin/env python3
+# -*- coding: utf-8 -*-
+"""
+事件跟踪快照导出，接收USART2上的跟踪快照(帧格式见 GDUTRCLIB/Components/event_trace.c)，
+转换为Chrome trace/Perfetto的JSON，用 https://ui.perfetto.dev 或 chrome://tracing 打开。需要 pyserial。
+下位机需在event_trace.h中打开USE_EVENT_TRACE，底盘任务周期超过TRACE_TRIGGER_US时发送一次快照。
+与调参(param_tune.py)、任务监视(task_monitor.py)共用串口，不能同时打开串口。
+
+    python trace_export.py -p /dev/ttyUSB0                     # 等待一次快照，写入 trace.json
+    python trace_export.py -p COM5 --count 5 -o spike.json     # 连续接收5次，写入 spike_1.json ~ spike_5.json
+
+每个任务一条轨道(运行期间为一段)，每个中断一条轨道，队列收发为瞬时事件并画出队列长度曲线，
+Control()等用户标记为异步事件，触发点为全局瞬时事件。
+"""
+import argparse
+import json
+import os
+import struct
+import sys
+
+import serial
+
+from task_monitor import frames, name
+
+MSG_BEGIN, MSG_NAMES, MSG_EVENTS = 0x30, 0x31, 0x32
+TASK_IN, ISR_ENTER, ISR_EXIT, QUEUE_SEND, QUEUE_RECV, MARK_BEGIN, MARK_END, TRIGGER = range(1, 9)
+NAME_LEN = 8
+ISR_TID = 1000
+
+# STM32F407 IRQn，与stm32f4xx_it.c中加了跟踪点的中断对应
+IRQ_NAMES = {19: 'CAN1_TX', 20: 'CAN1_RX0', 29: 'TIM3', 30: 'TIM4', 37: 'USART1', 38: 'USART2',
+             39: 'USART3', 52: 'UART4', 63: 'CAN2_TX', 64: 'CAN2_RX0', 71: 'USART6'}
+MARK_NAMES = {1: 'Control'}
+
+
+class Snapshot:
+    def __init__(self, p):
+        self.first, self.count, self.cycles_per_us = struct.unpack('<IHH', p[1:9])
+        self.tasks, self.queues, self.events = {}, {}, {}
+
+    def names(self, p):
+        table = self.tasks if p[1] == 0 else self.queues
+        k = 3
+        for _ in range(p[2]):
+            table[p[k]] = name(p[k + 1:k + 1 + NAME_LEN])
+            k += 1 + NAME_LEN
+
+    def add(self, p):
+        index = struct.unpack('<I', p[2:6])[0]
+        for i in range(p[1]):
+            self.events[index + i] = struct.unpack('<IBBH', p[6 + 8 * i:14 + 8 * i])
+
+    def done(self):
+        return len(self.events) >= self.count
+
+
+def to_chrome(snap):
+    """返回(traceEvents, 统计信息)，时间从快照的第一条开始，us"""
+    out = [{'name': 'process_name', 'ph': 'M', 'pid': 1, 'args': {'name': 'chassis'}}]
+    for num, t in snap.tasks.items():
+        out.append({'name': 'thread_name', 'ph': 'M', 'pid': 1, 'tid': num, 'args': {'name': t}})
+    for irq, t in IRQ_NAMES.items():
+        out.append({'name': 'thread_name', 'ph': 'M', 'pid': 1, 'tid': ISR_TID + irq, 'args': {'name': 'ISR ' + t}})
+
+    running = None      # 当前运行的任务号
+    isr = None          # 当前所在的中断
+    last = None
+    ts = 0.0
+    torn = gaps = 0
+    expect = snap.first
+    for index in sorted(snap.events):
+        if index != expect:
+            gaps += index - expect
+        expect = index + 1
+        cycles, kind, ident, arg = snap.events[index]
+        if kind == 0:
+            torn += 1
+            continue
+        if last is not None:
+            ts += ((cycles - last) & 0xFFFFFFFF) / snap.cycles_per_us
+        last = cycles
+        tid = ISR_TID + isr if isr is not None else (running or 0)
+
+        if kind == TASK_IN:
+            if running is not None:
+                out.append({'ph': 'E', 'pid': 1, 'tid': running, 'ts': ts})
+            running = ident
+            out.append({'name': snap.tasks.get(ident, 'task %d' % ident), 'ph': 'B', 'pid': 1, 'tid': ident, 'ts': ts})
+        elif kind == ISR_ENTER:
+            isr = ident
+            out.append({'name': IRQ_NAMES.get(ident, 'IRQ %d' % ident), 'ph': 'B', 'pid': 1, 'tid': ISR_TID + ident, 'ts': ts})
+        elif kind == ISR_EXIT:
+            out.append({'ph': 'E', 'pid': 1, 'tid': ISR_TID + ident, 'ts': ts})
+            isr = None
+        elif kind in (QUEUE_SEND, QUEUE_RECV):
+            q = snap.queues.get(ident, 'queue %d' % ident)
+            used = arg + 1 if kind == QUEUE_SEND else arg - 1
+            op = 'send' if kind == QUEUE_SEND else 'recv'
+            out.append({'name': '%s %s' % (op, q), 'ph': 'i', 's': 't', 'pid': 1, 'tid': tid, 'ts': ts, 'args': {'used': used}})
+            out.append({'name': q, 'ph': 'C', 'pid': 1, 'ts': ts, 'args': {'used': used}})
+        elif kind in (MARK_BEGIN, MARK_END):
+            out.append({'name': MARK_NAMES.get(ident, 'mark %d' % ident), 'cat': 'mark', 'id': ident,
+                        'ph': 'b' if kind == MARK_BEGIN else 'e', 'pid': 1, 'tid': tid, 'ts': ts})
+        elif kind == TRIGGER:
+            out.append({'name': 'trigger', 'ph': 'i', 's': 'g', 'pid': 1, 'tid': tid, 'ts': ts, 'args': {'period_us': arg}})
+
+    if running is not None:
+        out.append({'ph': 'E', 'pid': 1, 'tid': running, 'ts': ts})
+    if isr is not None:
+        out.append({'ph': 'E', 'pid': 1, 'tid': ISR_TID + isr, 'ts': ts})
+    gaps += snap.first + snap.count - expect
+    return out, {'events': len(snap.events), 'span_us': ts, 'torn': torn, 'missing': gaps}
+
+
+def main():
+    ap = argparse.ArgumentParser(description='export event trace snapshots from the chassis as Chrome/Perfetto JSON')
+    ap.add_argument('-p', '--port', required=True)
+    ap.add_argument('-b', '--baud', type=int, default=115200)
+    ap.add_argument('-o', '--out', default='trace.json')
+    ap.add_argument('--count', type=int, default=1, help='number of snapshots to save')
+    a = ap.parse_args()
+
+    ser = serial.Serial(a.port, a.baud, timeout=0.5)
+    stem, ext = os.path.splitext(a.out)
+    snap = None
+    saved = 0
+
+    def save(snap):
+        path = a.out if a.count == 1 else '%s_%d%s' % (stem, saved, ext)
+        events, info = to_chrome(snap)
+        with open(path, 'w') as f:
+            json.dump({'traceEvents': events, 'displayTimeUnit': 'ns'}, f)
+        print('%s: %d events, %.3f ms, %d torn, %d missing' %
+              (path, info['events'], info['span_us'] / 1e3, info['torn'], info['missing']))
+        sys.stdout.flush()
+
+    try:
+        for p in frames(ser):
+            if not p:
+                continue
+            if p[0] == MSG_BEGIN and len(p) >= 9:
+                if snap is not None and snap.events:     # 上一次有帧丢失没有收齐，按收到的部分保存
+                    saved += 1
+                    save(snap)
+                    if saved >= a.count:
+                        break
+                snap = Snapshot(p)
+            elif snap is None:
+                continue
+            elif p[0] == MSG_NAMES and len(p) >= 3:
+                snap.names(p)
+            elif p[0] == MSG_EVENTS and len(p) >= 6:
+                snap.add(p)
+                if snap.done():
+                    saved += 1
+                    save(snap)
+                    snap = None
+                    if saved >= a.count:
+                        break
+    except KeyboardInterrupt:
+        pass
+
+
+if __name__ == '__main__':
+    main()
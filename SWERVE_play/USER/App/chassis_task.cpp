@@ -9,58 +9,352 @@
  * 
  */
 #include "chassis_task.h"
+#include "drive_tim.h"
+#include "event_trace.h"
+
+static void Telemetry_Publish(void);
+
+Cmd_Mux cmd_mux;
 
 void Chassis_Task(void *pvParameters)
 {
     static Robot_Twist_t twist;
+    IMU_Data_t imu_data;
+    bool enable = false;
     for(;;)
     {   
-        if(xQueueReceive(Chassia_Port, &twist, 0) == pdPASS)
+        //在线调参，修改的参数在本次控制之前一次性生效
+        tuner.Poll();
+
+        //指令仲裁，来源切换、超时停车都在本周期生效。第一次有指令之后底盘才开始控制(舵向回零)
+        uint32_t now = Get_SystemTimer();
+#if USE_EVENT_TRACE
+        //循环间隔超出时冻结事件跟踪，保留这次延时前后的任务切换和中断
+        static uint32_t last_loop = 0;
+        if(last_loop != 0 && now - last_loop > TRACE_TRIGGER_US)
+            Trace_Trigger((uint16_t)(now - last_loop > 0xFFFF ? 0xFFFF : now - last_loop));
+        last_loop = now;
+#endif
+        if(cmd_mux.Select(now, &twist) >= 0)
+            enable = true;
+        Chassis_Cmd.Publish(twist, now);
+
+        if(enable)
         {
+            imu_data = imu.get_data();
+            chassis.Imu_Update(imu_data.yaw, imu_data.yaw_rate, imu.is_online());
+
             //底盘控制、电机控制    
+            TRACE_MARK_BEGIN(TRACE_MARK_CONTROL);
             chassis.Control(twist);
 			chassis.Motor_Control();
+            TRACE_MARK_END(TRACE_MARK_CONTROL);
         }
+        Chassis_Odom.Publish(chassis.get_odometry(), Get_SystemTimer());
+
+        //上行遥测，到发送时间时打包交给DMA，不等待发送完成
+        if(telemetry.Is_Due())
+            Telemetry_Publish();
 			
         osDelay(1);
     }
 }
 
 
+/**
+ * @brief 采集底盘状态并发送一帧遥测。里程计、电机反馈从话题读取，没有新数据时沿用上一次的值
+ */
+static void Telemetry_Publish(void)
+{
+    static Subscriber<Chassis_Odom_t> odom_sub(Chassis_Odom);
+    static Subscriber<Motor_Feedback_t> rudder_sub(Rudder_Feedback), wheel_sub(Wheel_Feedback);
+    static Chassis_Odom_t odom;
+    static Motor_Feedback_t rudder, wheel;
+    uint32_t now = Get_SystemTimer();
+    Telemetry_Data_t data = {0};
+
+    odom_sub.Fetch(&odom, now);
+    rudder_sub.Fetch(&rudder, now);
+    wheel_sub.Fetch(&wheel, now);
+
+    data.x = odom.x;
+    data.y = odom.y;
+    data.yaw = odom.yaw;
+    data.vx = odom.vel.linear.x;
+    data.vy = odom.vel.linear.y;
+    data.wz = odom.vel.angular.z;
+    data.status = (imu.is_online() ? TELEMETRY_IMU_ONLINE : 0) | (chassis.heading_hold ? TELEMETRY_HEADING_HOLD : 0);
+
+    for(int i=0; i<TELEMETRY_MODULES && i<MOTOR_GROUP_NUM; i++)
+    {
+        data.module_angle[i] = rudder.angle[i];
+        data.wheel_speed[i] = wheel.speed[i];
+        data.rudder_current[i] = rudder.current[i];
+        data.wheel_current[i] = wheel.current[i];
+    }
+
+#if CHASSIS_TYPE == SWERVE_CHASSIS
+    for(int i=0; i<TELEMETRY_CHANNELS; i++)
+        data.faults[i] = chassis.fault.get_faults(i);
+    if(chassis.chassis_is_init)
+        data.status |= TELEMETRY_CHASSIS_INIT;
+    data.homing_state = chassis.get_homing_state();
+
+    Power_Telemetry_t power = chassis.power.get_telemetry();
+    data.bus_voltage = power.bus_voltage;
+    data.power_usage = power.usage;
+#else
+    data.status |= TELEMETRY_CHASSIS_INIT;
+#endif
+
+    telemetry.Publish(data);
+}
+
+
+#if CHASSIS_TYPE == SWERVE_CHASSIS
+/**
+ * @brief 底盘故障事件回调，只在故障发生和清除时调用，有故障时蜂鸣器报警
+ */
+static void Chassis_Fault_Callback(int ch, uint8_t faults)
+{
+    if(chassis.fault.is_ok())
+    {
+        Set_PwmDuty(&htim10, TIM_CHANNEL_1, 0);
+    }
+    else
+    {
+        Set_PwmFreq(&htim10, 5);
+        Set_PwmDuty(&htim10, TIM_CHANNEL_1, 50);
+    }
+}
+
+
+/**
+ * @brief 调参工具的reset命令：清除锁存的故障(编码器跳变只能这样清除)并重新回零，在控制周期之间调用
+ */
+static void Chassis_Fault_Reset(void)
+{
+    chassis.Rehome();
+}
+#endif
+
+
+/**
+ * @brief 底盘是否静止：没有有效的指令来源，规划后的速度指令和里程计测得的速度都接近0。
+ *        只有静止时才允许写flash(擦除扇区时CPU被挂起1~2s)
+ */
+static bool Chassis_Is_Idle(void)
+{
+    const float linear_min = 0.01f, angular_min = 0.02f;     //m/s、rad/s
+    uint32_t now = Get_SystemTimer();
+    for(int i=0; i<CMD_SRC_NUM; i++)
+    {
+        if(cmd_mux.is_live(i, now))
+            return false;
+    }
+
+    Robot_Twist_t vel[2] = {chassis.profiler.get_velocity(), chassis.get_odometry().vel};
+    for(int i=0; i<2; i++)
+    {
+        if(fabsf(vel[i].linear.x) > linear_min || fabsf(vel[i].linear.y) > linear_min
+           || fabsf(vel[i].angular.z) > angular_min)
+            return false;
+    }
+    return true;
+}
+
+
+//可调参数，初始值为默认参数，上电时被flash中保存的值覆盖。修改后调用Chassis_Param_Apply生效，param_store.Commit()保存
+typedef struct Chassis_Param_t
+{
+    float accel_max[3];         //底盘加速度上限，vx、vy、wz
+    float jerk_max[3];          //底盘加加速度上限，决定加速度从0升到最大值的时间(此处约0.2s)
+    float speed_max[3];         //底盘速度上限
+    float heading_pid[3];       //航向保持Kp、Ki、Kd
+    float heading_trust[2];     //航向保持误差、误差微分的低通滤波系数(Trust)
+#if CHASSIS_TYPE == SWERVE_CHASSIS
+    float rudder_offset[4];     //舵向零点，度，顺序为左前、右前、右后、左后
+    float rudder_speed_pid[3];  //舵向速度环Kp、Ki、Kd，四个舵向共用
+    float rudder_speed_trust[2];
+    float rudder_pos_pid[3];    //舵向位置环Kp、Ki、Kd
+    float rudder_pos_trust[2];
+    float theta;                //两对对角模组连线的夹角，度，修改后重新计算运动学
+#else
+    float wheel_pid[3];         //轮向速度环Kp、Ki、Kd
+    float wheel_trust[2];
+#endif
+}Chassis_Param_t;
+
+static Chassis_Param_t chassis_param = {
+    {1.5f, 1.5f, 4.5f},
+    {7.5f, 7.5f, 22.5f},
+    {3, 3, 4},
+    {0.08f, 0, 0.002f},
+    {1, 0.5f},
+#if CHASSIS_TYPE == SWERVE_CHASSIS
+    {53.0f+15+180, 53.0f+60+180, 53.0f+120, 53.0f+0.0f},
+    {12, 0.1f, 0},
+    {0.8f, 1},
+    {120, 0, 0.2f},
+    {0.8f, 0.1f},
+    99.26f,
+#else
+    {12, 0.2f, 0},
+    {0.8f, 1},
+#endif
+};
+
+
+/**
+ * @brief 把可调参数登记到参数存储，名字保存在flash中，修改名字后旧的保存值不再加载
+ */
+static void Chassis_Param_Regist(void)
+{
+    static const char *const name[][3] = {
+        {"chassis.accel.x", "chassis.accel.y", "chassis.accel.z"},
+        {"chassis.jerk.x", "chassis.jerk.y", "chassis.jerk.z"},
+        {"chassis.speed.x", "chassis.speed.y", "chassis.speed.z"},
+        {"heading.kp", "heading.ki", "heading.kd"},
+#if CHASSIS_TYPE == SWERVE_CHASSIS
+        {"rudder.speed.kp", "rudder.speed.ki", "rudder.speed.kd"},
+        {"rudder.pos.kp", "rudder.pos.ki", "rudder.pos.kd"},
+#else
+        {"wheel.kp", "wheel.ki", "wheel.kd"},
+#endif
+    };
+
+    for(int i=0; i<3; i++)
+    {
+        param_store.Regist(name[0][i], &chassis_param.accel_max[i], 0.1f, 20);
+        param_store.Regist(name[1][i], &chassis_param.jerk_max[i], 0.1f, 200);
+        param_store.Regist(name[2][i], &chassis_param.speed_max[i], 0, 6);
+        param_store.Regist(name[3][i], &chassis_param.heading_pid[i], -10, 10);
+#if CHASSIS_TYPE == SWERVE_CHASSIS
+        param_store.Regist(name[4][i], &chassis_param.rudder_speed_pid[i], 0, 1000);
+        param_store.Regist(name[5][i], &chassis_param.rudder_pos_pid[i], 0, 1000);
+#else
+        param_store.Regist(name[4][i], &chassis_param.wheel_pid[i], 0, 1000);
+#endif
+    }
+
+    param_store.Regist("heading.trust", &chassis_param.heading_trust[0], 0.01f, 1);
+    param_store.Regist("heading.trust_d", &chassis_param.heading_trust[1], 0.01f, 1);
+#if CHASSIS_TYPE == SWERVE_CHASSIS
+    param_store.Regist("rudder.speed.trust", &chassis_param.rudder_speed_trust[0], 0.01f, 1);
+    param_store.Regist("rudder.speed.trust_d", &chassis_param.rudder_speed_trust[1], 0.01f, 1);
+    param_store.Regist("rudder.pos.trust", &chassis_param.rudder_pos_trust[0], 0.01f, 1);
+    param_store.Regist("rudder.pos.trust_d", &chassis_param.rudder_pos_trust[1], 0.01f, 1);
+    param_store.Regist("rudder.lf.offset", &chassis_param.rudder_offset[0], 0, 359.99f);
+    param_store.Regist("rudder.rf.offset", &chassis_param.rudder_offset[1], 0, 359.99f);
+    param_store.Regist("rudder.rr.offset", &chassis_param.rudder_offset[2], 0, 359.99f);
+    param_store.Regist("rudder.lr.offset", &chassis_param.rudder_offset[3], 0, 359.99f);
+    param_store.Regist("chassis.theta", &chassis_param.theta, 30, 150);
+#else
+    param_store.Regist("wheel.trust", &chassis_param.wheel_trust[0], 0.01f, 1);
+    param_store.Regist("wheel.trust_d", &chassis_param.wheel_trust[1], 0.01f, 1);
+#endif
+}
+
+
+/**
+ * @brief 把可调参数应用到底盘，在控制周期之间调用。舵向零点改变时重新回零
+ */
+void Chassis_Param_Apply(void)
+{
+    const Chassis_Param_t &p = chassis_param;
+
+    chassis.profiler.Accel_Max.linear.x = p.accel_max[0];
+    chassis.profiler.Accel_Max.linear.y = p.accel_max[1];
+    chassis.profiler.Accel_Max.angular.z = p.accel_max[2];
+    chassis.profiler.Jerk_Max.linear.x = p.jerk_max[0];
+    chassis.profiler.Jerk_Max.linear.y = p.jerk_max[1];
+    chassis.profiler.Jerk_Max.angular.z = p.jerk_max[2];
+
+    chassis.Speed_Max.linear.x = p.speed_max[0];
+    chassis.Speed_Max.linear.y = p.speed_max[1];
+    chassis.Speed_Max.angular.z = p.speed_max[2];
+
+    //航向保持，输入角度误差(度)，输出角速度(rad/s)。IMU安装方向与底盘相反时Kp取负
+    chassis.PID_Heading.PID_Param_Init(p.heading_pid[0], p.heading_pid[1], p.heading_pid[2], 0, 2, 0);
+    chassis.PID_Heading.PID_Mode_Init(p.heading_trust[0], p.heading_trust[1], true, false);
+
+#if CHASSIS_TYPE == SWERVE_CHASSIS
+    //舵向零点按左前、右前、右后、左后四个模组注册，换用其他模组数时需同时修改chassis_param
+    static_assert(Chassis_Type::WHEEL_NUM == 4, "rudder offsets are registered for four swerve modules");
+    for(int i=0; i<Chassis_Type::WHEEL_NUM; i++)
+    {
+        chassis.Pid_Param_Init(i, RUDDER_SPEED_PID, p.rudder_speed_pid[0], p.rudder_speed_pid[1], p.rudder_speed_pid[2], 400, 30000, 0);
+        chassis.Pid_Param_Init(i, RUDDER_POS_PID, p.rudder_pos_pid[0], p.rudder_pos_pid[1], p.rudder_pos_pid[2], 400, 2000, 0.2);
+        chassis.Pid_Mode_Init(i, RUDDER_SPEED_PID, p.rudder_speed_trust[0], p.rudder_speed_trust[1], true, true);
+        chassis.Pid_Mode_Init(i, RUDDER_POS_PID, p.rudder_pos_trust[0], p.rudder_pos_trust[1], true, false);
+    }
+
+    static float applied_offset[4] = {-1, -1, -1, -1};
+    bool offset_changed = false;
+    for(int i=0; i<Chassis_Type::WHEEL_NUM; i++)
+    {
+        if(p.rudder_offset[i] != applied_offset[i])
+        {
+            chassis.RudderMotor[i].set_encoder_offset(p.rudder_offset[i]/360 * 8192.0f);
+            applied_offset[i] = p.rudder_offset[i];
+            offset_changed = true;
+        }
+    }
+    //零点改变后角度整体平移，重新回零，同时清除故障监测中修改前的角度
+    if(offset_changed)
+        chassis.Rehome();
+
+    if(p.theta != chassis.get_theta())
+        chassis.Theta_Set(p.theta);
+#else
+    //轮向电机速度环，输入电机转速(rpm)，输出C620电流
+    for(int i=0; i<Chassis_Type::WHEEL_NUM; i++)
+    {
+        chassis.Pid_Param_Init(i, p.wheel_pid[0], p.wheel_pid[1], p.wheel_pid[2], 2000, 16000, 0);
+        chassis.Pid_Mode_Init(i, p.wheel_trust[0], p.wheel_trust[1], true, false);
+    }
+#endif
+}
+
+
 void Chassis_Pid_Init(void)
 {   
-    chassis.accel_vel = 1.5;
-
-    chassis.Pid_Param_Init(RUDDER_LEFT_FRONT_Speed_E,12, 0.1, 0, 400, 30000, 0);
-    chassis.Pid_Param_Init(RUDDER_RIGHT_FRONT_Speed_E,12, 0.1, 0, 400, 30000, 0);
-    chassis.Pid_Param_Init(RUDDER_LEFT_REAR_Speed_E,12, 0.1, 0, 400, 30000, 0);
-    chassis.Pid_Param_Init(RUDDER_RIGHT_REAR_Speed_E,12, 0.1, 0, 400, 30000, 0);
-
-    chassis.Pid_Param_Init(RUDDER_LEFT_FRONT_Pos_E,120, 0, 0.2, 400, 2000, 0.2);
-    chassis.Pid_Param_Init(RUDDER_RIGHT_FRONT_Pos_E,120, 0, 0.2, 400, 2000, 0.2);
-    chassis.Pid_Param_Init(RUDDER_LEFT_REAR_Pos_E,120, 0, 0.2, 400, 2000, 0.2);
-    chassis.Pid_Param_Init(RUDDER_RIGHT_REAR_Pos_E,120, 0, 0.2, 400, 2000, 0.2);
-
-    chassis.Pid_Mode_Init(RUDDER_LEFT_FRONT_Speed_E, 0.8, 1, true, true);
-    chassis.Pid_Mode_Init(RUDDER_RIGHT_FRONT_Speed_E, 0.8, 1, true, true);
-    chassis.Pid_Mode_Init(RUDDER_LEFT_REAR_Speed_E, 0.8, 1, true, true);
-    chassis.Pid_Mode_Init(RUDDER_RIGHT_REAR_Speed_E, 0.8, 1, true, true);
-
-    chassis.Pid_Mode_Init(RUDDER_LEFT_FRONT_Pos_E, 0.8, 0.1, true, false);
-    chassis.Pid_Mode_Init(RUDDER_RIGHT_FRONT_Pos_E, 0.8, 0.1, true, false);
-    chassis.Pid_Mode_Init(RUDDER_LEFT_REAR_Pos_E, 0.8, 0.1, true, false);
-    chassis.Pid_Mode_Init(RUDDER_RIGHT_REAR_Pos_E, 0.8, 0.1, true, false);
-	
-	float lf_offset=(53.0f+15+180)/360 * 8192.0f;
-	float rf_offset=(53.0f+60+180)/360 * 8192.0f;
-	float rr_offset = (53.0f+120)/360 * 8192.0f;
-	float lr_offset = (53.0f+0.0f)/360 * 8192.0f; 
-    RudderMotor[0].set_encoder_offset(lf_offset);
-    RudderMotor[1].set_encoder_offset(rf_offset);
-    RudderMotor[2].set_encoder_offset(rr_offset);
-    RudderMotor[3].set_encoder_offset(lr_offset);
-
-    chassis.Speed_Max.linear.x = 3;
-    chassis.Speed_Max.linear.y = 3;
-    chassis.Speed_Max.angular.z = 4;
+#if CHASSIS_TYPE == SWERVE_CHASSIS
+    //电流预算，6S锂电池，需要在VESC Tool中打开STATUS_4、STATUS_5的发送
+    chassis.power.Current_Max = 60;
+    chassis.power.Current_Min = 8;
+    chassis.power.Voltage_Derate = 21.0f;
+    chassis.power.Voltage_Cutoff = 19.2f;
+
+    chassis.fault.Callback_Regist(Chassis_Fault_Callback);
+    tuner.Reset_Regist(Chassis_Fault_Reset);
+#endif
+
+    //轮速上限，单位与轮向电机的速度指令相同，平移和旋转叠加超过该值时整体同比例缩小
+#if CHASSIS_TYPE == SWERVE_CHASSIS
+    //VESC的eRPM，换算系数为service_config.cpp中构造时的gear_ratio 21(极对数*减速比)，轮半径0.055m，约4.1m/s
+    chassis.Wheel_RPM_Max = 15000;
+#else
+    //C620电机转子转速rpm，M3508空载约9000rpm，留出速度环调节的余量。减速比19、轮半径0.076m时约3.5m/s
+    chassis.Wheel_RPM_Max = 8500;
+#endif
+    chassis.desat_policy = DESAT_PROPORTIONAL;
+    chassis.heading_hold = true;
+
+    //速度指令来源，按CMD_SOURCE的顺序添加
+    cmd_mux.Add_Source(0, JOY_CMD_TIMEOUT, CMD_PREEMPT);
+    cmd_mux.Add_Source(1, ROS_CMD_TIMEOUT, CMD_WAIT);
+    cmd_mux.Add_Source(2, AUTO_CMD_TIMEOUT, CMD_WAIT);
+
+    //增益、零点、速度和加速度上限从flash加载，flash中没有保存值时使用chassis_param的默认值
+    Chassis_Param_Regist();
+    param_store.Load();
+    Chassis_Param_Apply();
+
+    //当前扇区已满时上电即擦除另一个扇区，之后的保存不需要擦除
+    param_store.Prepare();
+
+    //串口调参(USART2)修改参数后在控制周期之间重新应用，只在底盘静止时保存
+    tuner.Apply_Regist(Chassis_Param_Apply);
+    tuner.Commit_Check_Regist(Chassis_Is_Idle);
 }
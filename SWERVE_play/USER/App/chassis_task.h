@@ -2,14 +2,21 @@
 
 #include "data_pool.h"
 #include "chassis.h"
+#include "imu.h"
+#include "param_store.h"
+#include "cmd_mux.h"
 
 
 #ifdef __cplusplus
 void Chassis_Pid_Init(void);
+void Chassis_Param_Apply(void);
 extern "C" {
 #endif
 void Chassis_Task(void *pvParameters);
-extern Swerve_Chassis chassis;
+extern Chassis_Type chassis;
+#ifdef __cplusplus
+extern Cmd_Mux cmd_mux;
+#endif
 
 #ifdef __cplusplus
 }
@@ -1,7 +1,8 @@
 /**
  * @file fsm_joy.cpp
  * @author Yang JianYi
- * @brief 舵轮底盘应用文件，包括上位机控制接口的调用以及stm32手柄的调试，开关是通过宏定义来控制的(USE_ROS_CONTROL)。
+ * @brief 舵轮底盘应用文件，包括上位机控制接口的调用以及航模手柄的解析。
+ *        两个来源的指令都提交给cmd_mux(见chassis_task.cpp)，由底盘任务每个周期按优先级、超时选择，运行时切换。
  * @version 0.1
  * @date 2024-05-16
  * 
@@ -12,57 +13,16 @@
 #include "fsm_joy.h"
 #include "drive_tim.h"
 #include "chassis_task.h"
+#include "telemetry.h"
 
 void Air_Joy_Task(void *pvParameters)
 {
     for(;;)
     {
-#if USE_ROS_CONTROL
-            ROS_Cmd_Process();
-#else 
-            Robot_Twist_t twist;
-            if(air_joy.LEFT_X>1400&&air_joy.LEFT_X<1600)
-                air_joy.LEFT_X = 1500;
-            if(air_joy.LEFT_Y>1400&&air_joy.LEFT_Y<1600)
-                air_joy.LEFT_Y = 1500;
-            if(air_joy.RIGHT_X>1400&&air_joy.RIGHT_X<1600)
-                air_joy.RIGHT_X = 1500;
-            if(air_joy.RIGHT_Y>1400&&air_joy.RIGHT_Y<1600)  
-                air_joy.RIGHT_Y = 1500;
-
-            if(air_joy.LEFT_X!=0||air_joy.LEFT_Y!=0||air_joy.RIGHT_X!=0||air_joy.RIGHT_Y!=0)
-            {
-                if(air_joy.SWA>1950&&air_joy.SWA<2050)
-                {
-                    if(air_joy.SWC>950&&air_joy.SWC<1050)
-                    {
-                        twist.chassis_mode = NORMAL;
-                    }
-                    else if(air_joy.SWC>1450&&air_joy.SWC<1550)
-                    {
-                        twist.chassis_mode = X_MOVE;
-                    }
-                    else if(air_joy.SWC>1950&&air_joy.SWC<2050)
-                    {
-                        twist.chassis_mode = Y_MOVE;
-                    }
-                    else
-                    {
-                        twist.chassis_mode = NORMAL;
-                    }
-                    
-                    twist.linear.x = (air_joy.LEFT_Y - 1500)/500.0 * 3;
-                    twist.linear.y = (air_joy.LEFT_X - 1500)/500.0 * 3;
-                    twist.angular.z = (air_joy.RIGHT_X - 1500)/500.0 * 4;
-                    xQueueSend(Chassia_Port, &twist, 0);
-                }
-            }
-            else
-            {
-                twist = {0};
-            }
-
-#endif
+        //两个来源同时处理，由cmd_mux按优先级和超时选择
+        ROS_Cmd_Process();
+        air_joy.Poll(Get_SystemTimer());
+        Joy_Cmd_Process();
         osDelay(1);
     }
 }
@@ -71,13 +31,12 @@ void Air_Joy_Task(void *pvParameters)
 void Broadcast_Task(void *pvParameters)
 {
     static Broadcast broadcast;
+    static Subscriber<Robot_Status_t> status_sub(Robot_Status);
+    Robot_Status_t status = {STOP};
     for(;;)
     {
-        Robot_Status_t status = {STOP};
-        if(xQueueReceive(Broadcast_Port, &status, 0) == pdPASS)
-        {
-            broadcast.Send_To_Broadcast(status);
-        }
+        //取最新的状态，没有收到过时为STOP，是否需要播报由Send_To_Broadcast判断
+        status_sub.Fetch(&status, Get_SystemTimer());
         // status.robot_init = AUTO_MODE;
         broadcast.Send_To_Broadcast(status);
         osDelay(1);
@@ -85,43 +44,71 @@ void Broadcast_Task(void *pvParameters)
 }
 
 
-// ROS ros;
+static ROS ros;
+
+
+/**
+ * @brief 读取ROS指令，ctrl_flag为1时提交给cmd_mux，为0时放弃控制。超时由cmd_mux判断
+ */
 void ROS_Cmd_Process(void)
 {
-    static ROS ros;
-    static uint32_t dt=0,now=0,last=0;;
-    dt = now - last;    //ms
-    UART_TxMsg Msg;
-    static Robot_Twist_t twist,twist_ros;
-    static Robot_Status_t status;
-
-    static uint8_t ctrl_flag=0;
-    twist.chassis_mode = NORMAL;
-    if(xQueueReceive(Recieve_ROS_Port, &Msg, 0) == pdPASS)
+    if(ros.Recieve_From_Stream(&usart3_manager) > 0)
     {
-        last = now;
-        ros.Recieve_From_ROS((uint8_t *)(Msg.data_addr));
+        Robot_Twist_t twist;
         twist.linear.x = ros.readFromRosData.x;
         twist.linear.y = ros.readFromRosData.y;
+        twist.linear.z = 0;
+        twist.angular.x = 0;
+        twist.angular.y = 0;
         twist.angular.z = ros.readFromRosData.z;
         twist.chassis_mode = (CHASSIS_MODE)ros.readFromRosData.ctrl_mode;
-        ctrl_flag = ros.readFromRosData.ctrl_flag;
-        status.robot_init = ros.readFromRosData.status.robot_init;
-        status.path_mode = ros.readFromRosData.status.path_mode;
-        status.sensor = ros.readFromRosData.status.sensor;
-        status.control_mode = ros.readFromRosData.status.control_mode;
-        twist_ros = twist;
+
+        if(ros.readFromRosData.ctrl_flag == 1)
+            cmd_mux.Submit(CMD_SRC_ROS, twist, Get_SystemTimer());
+        else
+            cmd_mux.Release(CMD_SRC_ROS);
+
+        Robot_Status.Publish(ros.readFromRosData.status, Get_SystemTimer());
     }
+    telemetry.Cmd_Age_Set(ros.cmd_age, ros.cmd_stale);
+}
 
-    if(dt>100)
+
+/**
+ * @brief 航模手柄，SWA拨到使能位置时提交指令，否则放弃控制；没有新帧时不提交，由cmd_mux超时停车，
+ *        接收机报告失控或超时(air_joy发布lost置1的帧)时放弃控制
+ */
+void Joy_Cmd_Process(void)
+{
+    static Subscriber<RC_Frame_t> rc_sub(air_joy.topic);
+    RC_Frame_t rc;
+    if(rc_sub.Fetch(&rc, Get_SystemTimer()) == false)
+        return;
+
+    if(rc.lost || !(rc.ch[RC_SWA]>1950&&rc.ch[RC_SWA]<2050))
     {
-        twist = {0};
-        ctrl_flag = 0;
+        cmd_mux.Release(CMD_SRC_JOY);
+        return;
     }
 
-    if(ctrl_flag == 1)
-        xQueueSend(Chassia_Port, &twist_ros, 0);
-    now = ros.get_systemTick()/1000;    //ms
+    uint16_t left_x = rc.ch[RC_LEFT_X], left_y = rc.ch[RC_LEFT_Y], right_x = rc.ch[RC_RIGHT_X];
+    if(left_x>1400&&left_x<1600)
+        left_x = 1500;
+    if(left_y>1400&&left_y<1600)
+        left_y = 1500;
+    if(right_x>1400&&right_x<1600)
+        right_x = 1500;
+
+    Robot_Twist_t twist = {0};
+    if(rc.ch[RC_SWC]>1450&&rc.ch[RC_SWC]<1550)
+        twist.chassis_mode = X_MOVE;
+    else if(rc.ch[RC_SWC]>1950&&rc.ch[RC_SWC]<2050)
+        twist.chassis_mode = Y_MOVE;
+    else
+        twist.chassis_mode = NORMAL;
 
-    xQueueSend(Broadcast_Port, &status, 0);
+    twist.linear.x = (left_y - 1500)/500.0 * 3;
+    twist.linear.y = (left_x - 1500)/500.0 * 3;
+    twist.angular.z = (right_x - 1500)/500.0 * 4;
+    cmd_mux.Submit(CMD_SRC_JOY, twist, Get_SystemTimer());
 }
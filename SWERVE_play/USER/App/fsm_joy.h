@@ -11,6 +11,7 @@
 extern "C" {
 #endif
 void ROS_Cmd_Process(void); 
+void Joy_Cmd_Process(void);
 void Air_Joy_Task(void *pvParameters);
 void Broadcast_Task(void *pvParameters);
 
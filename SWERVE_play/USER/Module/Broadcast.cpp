@@ -1,18 +1,5 @@
 #include "Broadcast.h"
 
-SystemTick_Fun Broadcast::get_systemTick = NULL;
-
-uint8_t Broadcast::getMicroTick_regist(uint32_t (*getTick_fun)(void))
-{
-    if(getTick_fun != NULL)
-    {
-        Broadcast::get_systemTick = getTick_fun;
-        return 1;
-    }
-    else 
-        return 0;
-}
-
 
 void Broadcast::Send_To_Broadcast(Robot_Status_t status)
 {
@@ -48,7 +35,6 @@ void Broadcast::Send_To_Broadcast(Robot_Status_t status)
 
 void Broadcast::play(PLAYLIST playlist)
 {
-    UART_TxMsg UART_TxMsg; 
     static PLAYLIST last_playlist = STOP;
     static uint32_t start=0; uint32_t real_time=0;
 
@@ -59,14 +45,10 @@ void Broadcast::play(PLAYLIST playlist)
     buffer[4] = playlist&0xff;   //曲目低位
     buffer[5] = Checksum_Analise(buffer[3], buffer[4]);
     buffer[6] = Tail;
-	
-    UART_TxMsg.len = 7;
-    UART_TxMsg.data_addr = buffer;
-    UART_TxMsg.huart = &huart1;
-    
+
     if(last_playlist != playlist && playlist != POS_ERROR && playlist != STOP)
     {
-        xQueueSend(UART_TxPort, &UART_TxMsg, 0);
+        Uart_Transmit(&huart1, buffer, 7);
     }
 
     if(playlist == POS_ERROR)   //2s播报一次
@@ -74,15 +56,12 @@ void Broadcast::play(PLAYLIST playlist)
         static uint8_t flag=0;
         if(flag==0)
         {
-            start = get_systemTick();
+            start = Get_SystemTimer();
             flag = 1;
-			xQueueSend(UART_TxPort, &UART_TxMsg, 0);
+			Uart_Transmit(&huart1, buffer, 7);
         }
 
-        if(get_systemTick() - start > 0)
-            real_time = get_systemTick()/1000 - start/1000;
-        else
-            real_time = (get_systemTick()+0xFFFFFFFF)/1000 - start/1000;
+        real_time = (Get_SystemTimer() - start)/1000;
 
         if(real_time > 3000)    //2s
         {
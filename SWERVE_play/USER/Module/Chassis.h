@@ -4,8 +4,12 @@
 #include "pid.h"
 #include "service_config.h"
 #include "drive_tim.h"
+#include "fastmath.h"
+#include "motion_profile.h"
+#include "kinematics.h"
+#include "power_budget.h"
+#include "fault_monitor.h"
 
-typedef uint32_t (*SystemTick_Fun)(void);
 #define PI 3.1415926f
 
 #ifdef __cplusplus
@@ -20,26 +24,35 @@ typedef struct Swerve_t     //used for swerve chassis
     float now_angle;    //the now angle of rudder
 }Swerve_t;
 
+//舵轮舵向回零状态
+typedef enum HOMING_STATE
+{
+    HOMING_IDLE,
+    HOMING_RUN,
+    HOMING_DONE,
+    HOMING_FAILED       //超时，未收敛的模组见get_homing_fail()，下一周期自动重试
+}HOMING_STATE;
+
 typedef struct Wheel_t    //used for mecanum chassis and omni chassis
 {
     int num;
     float wheel_vel;
 }Wheel_t;
 
-enum CHASSIS_PID_E
+//轮速饱和时的处理策略
+typedef enum DESAT_POLICY
 {
-    RUDDER_LEFT_FRONT_Speed_E,
-    RUDDER_RIGHT_FRONT_Speed_E,
-    RUDDER_LEFT_REAR_Speed_E,
-    RUDDER_RIGHT_REAR_Speed_E,
-    RUDDER_LEFT_FRONT_Pos_E,
-    RUDDER_RIGHT_FRONT_Pos_E,
-    RUDDER_LEFT_REAR_Pos_E,
-    RUDDER_RIGHT_REAR_Pos_E
-};
+    DESAT_PROPORTIONAL,         //平移、旋转同比例缩小，保持底盘运动轨迹
+    DESAT_FAVOUR_TRANSLATION,   //优先保留平移速度，先削减旋转速度
+    DESAT_FAVOUR_ROTATION       //优先保留旋转速度，先削减平移速度
+}DESAT_POLICY;
 
-extern Motor_GM6020 RudderMotor[4];
-extern VESC WheelMotor[4];
+//舵轮底盘的PID，每个模组一组
+enum SWERVE_PID_E
+{
+    RUDDER_SPEED_PID,
+    RUDDER_POS_PID
+};
 
 #ifdef __cplusplus
 }
@@ -48,15 +61,23 @@ class Chassis_Base
 {
 public:
     Chassis_Base(float Wheel_Radius, float Wheel_Track, float Chassis_Radius,int wheel_num){}
-    static uint8_t getMicroTick_regist(uint32_t (*getTick_fun)(void));
 
     Robot_Twist_t Speed_Max={0};
+    float Wheel_RPM_Max=0;      //轮向电机转速上限，单位与电机的速度指令相同(VESC为eRPM)，为0时不进行轮速饱和处理
+    DESAT_POLICY desat_policy=DESAT_PROPORTIONAL;
+    TwistProfiler profiler;     //底盘速度规划器，加速度和加加速度限制在profiler.Accel_Max、profiler.Jerk_Max中配置
+
+    bool heading_hold=false;    //航向保持，没有旋转指令时用IMU偏航角闭环，修正底盘的角度漂移
+    PID PID_Heading;            //航向保持PID，输入偏航角(度)，输出角速度(rad/s)
+    void Imu_Update(float yaw, float yaw_rate, bool online);
+
+    Chassis_Odom_t get_odometry(void) const { return odom; }
+    void Odometry_Reset(void);
 
     Robot_Twist_t RoboSpeed_To_WorldSpeed(Robot_Twist_t RoboSpeed, float YawAngle_Now)
     {
         Robot_Twist_t WorldSpeed;
-        TRANS_COS = cos (YawAngle_Now*PI/180);
-        TRANS_SIN = sin (YawAngle_Now*PI/180);
+        fast_sincosf(YawAngle_Now*FAST_DEG2RAD, &TRANS_SIN, &TRANS_COS);
 
         WorldSpeed.linear.x  = (RoboSpeed.linear.x * TRANS_COS + RoboSpeed.linear.y * TRANS_SIN);
         WorldSpeed.linear.y  = -(RoboSpeed.linear.x * TRANS_SIN - RoboSpeed.linear.y * TRANS_COS);
@@ -65,8 +86,6 @@ public:
     }
 
 protected:
-    static SystemTick_Fun get_systemTick;
-
     template<typename Type> 
     void Constrain(Type *x, Type Min, Type Max) 
     {
@@ -98,102 +117,292 @@ protected:
     }
 
     uint8_t update_timeStamp(void);
-    
+
+    /**
+     * @brief 计算底盘速度为twist时，所有轮子中最大的电机转速(绝对值)。各底盘根据自己的逆运动学实现
+     */
+    virtual float Wheel_Speed_Peak(Robot_Twist_t twist) { return 0; }
+    Robot_Twist_t Twist_Desaturate(Robot_Twist_t twist);
+    Robot_Twist_t Field_Oriented(Robot_Twist_t twist);
+    float Heading_Hold(float wz);
+    void Odometry_Update(Robot_Twist_t vel);
+
+    Chassis_Odom_t odom={0};
     Robot_Twist_t cmd_vel_={0};
     float  dt;
     uint32_t last_time;
+
+    float yaw_now=0;            //IMU偏航角，度
+    float yaw_rate_now=0;       //IMU偏航角速度，度/s
+    float heading_target=0;     //航向保持的目标角度，度
+    bool heading_locked=false;
+    bool imu_online=false;
 private:
-    double TRANS_SIN,TRANS_COS;
+    float TRANS_SIN,TRANS_COS;
 };
 
 
+//构造电机数组用的编译期序号，Make_Index<N>::type为Index_Seq<0, ..., N-1>
+template<int... I> struct Index_Seq {};
+template<int M, int... I> struct Make_Index : Make_Index<M-1, M-1, I...> {};
+template<int... I> struct Make_Index<0, I...> { typedef Index_Seq<I...> type; };
+
+
+/**
+ * @brief 舵轮底盘，舵向电机、轮向电机和模组数为模板参数。电机归底盘对象所有，ID为1~N，
+ *        CAN接收中调用Rudder_Update、Wheel_Update更新电机数据。
+ *        成员函数在Swerve_Chassis.cpp中实现并显式实例化，换用其他电机或模组数时在该文件末尾添加一行实例化。
+ *
+ * @tparam Rudder_Type 舵向电机，Motor_GM6020
+ * @tparam Wheel_Type 轮向电机，VESC
+ * @tparam N 模组数，故障监测和电流预算中每个模组占两个通道
+ */
+template<class Rudder_Type, class Wheel_Type, int N>
 class Swerve_Chassis : public Chassis_Base
 {
+    static_assert(N >= 2 && 2*N <= FAULT_MAX_CHANNEL && 2*N <= POWER_MAX_CHANNEL, "too many swerve modules");
 public:
-    Swerve_Chassis(float Wheel_Radius, float Wheel_Track, float Chassis_Radius,int wheel_num) : Chassis_Base(Wheel_Radius, Wheel_Track, Chassis_Radius,wheel_num)
-    {
-        this->Wheel_Radius = Wheel_Radius;
-        this->Wheel_Track = Wheel_Track;
-        this->Chassis_Radius = Chassis_Radius;
-        this->wheel_num = wheel_num;
-        this->cmd_vel_.chassis_mode = NORMAL;
-        swerve[0].num = 1;
-        swerve[1].num = 2;
-        swerve[2].num = 3;
-        swerve[3].num = 4;
-    }
+    static const int WHEEL_NUM = N;
+
+    /**
+     * @param gear_ratio 轮向电机速度指令与轮子转速(rpm)之比，VESC的eRPM为 极对数*减速比
+     */
+    Swerve_Chassis(float Wheel_Radius, float gear_ratio, float Chassis_Radius)
+        : Swerve_Chassis(Wheel_Radius, gear_ratio, Chassis_Radius, typename Make_Index<N>::type()) {}
+
+    Rudder_Type RudderMotor[N];     //舵向电机，CAN1
+    Wheel_Type WheelMotor[N];       //轮向电机，CAN2
 
-    float theta=99.26;  //底盘两对对角轮连线的夹角，用于解算轮子速度
-    float accel_vel=0; //底盘加速度
     bool chassis_is_init = false;
+    float Homing_Tolerance = 1.5f;      //回零角度容差，度
+    uint32_t Homing_Settle = 50000;     //在容差内保持该时间认为收敛，us
+    uint32_t Homing_Timeout = 1500000;  //回零超时，us
+    void Rehome(void);
+    void Theta_Set(float theta);
+    float get_theta(void) const { return theta; }
+    HOMING_STATE get_homing_state(void) const { return homing_state; }
+    uint8_t get_homing_fail(void) const { return homing_fail; }    //第i位为1表示第i+1个模组上次回零未收敛
+    uint32_t get_homing_time(void) const { return homing_time; }   //上次回零耗时，us
+    Power_Budget power;         //电流预算，通道0~N-1为舵向电机，N~2N-1为轮向电机
+    Fault_Monitor fault;        //电机故障监测，通道0~N-1为舵向电机，N~2N-1为轮向电机
     void Control(Robot_Twist_t cmd_vel);
     int Motor_Control(void);
-    void Pid_Param_Init(CHASSIS_PID_E PID_Type, float Kp, float Ki, float Kd, float Integral_Max, float Out_Max, float DeadZone);
-    void Pid_Mode_Init(CHASSIS_PID_E PID_Type, float LowPass_error, float LowPass_d_err, bool D_of_Current, bool Imcreatement_of_Out);
+    bool Rudder_Update(uint32_t std_id, uint8_t *data);
+    void Wheel_Update(CAN_RxBuffer *buffer);
+    bool Pid_Param_Init(int num, SWERVE_PID_E PID_Type, float Kp, float Ki, float Kd, float Integral_Max, float Out_Max, float DeadZone);
+    bool Pid_Mode_Init(int num, SWERVE_PID_E PID_Type, float LowPass_error, float LowPass_d_err, bool D_of_Current, bool Imcreatement_of_Out);
 
 private:
-    int wheel_num = 0;
-    Swerve_t swerve[4];
-    float Wheel_Radius = 0.038;
-    float Wheel_Track = 0;
-    float Chassis_Radius = 0.641/2;
-    float COS=cos(99.26/2),SIN=sin(99.26/2);
-    int N=0;    //记录舵向转过的圈数
-    uint8_t reset_flag=2;
+    template<int... I>
+    Swerve_Chassis(float Wheel_Radius, float gear_ratio, float Chassis_Radius, Index_Seq<I...>);
+
+    Swerve_t swerve[N];
+    float Wheel_Radius = 0;
+    float gear_ratio = 21;
+    float Chassis_Radius = 0;
+    float theta = 99.26f;   //两对对角模组连线的夹角，度，决定模组安装位置(运动学)和锁止时的舵向角度，需在kinematics之前初始化
+    Swerve_Kinematics<N> kinematics;
+
+    /**
+     * @brief 第i个模组在底盘上的方位角，度，x向前、y向左。
+     *        四个模组时顺序为左前、右前、右后、左后，theta为两对对角模组连线的夹角；其他模组数时从正前方起逆时针均匀分布
+     */
+    static float Module_Angle(int i, float theta)
+    {
+        if(N == 4)
+        {
+            const float angle[4] = {theta/2, -theta/2, 180+theta/2, 180-theta/2};
+            return angle[i];
+        }
+        return 360.0f*i/N;
+    }
+
+    //模组安装在半径为R的圆上
+    static Swerve_Kinematics<N> Geometry(float R, float theta)
+    {
+        float px[N], py[N], s, c;
+        for(int i=0; i<N; i++)
+        {
+            fast_sincosf(Module_Angle(i, theta)*FAST_DEG2RAD, &s, &c);
+            px[i] = R*c;
+            py[i] = R*s;
+        }
+        return Swerve_Kinematics<N>(px, py);
+    }
+    int N_round=0;  //记录舵向转过的圈数
     uint8_t lock_flag=0;
-    bool Chassis_Safety_Check(float Current_Max);
-    void Reset(void);
+    int send_flag=0;                //轮向电机轮流发送的序号
+    HOMING_STATE homing_state = HOMING_IDLE;
+    uint32_t homing_start = 0;
+    uint32_t homing_time = 0;
+    uint32_t settle_since[N] = {0};
+    float homing_target[N] = {0};
+    uint8_t homing_fail = 0;
+    bool homing_target_valid = false;
+    float rudder_out_max[N] = {0};  //舵向速度环原始的输出限幅
+    int32_t last_wheel_speed[N] = {0};  //上一周期轮向电机的实际转速
+    float accel_scale = 1;          //电流预算给出的加速度缩放系数
+    void Power_Allocate(void);
+    void Fault_Check(void);
+    void Homing(void);
+    bool Homing_Target_Update(void);
     void RudderAngle_Adjust(Swerve_t *swerve);
     void Chassis_Lock(Swerve_t *swerve);
+    void Module_Velocity(Robot_Twist_t cmd_vel, int num, float *wheel_Vx, float *wheel_Vy);
+    virtual float Wheel_Speed_Peak(Robot_Twist_t twist);
     void Velocity_Calculate(Robot_Twist_t cmd_vel, Swerve_t *swerve);
     void X_Velocity_Calculate(Robot_Twist_t cmd_vel, Swerve_t *swerve);
     void Y_Velocity_Calculate(Robot_Twist_t cmd_vel, Swerve_t *swerve);
 
-    PID PID_Rudder_Speed[4];
-    PID PID_Rudder_Pos[4];
+    PID PID_Rudder_Speed[N];
+    PID PID_Rudder_Pos[N];
 };
 
 
-class Omni_Chassis : public Chassis_Base
+/**
+ * @brief 轮速闭环的底盘(全向轮、麦轮)，运动学策略、电机类型和轮子数为模板参数。
+ *        电机归底盘对象所有，ID为1~N，CAN接收中调用Motor_Update更新电机数据。
+ *        所有按轮子的循环在编译期展开，不同底盘之间没有运行时分支。
+ *
+ * @tparam Kinematics 运动学策略，Omni_Kinematics<N>或Mecanum_Kinematics
+ * @tparam Motor_Type 轮向电机，Motor_C620或Motor_C610
+ * @tparam N 轮子数
+ */
+template<class Kinematics, class Motor_Type, int N>
+class Chassis : public Chassis_Base
 {
+    static_assert(Kinematics::WHEELS == N && Kinematics::ROWS == N, "kinematics does not match wheel number");
 public:
-    Omni_Chassis(float Wheel_Radius, float Wheel_Track, float Chassis_Radius,int wheel_num) : Chassis_Base(Wheel_Radius, Wheel_Track, Chassis_Radius, wheel_num)
+    static const int WHEEL_NUM = N;
+
+    /**
+     * @param gear_ratio 电机减速比，M3508为19，M2006为36
+     * @param kinematics 底盘几何参数，如Omni_Kinematics<4>(Chassis_Radius)
+     */
+    Chassis(float Wheel_Radius, float gear_ratio, const Kinematics &kinematics)
+        : Chassis(Wheel_Radius, gear_ratio, kinematics, typename Make_Index<N>::type()) {}
+
+    Motor_Type motor[N];
+
+    void Control(Robot_Twist_t cmd_vel)
     {
-        this->Wheel_Radius = Wheel_Radius;
-        this->Wheel_Track = Wheel_Track;
-        this->Chassis_Radius = Chassis_Radius;
-        this->wheel_num = wheel_num;
-        wheel[0].num = 1;
-        wheel[1].num = 2;
-        wheel[2].num = 3;
-        wheel[3].num = 4;
+        update_timeStamp();
+
+        cmd_vel_ = cmd_vel;
+        Constrain(&cmd_vel_.linear.x, -Speed_Max.linear.x, Speed_Max.linear.x);
+        Constrain(&cmd_vel_.linear.y, -Speed_Max.linear.y, Speed_Max.linear.y);
+        Constrain(&cmd_vel_.angular.z, -Speed_Max.angular.z, Speed_Max.angular.z);
+
+#if USE_VEL_ACCEL
+        cmd_vel_ = profiler.Update(cmd_vel_, dt);
+#endif
+
+        if(cmd_vel.chassis_mode == FIELD)
+            cmd_vel_ = Field_Oriented(cmd_vel_);
+        cmd_vel_.angular.z = Heading_Hold(cmd_vel_.angular.z);
+
+        //轮速饱和处理，按desat_policy缩小底盘速度
+        cmd_vel_ = Twist_Desaturate(cmd_vel_);
+        kinematics.Inverse(cmd_vel_, wheel_vel);
+
+        const float k = ChassisVel_Trans_MotorRPM(Wheel_Radius, gear_ratio);
+        Unroll<0, N>::Run([&](int i)
+        {
+            PID_Wheel[i].current = motor[i].get_speed();
+            PID_Wheel[i].target = wheel_vel[i]*k;
+            motor[i].Out = PID_Wheel[i].Adjust();
+        });
+
+        Odometry_Calculate();
     }
 
-    bool Pid_Param_Init(int num, float Kp, float Ki, float Kd, float Integral_Max, float OUT_Max, float DeadZone);
-    bool Pid_Mode_Init(int num, float LowPass_error, float LowPass_d_err, bool D_of_Current, bool Imcreatement_of_Out);
+    void Motor_Control(void)
+    {
+        RM_Motor_SendMsgs(&hcan1, motor);
+    }
 
-    void Control(Robot_Twist_t cmd_vel);
-    void Motor_Control(void);
-    void Reset(void);
-private:
-    PID PID_Wheel[4];
-    Wheel_t wheel[4];
-    int wheel_num = 0;
-    float Wheel_Radius = 0.152f/2;
-    float Wheel_Track = 0;
-    float Chassis_Radius = 0.641/2;
-    float COS45=cos(PI/4),SIN45=sin(PI/4);
-    float COS30=cos(PI/6),SIN30=sin(PI/6);
-    void Velocity_Calculate(Robot_Twist_t cmd_vel);
-};
+    /**
+     * @brief 在CAN接收回调中调用，按标准帧ID更新对应电机
+     * @return false 不是该底盘的电机
+     */
+    bool Motor_Update(uint32_t std_id, uint8_t *data)
+    {
+        uint32_t index = std_id - motor[0].receive_id_init() - 1;
+        if(index >= (uint32_t)N)
+            return false;
+        motor[index].update(data);
+        return true;
+    }
 
+    bool Pid_Param_Init(int num, float Kp, float Ki, float Kd, float Integral_Max, float OUT_Max, float DeadZone)
+    {
+        if(num < 0 || num >= N)
+            return false;
+        PID_Wheel[num].PID_Param_Init(Kp, Ki, Kd, Integral_Max, OUT_Max, DeadZone);
+        return true;
+    }
+
+    bool Pid_Mode_Init(int num, float LowPass_error, float LowPass_d_err, bool D_of_Current, bool Imcreatement_of_Out)
+    {
+        if(num < 0 || num >= N)
+            return false;
+        PID_Wheel[num].PID_Mode_Init(LowPass_error, LowPass_d_err, D_of_Current, Imcreatement_of_Out);
+        return true;
+    }
 
-class Mecanum_Chassis : public Chassis_Base
-{
-public:
-    
 private:
+    template<int... I>
+    Chassis(float Wheel_Radius, float gear_ratio, const Kinematics &kinematics, Index_Seq<I...>)
+        : Chassis_Base(Wheel_Radius, 0, 0, N), motor{Motor_Type(I+1)...}, kinematics(kinematics)
+    {
+        this->Wheel_Radius = Wheel_Radius;
+        this->gear_ratio = gear_ratio;
+        this->cmd_vel_.chassis_mode = NORMAL;
+    }
 
+    Kinematics kinematics;
+    PID PID_Wheel[N];
+    float wheel_vel[N] = {0};  //轮面线速度，m/s
+    float Wheel_Radius = 0;
+    float gear_ratio = 19;
+
+    /**
+     * @brief 底盘速度为twist时，所有电机中最大的转速
+     */
+    virtual float Wheel_Speed_Peak(Robot_Twist_t twist)
+    {
+        return kinematics.Peak(twist)*ChassisVel_Trans_MotorRPM(Wheel_Radius, gear_ratio);
+    }
+
+    /**
+     * @brief 由电机实测转速计算底盘速度并积分里程计
+     */
+    void Odometry_Calculate(void)
+    {
+        float vel[N];
+        Robot_Twist_t twist = {0};
+        const float k = MotorRPM_Trans_ChassisVel(Wheel_Radius, gear_ratio);
+
+        Unroll<0, N>::Run([&](int i){ vel[i] = motor[i].get_speed()*k; });
+        if(kinematics.Forward(vel, &twist))
+            Odometry_Update(twist);
+    }
 };
 
+typedef Swerve_Chassis<Motor_GM6020, VESC, 4> Swerve4_Chassis;
+typedef Chassis<Omni_Kinematics<3>, Motor_C620, 3> Omni3_Chassis;
+typedef Chassis<Omni_Kinematics<4>, Motor_C620, 4> Omni4_Chassis;
+typedef Chassis<Mecanum_Kinematics, Motor_C620, 4> Mecanum_Chassis;
+
+//CHASSIS_TYPE选择的底盘
+#if CHASSIS_TYPE == SWERVE_CHASSIS
+typedef Swerve4_Chassis Chassis_Type;
+#elif CHASSIS_TYPE == OMNI3_CHASSIS
+typedef Omni3_Chassis Chassis_Type;
+#elif CHASSIS_TYPE == OMNI4_CHASSIS
+typedef Omni4_Chassis Chassis_Type;
+#elif CHASSIS_TYPE == MECANUM_CHASSIS
+typedef Mecanum_Chassis Chassis_Type;
+#endif
+
 #endif
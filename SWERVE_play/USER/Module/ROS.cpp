@@ -1,6 +1,10 @@
 /**
  * @file ROS.cpp
- * @brief 上下位机的通信文件，包括数据的打包和解包，数据的发送和接收。使用串口DMA
+ * @brief 上下位机的通信文件，负责下行数据的解包。串口为循环DMA接收，任务中周期读取新字节，
+ *        由Frame_Parser按字节流解析，处理半帧、粘包和错误后的重新同步。上行的底盘状态由telemetry.cpp发送。
+ *        下行帧按长度区分：19字节为旧格式控制帧；ROS_MSG_CMD为带上位机时间戳的控制帧，对时后计算帧龄，
+ *        超过ROS_CMD_AGE_MAX的丢弃；ROS_MSG_SYNC为对时请求，应答随下一帧遥测发送(见clock_sync.h、telemetry.cpp)。
+ *        对时请求的接收时刻t2取空闲中断记录的时刻(请求是这批数据的最后一帧时)，否则取读取时刻，误差为任务周期。
  * @version 0.1
  * @date 2024-04-15
  * 
@@ -8,8 +12,12 @@
  * 
  */
 #include "ROS.h"
+#include <string.h>
 
-SystemTick_Fun ROS::get_systemTick = NULL;
+volatile uint32_t ROS::idle_time = 0;
+volatile bool ROS::idle_new = false;
+
+Clock_Sync host_clock;
 
 union ROS_data
 {
@@ -18,93 +26,147 @@ union ROS_data
 }x,y,z;
 
 
-uint8_t ROS::getMicroTick_regist(uint32_t (*getTick_fun)(void))
+/**
+ * @brief 串口空闲中断中调用，记录一批数据收完的时刻
+ */
+void ROS::Rx_Idle_Stamp(void)
 {
-    if(getTick_fun != NULL)
-    {
-        ROS::get_systemTick = getTick_fun;
-        return 1;
-    }
-    else 
-        return 0;
+    idle_time = Get_SystemTimer();
+    idle_new = true;
+}
+
+
+static uint32_t Get_U32(const uint8_t *buffer)
+{
+    uint32_t value;
+    memcpy(&value, buffer, 4);
+    return value;
 }
 
 
 /**
- * @brief stm32 send data to ROS
- * 
+ * @brief 读取循环DMA缓存中新收到的字节并解析，在任务中周期调用
+ * @param manager ROS串口，需用Uart_Stream_Init初始化
+ * @return uint8_t 本次解析出的有效控制帧数，多帧时readFromRosData为最新一帧
  */
-void ROS::Send_To_ROS(void)
+uint8_t ROS::Recieve_From_Stream(usart_manager_t *manager)
 {
-    uint8_t buffer[1+6];
-    int index = 0;
-    buffer[index++] = header[0];
-    buffer[index++] = header[1];
-    buffer[index++] = 1;
-    buffer[index++] = 0;
-    buffer[index++] = serial_get_crc8_value(buffer, 4);
-    buffer[index++] = tail[0];
-    buffer[index++] = tail[1];
+    const uint8_t *data, *payload;
+    uint16_t len;
+    uint8_t payload_len, frames = 0;
+
+    rx_time = Get_SystemTimer();
+    bool idle_valid = idle_new;
+    uint32_t idle_stamp = idle_time;
+    idle_new = false;
+
+    //缓存回绕时分两段读取
+    for(int i=0; i<2; i++)
+    {
+        len = Uart_Stream_Peek(manager, &data);
+        if(len == 0)
+            break;
+        parser.Push(data, len);
+        Uart_Stream_Consume(manager, len);
+
+        while(parser.Next(&payload, &payload_len))
+        {
+            int8_t result = Recieve_From_ROS(payload, payload_len);
+            if(result == ROS_RX_CMD)
+                frames++;
+            sync_last = (result == ROS_RX_SYNC);
+        }
+    }
+
+    //对时请求在本批最后时，空闲中断的时刻就是它收完的时刻
+    if(sync_pending)
+    {
+        const uint8_t *p = sync_request;
+        uint32_t t2 = (sync_last && idle_valid && (int32_t)(rx_time - idle_stamp) >= 0) ? idle_stamp : rx_time;
+        host_clock.Request(p[1], Get_U32(p + 2), t2, p[6], Get_U32(p + 7));
+        sync_pending = false;
+    }
+    return frames;
 }
 
 
 /**
  * @brief upack the data from ROS
- * @param buffer pack that recieved from ROS
- * @return int8_t unpack success return 0, else return 1
+ * @param payload data of a frame that passed header, length, tail and crc check
+ * @param len length of payload
+ * @return int8_t ROS_RX_xxx
  */
-int8_t ROS::Recieve_From_ROS(uint8_t *buffer)
+int8_t ROS::Recieve_From_ROS(const uint8_t *payload, uint8_t len)
 {
-    int index = 0;
-    for(int i = 0; i < 2; i++)
+    if(len == ROS_PAYLOAD_SIZE)
     {
-        if(buffer[index++] != header[i])
-            return 2;
+        cmd_age = -1;
+        Cmd_Decode(payload);
+        return ROS_RX_CMD;
     }
 
-    lenth = buffer[index++];
+    if(len == ROS_SYNC_SIZE && payload[0] == ROS_MSG_SYNC)
+    {
+        memcpy(sync_request, payload, ROS_SYNC_SIZE);
+        sync_pending = true;
+        return ROS_RX_SYNC;
+    }
 
-    for(int i=0; i<2; i++)
+    if(len == ROS_CMD_SIZE && payload[0] == ROS_MSG_CMD)
     {
-        if(buffer[4+lenth+i] != tail[i])
-            return 1;
+        if(host_clock.is_synced(rx_time))
+        {
+            cmd_age = (int32_t)(host_clock.To_Host(rx_time) - Get_U32(payload + 1 + ROS_PAYLOAD_SIZE));
+            if(cmd_age > cmd_age_max)
+                cmd_age_max = cmd_age;
+            if(cmd_age > ROS_CMD_AGE_MAX)
+            {
+                cmd_stale++;
+                return ROS_RX_STALE;
+            }
+        }
+        else
+        {
+            cmd_age = -1;
+        }
+        Cmd_Decode(payload + 1);
+        return ROS_RX_CMD;
     }
-    
+
+    return ROS_RX_ERROR;
+}
+
+
+/**
+ * @brief 解析旧格式的19字节控制数据
+ */
+void ROS::Cmd_Decode(const uint8_t *payload)
+{
+    int index = 0;
+
     for(int i=0; i<4; i++)
     {
-        x.c[i] = buffer[index++];
+        x.c[i] = payload[index++];
     }
 
     for(int i=0; i<4; i++)
     {
-        y.c[i] = buffer[index++];
+        y.c[i] = payload[index++];
     }
 
     for(int i=0; i<4; i++)
     {
-        z.c[i] = buffer[index++];
+        z.c[i] = payload[index++];
     }
 
     readFromRosData.x = x.f;
     readFromRosData.y = y.f;
     readFromRosData.z = z.f;
-    readFromRosData.ctrl_mode = buffer[index++];
-    readFromRosData.ctrl_flag = buffer[index++];
-    readFromRosData.chassis_init = buffer[index++];
-    readFromRosData.status.robot_init = (PLAYLIST)buffer[index++];
-    readFromRosData.status.path_mode = (PLAYLIST)buffer[index++];
-    readFromRosData.status.sensor = (PLAYLIST)buffer[index++];
-    readFromRosData.status.control_mode = (PLAYLIST)buffer[index++];
-
-    if(buffer[index++]!=serial_get_crc8_value(buffer, lenth+3))
-    {
-        readFromRosData.x = 0;
-        readFromRosData.y = 0;
-        readFromRosData.z = 0;
-        readFromRosData.ctrl_mode = NORMAL;
-        readFromRosData.ctrl_flag = 0;
-        readFromRosData.chassis_init = false;
-    }
-
-    return 0;
+    readFromRosData.ctrl_mode = payload[index++];
+    readFromRosData.ctrl_flag = payload[index++];
+    readFromRosData.chassis_init = payload[index++];
+    readFromRosData.status.robot_init = (PLAYLIST)payload[index++];
+    readFromRosData.status.path_mode = (PLAYLIST)payload[index++];
+    readFromRosData.status.sensor = (PLAYLIST)payload[index++];
+    readFromRosData.status.control_mode = (PLAYLIST)payload[index++];
 }
@@ -3,6 +3,24 @@
 #include "drive_uart.h"
 #include "data_pool.h"
 #include "tool.h"
+#include "serial_tool.h"
+#include "clock_sync.h"
+#include "sys_clock.h"
+
+//下行控制帧的数据长度：x、y、z(float) + ctrl_mode、ctrl_flag、chassis_init + 4个状态，没有消息类型字节(旧格式)
+#define ROS_PAYLOAD_SIZE 19
+
+//带消息类型的下行帧，按长度和第一个字节区分
+#define ROS_MSG_SYNC        0x20    //对时请求 [0x20][seq][t1][last_seq][last_t4]，时间为uint32 us
+#define ROS_SYNC_SIZE       11
+#define ROS_MSG_CMD         0x21    //带时间戳的控制帧 [0x21][与旧格式相同的19字节][发送时刻，上位机时钟]
+#define ROS_CMD_SIZE        (ROS_PAYLOAD_SIZE + 5)
+
+//Recieve_From_ROS的返回值
+#define ROS_RX_CMD          0       //控制帧，已更新readFromRosData
+#define ROS_RX_ERROR        1       //长度或类型不对
+#define ROS_RX_SYNC         2       //对时请求
+#define ROS_RX_STALE        3       //控制帧超时，已丢弃
 
 typedef struct readFromRos
 {
@@ -15,7 +33,6 @@ typedef struct readFromRos
     Robot_Status_t status;
 }readFromRos;
 
-typedef uint32_t (*SystemTick_Fun)(void);
 
 #ifdef __cplusplus
 
@@ -29,17 +46,30 @@ public:
         tail[0] = 0x0D;
         tail[1] = 0x0A;
     }
-    void Send_To_ROS(void);
-    int8_t Recieve_From_ROS(uint8_t *buffer);
+    uint8_t Recieve_From_Stream(usart_manager_t *manager);
+    int8_t Recieve_From_ROS(const uint8_t *payload, uint8_t len);
+    Frame_Parser_Stats_t get_stats(void) const { return parser.get_stats(); }
     readFromRos readFromRosData;
-    static uint8_t getMicroTick_regist(uint32_t (*getTick_fun)(void));
-    static SystemTick_Fun get_systemTick;
-    
+    static void Rx_Idle_Stamp(void);
+
+    int32_t cmd_age = -1;       //最近一帧控制帧从上位机发出到收到的时间，us，-1表示未知(旧格式或未对时)
+    int32_t cmd_age_max = 0;
+    uint32_t cmd_stale = 0;     //超过ROS_CMD_AGE_MAX被丢弃的控制帧数
+
 private:
-    UART_TxMsg TxMsg;
     uint8_t header[2];
     uint8_t tail[2];
-    uint8_t lenth=0;
+    Frame_Parser parser = Frame_Parser();
+    uint32_t rx_time = 0;       //本批数据收完的时刻
+    uint8_t sync_request[ROS_SYNC_SIZE];
+    bool sync_pending = false, sync_last = false;
+
+    static volatile uint32_t idle_time;
+    static volatile bool idle_new;
+
+    void Cmd_Decode(const uint8_t *payload);
 };
 
+extern Clock_Sync host_clock;
+
 #endif
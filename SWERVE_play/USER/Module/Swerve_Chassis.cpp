@@ -3,9 +3,9 @@
  * @author Yang JinaYi (2807643517@qq.com)
  * @brief 舵轮底盘控制类，包括舵轮底盘的速度控制、PID参数初始化、电机控制等
  * @note 1)使用该文件，需要在main.c中调用Chassis_Pid_Init函数进行PID参数初始化，在任务循环中调用chassis.Control(twist)进行速度控制，调用chassis.Motor_Control()进行电机控制
- *       2)由于八期R2底盘采用GM6020作为舵向，VESC驱动轮向电机，因此需要为这个类创建两个对象，一个是Motor_GM6020，一个是VESC。并且需要在service_communication.cpp
- *         中的can接收函数更新电机的实时参数信息，包括速度、角度等。
- *       3)如果需要更改轮向电机类型，ChassisVel_Trans_MotorRPM函数中的电机极对数需要更改。(有人继承寄轩师兄的舵轮的话)
+ *       2)八期R2底盘采用GM6020作为舵向，VESC驱动轮向电机，即Swerve4_Chassis。电机是底盘的成员，
+ *         在service_communication.cpp的can接收函数中调用chassis.Rudder_Update、chassis.Wheel_Update更新电机的实时参数信息。
+ *       3)如果需要更改轮向电机类型，构造时的gear_ratio(VESC为极对数*减速比)需要更改，并在文件末尾添加对应的显式实例化。
  * @version 0.1
  * @date 2024-04-09
  * 
@@ -14,10 +14,6 @@
  */
 #include "Chassis.h"
 
-Motor_GM6020 RudderMotor[4] = {Motor_GM6020(1), Motor_GM6020(2), Motor_GM6020(3), Motor_GM6020(4)};
-VESC WheelMotor[4] = {VESC(1), VESC(2), VESC(3), VESC(4)};
-
-SystemTick_Fun Chassis_Base::get_systemTick = NULL;
 
 int32_t ABS(int32_t a)
 {
@@ -28,60 +24,265 @@ int32_t ABS(int32_t a)
 }
 
 
+
 /**
- * @brief 定时器获取函数初始化，在config文件中进行条用
+ * @brief 计算任务循环时间
  * 
- * @param getTick_fun 
  * @return uint8_t 
  */
-uint8_t Chassis_Base::getMicroTick_regist(uint32_t (*getTick_fun)(void))
+uint8_t Chassis_Base::update_timeStamp(void)
 {
-    if(getTick_fun != NULL)
+    uint32_t now_time = Get_SystemTimer();
+
+    if(last_time == 0)
     {
-        Chassis_Base::get_systemTick = getTick_fun;
+        last_time = now_time;
+        dt = 0;
         return 1;
     }
-    else
-        return 0;
+
+    //无符号减法，32位回绕时仍然正确
+    dt = (float)(now_time - last_time) * 0.000001f;
+    last_time = now_time;
+    return 0;
 }
 
 
 /**
- * @brief 计算任务循环时间
- * 
- * @return uint8_t 
+ * @brief 轮速饱和处理。在逆运动学解算前，检查底盘速度对应的最大轮速是否超过Wheel_RPM_Max，
+ *        超过时按desat_policy缩小底盘速度，保证所有轮子按同一比例缩小，底盘不偏离原来的轨迹
+ *
+ * @param twist 底盘速度
+ * @return Robot_Twist_t 处理后的底盘速度
  */
-uint8_t Chassis_Base::update_timeStamp(void)
+Robot_Twist_t Chassis_Base::Twist_Desaturate(Robot_Twist_t twist)
 {
-    uint32_t now_time=0;
+    if(Wheel_RPM_Max <= 0)
+        return twist;
+
+    float peak = Wheel_Speed_Peak(twist);
+    if(peak <= Wheel_RPM_Max)
+        return twist;
 
-    //Check get sysClock
-    if(Chassis_Base::get_systemTick != NULL)
+    Robot_Twist_t base = twist, extra = twist;
+    switch(desat_policy)
     {
-        if(last_time == 0)
+        case DESAT_FAVOUR_TRANSLATION:
+            base.angular.z = 0;
+            extra.linear.x = extra.linear.y = 0;
+            break;
+
+        case DESAT_FAVOUR_ROTATION:
+            base.linear.x = base.linear.y = 0;
+            extra.angular.z = 0;
+            break;
+
+        case DESAT_PROPORTIONAL:
+        default:
         {
-            last_time = Chassis_Base::get_systemTick();
-            return 1;
+            float k = Wheel_RPM_Max / peak;
+            twist.linear.x *= k;
+            twist.linear.y *= k;
+            twist.angular.z *= k;
+            return twist;
         }
-        now_time = Chassis_Base::get_systemTick();
+    }
 
-        //overflow
-        if(now_time < last_time)
-            dt = (float)((now_time + 0xFFFFFFFF) - last_time);  //now_time is 32bit, use 0XFFFFFFFF to avoid overflow
+    //优先保留的分量本身已经饱和，只能对它同比例缩小
+    float base_peak = Wheel_Speed_Peak(base);
+    if(base_peak >= Wheel_RPM_Max)
+    {
+        float k = Wheel_RPM_Max / base_peak;
+        base.linear.x *= k;
+        base.linear.y *= k;
+        base.angular.z *= k;
+        return base;
+    }
+
+    //二分查找另一分量能保留的最大比例，最大轮速关于比例是凸函数，k=0时不饱和，二分法有效
+    float lo = 0, hi = 1;
+    Robot_Twist_t test = base;
+    for(int i=0; i<10; i++)
+    {
+        float mid = (lo + hi) * 0.5f;
+        test.linear.x = base.linear.x + mid*extra.linear.x;
+        test.linear.y = base.linear.y + mid*extra.linear.y;
+        test.angular.z = base.angular.z + mid*extra.angular.z;
+        if(Wheel_Speed_Peak(test) <= Wheel_RPM_Max)
+            lo = mid;
         else
-            dt = (float)(now_time - last_time);
-        
-        last_time = now_time;
-        
-        dt *= 0.000001f;
+            hi = mid;
+    }
+
+    twist.linear.x = base.linear.x + lo*extra.linear.x;
+    twist.linear.y = base.linear.y + lo*extra.linear.y;
+    twist.angular.z = base.angular.z + lo*extra.angular.z;
+    return twist;
+}
+
 
-        return 0;
+/**
+ * @brief 更新IMU数据，在底盘任务中每个周期调用
+ *
+ * @param yaw 偏航角，度，需为连续值
+ * @param yaw_rate 偏航角速度，度/s
+ * @param online IMU是否在线，离线时世界坐标系控制和航向保持均不生效
+ */
+void Chassis_Base::Imu_Update(float yaw, float yaw_rate, bool online)
+{
+    yaw_now = yaw;
+    yaw_rate_now = yaw_rate;
+    imu_online = online;
+}
+
+
+/**
+ * @brief 世界坐标系的速度指令转换为底盘坐标系，IMU离线时不转换
+ */
+Robot_Twist_t Chassis_Base::Field_Oriented(Robot_Twist_t twist)
+{
+    if(imu_online == false)
+        return twist;
+
+    Robot_Twist_t res = RoboSpeed_To_WorldSpeed(twist, yaw_now);
+    res.chassis_mode = twist.chassis_mode;
+    return res;
+}
+
+
+/**
+ * @brief 航向保持。有旋转指令或底盘仍在转动时跟随当前角度，转动停止后锁定该角度，
+ *        之后用PID_Heading闭环输出角速度，修正碰撞、打滑等造成的角度漂移
+ *
+ * @param wz 底盘角速度指令，rad/s
+ * @return float 修正后的角速度指令
+ */
+float Chassis_Base::Heading_Hold(float wz)
+{
+    if(heading_hold == false || imu_online == false || wz > 0.05f || wz < -0.05f)
+    {
+        heading_locked = false;
+        heading_target = yaw_now;
+        return wz;
     }
+
+    //等待底盘停止转动后再锁定角度，防止回摆
+    if(heading_locked == false)
+    {
+        heading_target = yaw_now;
+        if(yaw_rate_now < 20 && yaw_rate_now > -20)
+            heading_locked = true;
+        return wz;
+    }
+
+    PID_Heading.target = heading_target;
+    PID_Heading.current = yaw_now;
+    return PID_Heading.Adjust();
+}
+
+
+/**
+ * @brief 里程计清零
+ */
+void Chassis_Base::Odometry_Reset(void)
+{
+    odom.x = 0;
+    odom.y = 0;
+    odom.yaw = imu_online ? yaw_now : 0;
+}
+
+
+/**
+ * @brief 里程计积分，在底盘控制函数中调用，dt由update_timeStamp得到
+ *
+ * @param vel 正运动学得到的底盘速度，底盘坐标系
+ */
+void Chassis_Base::Odometry_Update(Robot_Twist_t vel)
+{
+    float last_yaw = odom.yaw, s, c;
+
+    if(imu_online)
+        odom.yaw = yaw_now;
     else
+        odom.yaw += vel.angular.z * dt * FAST_RAD2DEG;
+
+    //取周期内的平均航向，减小转动时的积分误差
+    fast_sincosf((last_yaw + odom.yaw)*0.5f*FAST_DEG2RAD, &s, &c);
+    odom.x += (vel.linear.x*c - vel.linear.y*s) * dt;
+    odom.y += (vel.linear.x*s + vel.linear.y*c) * dt;
+    odom.vel = vel;
+}
+
+
+template<class Rudder_Type, class Wheel_Type, int N>
+template<int... I>
+Swerve_Chassis<Rudder_Type, Wheel_Type, N>::Swerve_Chassis(float Wheel_Radius, float gear_ratio, float Chassis_Radius, Index_Seq<I...>)
+    : Chassis_Base(Wheel_Radius, 0, Chassis_Radius, N), RudderMotor{Rudder_Type(I+1)...}, WheelMotor{Wheel_Type(I+1)...},
+      kinematics(Geometry(Chassis_Radius, theta))
+{
+    this->Wheel_Radius = Wheel_Radius;
+    this->gear_ratio = gear_ratio;
+    this->Chassis_Radius = Chassis_Radius;
+    this->cmd_vel_.chassis_mode = NORMAL;
+    for(int i=0; i<N; i++)
+        swerve[i].num = i+1;
+
+    //舵向优先分配电流，保证预算不足时底盘仍能转向
+    for(int i=0; i<N; i++)
+        power.Add_Channel(0);
+    for(int i=0; i<N; i++)
+        power.Add_Channel(1);
+
+    //故障监测，通道号与电流预算相同。阈值可在Chassis_Pid_Init中通过fault.threshold[]修改
+    const Fault_Threshold_t rudder_th = {15000, 70, 100000, 45, 2000000, 1000000, FAULT_AUTO_CLEAR};
+    const Fault_Threshold_t wheel_th  = {25000, 85, 200000, 0,  2000000, 1000000, FAULT_AUTO_CLEAR};
+    for(int i=0; i<N; i++)
+        fault.Add_Channel(rudder_th);
+    for(int i=0; i<N; i++)
+        fault.Add_Channel(wheel_th);
+}
+
+
+/**
+ * @brief 电流预算分配，每个控制周期调用一次。
+ *        轮向电机的电流取VESC上报的输入电流(STATUS_4)，舵向GM6020没有母线电流反馈，按 转矩电流*输出占空比 估计。
+ *        舵向按预算缩放速度环的输出限幅；轮向预算不足时逐周期降低速度规划器的加速度上限，预算恢复后慢慢放开。
+ */
+template<class Rudder_Type, class Wheel_Type, int N>
+void Swerve_Chassis<Rudder_Type, Wheel_Type, N>::Power_Allocate(void)
+{
+    float voltage=0;
+    int n=0;
+
+    for(int i=0; i<N; i++)
     {
-        dt = 0;
-        return 1;
+        float rudder = fabsf((float)RudderMotor[i].get_tarque())*(3.0f/16384.0f) * fabsf(RudderMotor[i].Out)/30000.0f;
+        float wheel = WheelMotor[i].get_input_current();
+        power.Set_Demand(i, rudder);
+        power.Set_Demand(N+i, wheel);
+
+        if(WheelMotor[i].get_voltage() > 0)
+        {
+            voltage += WheelMotor[i].get_voltage();
+            n++;
+        }
     }
+    power.Set_Bus(n > 0 ? voltage/n : 0);
+    power.Allocate();
+
+    for(int i=0; i<N; i++)
+    {
+        if(rudder_out_max[i] > 0)
+            PID_Rudder_Speed[i].set_out_max(rudder_out_max[i]*power.get_scale(i));
+    }
+
+    float wheel_scale = power.get_scale(N);
+    if(wheel_scale < 1)
+        accel_scale *= wheel_scale;
+    else
+        accel_scale += dt*2.0f;    //约0.5s恢复到满加速度
+    Constrain(&accel_scale, 0.2f, 1.0f);
+    profiler.Accel_Scale = accel_scale;
 }
 
 
@@ -90,23 +291,51 @@ uint8_t Chassis_Base::update_timeStamp(void)
  * 
  * @param cmd_vel 底盘速度参数结构体
  */
-void Swerve_Chassis::Control(Robot_Twist_t cmd_vel)
+template<class Rudder_Type, class Wheel_Type, int N>
+void Swerve_Chassis<Rudder_Type, Wheel_Type, N>::Control(Robot_Twist_t cmd_vel)
 {
-    static int32_t last_wheel_vel[4]={0};   //上一时刻给轮子的速度赋值
-    static int32_t last_wheelmotor_speed[4]={0};    //上一时刻轮子的实际转速
     update_timeStamp();
+    Fault_Check();
+    Power_Allocate();
 
-    Reset();
-    for(int i=0; i<4; i++)
+    Homing();
+    if(chassis_is_init==true)
     {
-        if(chassis_is_init==true&&Chassis_Safety_Check(25000)==true)
+        //底盘速度限幅，正反方向均限制
+        cmd_vel_.linear.x = cmd_vel.linear.x;
+        cmd_vel_.linear.y = cmd_vel.linear.y;
+        cmd_vel_.angular.z = cmd_vel.angular.z;
+        Constrain(&cmd_vel_.linear.x, -Speed_Max.linear.x, Speed_Max.linear.x);
+        Constrain(&cmd_vel_.linear.y, -Speed_Max.linear.y, Speed_Max.linear.y);
+        Constrain(&cmd_vel_.angular.z, -Speed_Max.angular.z, Speed_Max.angular.z);
+
+        //使用加速度控制底盘速度，在底盘速度空间中规划，保证加速过程中运动方向不变
+        #if USE_VEL_ACCEL
+        cmd_vel_ = profiler.Update(cmd_vel_, dt);
+        #endif
+
+        //世界坐标系控制，在规划之后转换，保证底盘在场地上的运动方向不变
+        if(cmd_vel.chassis_mode == FIELD)
+            cmd_vel_ = Field_Oriented(cmd_vel_);
+
+        //轮速饱和处理，X_MOVE、Y_MOVE模式只有单轴速度，由Speed_Max限幅即可
+        if(cmd_vel.chassis_mode == NORMAL || cmd_vel.chassis_mode == FIELD)
+        {
+            cmd_vel_.angular.z = Heading_Hold(cmd_vel_.angular.z);
+            cmd_vel_ = Twist_Desaturate(cmd_vel_);
+        }
+    }
+    else
+    {
+        profiler.Reset();
+        heading_locked = false;
+    }
+
+    bool is_safe = fault.is_ok();
+    for(int i=0; i<N; i++)
+    {
+        if(chassis_is_init==true&&is_safe)
         {
-            //底盘速度限幅
-            cmd_vel_.linear.x = cmd_vel.linear.x>Speed_Max.linear.x?Speed_Max.linear.x:cmd_vel.linear.x;
-            cmd_vel_.linear.y = cmd_vel.linear.y>Speed_Max.linear.y?Speed_Max.linear.y:cmd_vel.linear.y;
-            cmd_vel_.angular.z = cmd_vel.angular.z>Speed_Max.angular.z?Speed_Max.angular.z:cmd_vel.angular.z;
-            
-            
             //底盘模式选择，可能没太大用处
             switch (cmd_vel.chassis_mode)
             {
@@ -119,6 +348,7 @@ void Swerve_Chassis::Control(Robot_Twist_t cmd_vel)
                     break;
 
                 case NORMAL:
+                case FIELD:
                     Velocity_Calculate(cmd_vel_,&swerve[i]);
                     break;
 
@@ -126,20 +356,8 @@ void Swerve_Chassis::Control(Robot_Twist_t cmd_vel)
                     break;
             }
 
-            //使用加速度控制底盘速度
-            #if USE_VEL_ACCEL
-            if(swerve[i].wheel_vel > 0 && swerve[i].wheel_vel >= last_wheel_vel[i])
-                swerve[i].wheel_vel = last_wheel_vel[i] + accel_vel*dt*ChassisVel_Trans_MotorRPM(Wheel_Radius, 21);
-            else if (swerve[i].wheel_vel < 0 && swerve[i].wheel_vel <= last_wheel_vel[i])
-                swerve[i].wheel_vel = last_wheel_vel[i] - accel_vel*dt*ChassisVel_Trans_MotorRPM(Wheel_Radius, 21);
-            else
-            {}
-
-            last_wheel_vel[i] = swerve[i].wheel_vel;
-            #endif      
-
             //在底盘运动速度比较低时，才能进行后退。防止反冲电流过大
-            if(last_wheelmotor_speed[i]*swerve[i].wheel_vel<0 && ABS(WheelMotor[i].get_speed())-1000>=0)
+            if(last_wheel_speed[i]*swerve[i].wheel_vel<0 && ABS(WheelMotor[i].get_speed())-1000>=0)
             {
                 WheelMotor[i].Mode = SET_eRPM;
                 WheelMotor[i].Out = 0;
@@ -156,13 +374,16 @@ void Swerve_Chassis::Control(Robot_Twist_t cmd_vel)
             PID_Rudder_Pos[i].target = swerve[i].target_angle;
             PID_Rudder_Speed[i].target = PID_Rudder_Pos[i].Adjust();
             RudderMotor[i].Out = PID_Rudder_Speed[i].Adjust();
-            last_wheelmotor_speed[i] = WheelMotor[i].get_speed();
+            last_wheel_speed[i] = WheelMotor[i].get_speed();
         }
 
-        if(Chassis_Safety_Check(25000)==false)
+        //有故障时轮向电机全部卸力，故障的舵向电机停止输出
+        if(is_safe==false)
         {
             WheelMotor[i].Mode = SET_CURRENT;
             WheelMotor[i].Out = 0;
+            if(fault.get_faults(i) != FAULT_NONE)
+                RudderMotor[i].Out = 0;
         }
     }
     
@@ -174,69 +395,81 @@ void Swerve_Chassis::Control(Robot_Twist_t cmd_vel)
  * 
  * @return int 
  */
-int Swerve_Chassis::Motor_Control(void)
+template<class Rudder_Type, class Wheel_Type, int N>
+int Swerve_Chassis<Rudder_Type, Wheel_Type, N>::Motor_Control(void)
 {
     RM_Motor_SendMsgs(&hcan1, RudderMotor);
 
     //由于担心是一个任务同时发送太多can帧，防止阻塞严重，把can帧速度拉低。
-    //方法比较简陋，希望后来者可以改善这个问题并做好封装
-	static int send_flag=0;
-    if(send_flag<1)
-    {
-        VESC_SendMsgs(&hcan2, WheelMotor[0]);
-    }
-    else if (send_flag>=1&&send_flag<2)
-    {
-        VESC_SendMsgs(&hcan2, WheelMotor[1]);
-    }
-    else if (send_flag>=2&&send_flag<3)
-    {
-        VESC_SendMsgs(&hcan2, WheelMotor[2]);
-    }
-    else if (send_flag>=3&&send_flag<4)
-    {
-        VESC_SendMsgs(&hcan2, WheelMotor[3]);
-    }
-    else
-    {
-        send_flag = -1;
-    }
-
-    send_flag++;
+    //每周期发送一个轮向电机，N个电机发完后空一个周期
+    if(send_flag < N)
+        VESC_SendMsgs(&hcan2, WheelMotor[send_flag]);
+    send_flag = (send_flag + 1) % (N + 1);
     return 0;
 }
 
 
+/**
+ * @brief 在CAN1接收回调中调用，按标准帧ID更新对应的舵向电机
+ * @return false 不是该底盘的舵向电机
+ */
+template<class Rudder_Type, class Wheel_Type, int N>
+bool Swerve_Chassis<Rudder_Type, Wheel_Type, N>::Rudder_Update(uint32_t std_id, uint8_t *data)
+{
+    uint32_t index = std_id - RudderMotor[0].receive_id_init() - 1;
+    if(index >= (uint32_t)N)
+        return false;
+    RudderMotor[index].update(data);
+    return true;
+}
+
+
+/**
+ * @brief 在CAN2接收回调中调用，轮向电机按扩展帧ID中的VESC ID各自判断是否为自己的数据
+ */
+template<class Rudder_Type, class Wheel_Type, int N>
+void Swerve_Chassis<Rudder_Type, Wheel_Type, N>::Wheel_Update(CAN_RxBuffer *buffer)
+{
+    for(int i=0; i<N; i++)
+        WheelMotor[i].update_vesc(buffer);
+}
+
+
+/**
+ * @brief 单个舵轮模块的速度矢量计算(逆运动学)
+ *
+ * @param num 舵轮编号，1~4
+ * @param wheel_Vx 模块x方向速度，m/s
+ * @param wheel_Vy 模块y方向速度，m/s
+ */
+template<class Rudder_Type, class Wheel_Type, int N>
+void Swerve_Chassis<Rudder_Type, Wheel_Type, N>::Module_Velocity(Robot_Twist_t cmd_vel, int num, float *wheel_Vx, float *wheel_Vy)
+{
+    kinematics.Module_Velocity(cmd_vel, num-1, wheel_Vx, wheel_Vy);
+}
+
+
+/**
+ * @brief 底盘速度为twist时，所有轮向电机中最大的转速
+ */
+template<class Rudder_Type, class Wheel_Type, int N>
+float Swerve_Chassis<Rudder_Type, Wheel_Type, N>::Wheel_Speed_Peak(Robot_Twist_t twist)
+{
+    return kinematics.Peak(twist)*ChassisVel_Trans_MotorRPM(Wheel_Radius, gear_ratio);
+}
+
+
 /**
  * @brief 底盘速度计算
  */
-void Swerve_Chassis::Velocity_Calculate(Robot_Twist_t cmd_vel, Swerve_t *swerve)
+template<class Rudder_Type, class Wheel_Type, int N>
+void Swerve_Chassis<Rudder_Type, Wheel_Type, N>::Velocity_Calculate(Robot_Twist_t cmd_vel, Swerve_t *swerve)
 {
     float wheel_Vx=0, wheel_Vy=0;
-    switch(swerve->num)
-    {
-        case 1:
-            wheel_Vx = (cmd_vel.linear.x + Chassis_Radius*SIN*cmd_vel.angular.z);
-            wheel_Vy = (cmd_vel.linear.y + Chassis_Radius*COS*cmd_vel.angular.z);
-            break;
-        case 2:
-            wheel_Vx = (cmd_vel.linear.x - Chassis_Radius*SIN*cmd_vel.angular.z);
-            wheel_Vy = (cmd_vel.linear.y + Chassis_Radius*COS*cmd_vel.angular.z);
-            break;
-        case 3:
-            wheel_Vx = (cmd_vel.linear.x - Chassis_Radius*SIN*cmd_vel.angular.z);
-            wheel_Vy = (cmd_vel.linear.y - Chassis_Radius*COS*cmd_vel.angular.z);
-            break;
-        case 4:
-            wheel_Vx = (cmd_vel.linear.x + Chassis_Radius*SIN*cmd_vel.angular.z);
-            wheel_Vy = (cmd_vel.linear.y - Chassis_Radius*COS*cmd_vel.angular.z);
-            break;
-        default:
-            break;
-    }
+    Module_Velocity(cmd_vel, swerve->num, &wheel_Vx, &wheel_Vy);
 
-    swerve->wheel_vel = sqrt(wheel_Vx*wheel_Vx + wheel_Vy*wheel_Vy)*ChassisVel_Trans_MotorRPM(Wheel_Radius, 21);
-    swerve->target_angle = atan2f(wheel_Vy,wheel_Vx)/PI*180;   // -180~180
+    swerve->wheel_vel = fast_sqrtf(wheel_Vx*wheel_Vx + wheel_Vy*wheel_Vy)*ChassisVel_Trans_MotorRPM(Wheel_Radius, gear_ratio);
+    swerve->target_angle = fast_atan2f(wheel_Vy,wheel_Vx)*FAST_RAD2DEG;   // -180~180
     
     //底盘速度赋值为0时，刹车
     if(ABS(cmd_vel.linear.x)-0.02<=0&&ABS(cmd_vel.linear.y)-0.02<=0&&ABS(cmd_vel.angular.z)-0.02<=0)
@@ -245,7 +478,7 @@ void Swerve_Chassis::Velocity_Calculate(Robot_Twist_t cmd_vel, Swerve_t *swerve)
         WheelMotor[swerve->num-1].Mode = SET_BRAKE;
         WheelMotor[swerve->num-1].Out = 10;
 
-        //四个轮子均小于100erpm时，超过2s锁住底盘
+        //轮子均小于100erpm时，超过2s锁住底盘
         Chassis_Lock(swerve);
     }
 
@@ -261,9 +494,10 @@ void Swerve_Chassis::Velocity_Calculate(Robot_Twist_t cmd_vel, Swerve_t *swerve)
  * @param cmd_vel 
  * @param swerve 
  */
-void Swerve_Chassis::X_Velocity_Calculate(Robot_Twist_t cmd_vel, Swerve_t *swerve)
+template<class Rudder_Type, class Wheel_Type, int N>
+void Swerve_Chassis<Rudder_Type, Wheel_Type, N>::X_Velocity_Calculate(Robot_Twist_t cmd_vel, Swerve_t *swerve)
 {
-    swerve->wheel_vel = cmd_vel.linear.x * ChassisVel_Trans_MotorRPM(Wheel_Radius, 21);
+    swerve->wheel_vel = cmd_vel.linear.x * ChassisVel_Trans_MotorRPM(Wheel_Radius, gear_ratio);
 
     if(cmd_vel.linear.x==0)
     {
@@ -281,9 +515,10 @@ void Swerve_Chassis::X_Velocity_Calculate(Robot_Twist_t cmd_vel, Swerve_t *swerv
  * @param cmd_vel 
  * @param swerve 
  */
-void Swerve_Chassis::Y_Velocity_Calculate(Robot_Twist_t cmd_vel, Swerve_t *swerve)
+template<class Rudder_Type, class Wheel_Type, int N>
+void Swerve_Chassis<Rudder_Type, Wheel_Type, N>::Y_Velocity_Calculate(Robot_Twist_t cmd_vel, Swerve_t *swerve)
 {
-    swerve->wheel_vel = cmd_vel.linear.y * ChassisVel_Trans_MotorRPM(Wheel_Radius, 21);
+    swerve->wheel_vel = cmd_vel.linear.y * ChassisVel_Trans_MotorRPM(Wheel_Radius, gear_ratio);
 
     if(cmd_vel.linear.y==0)
     {
@@ -300,7 +535,8 @@ void Swerve_Chassis::Y_Velocity_Calculate(Robot_Twist_t cmd_vel, Swerve_t *swerv
  * 
  * @param swerve 
  */
-void Swerve_Chassis::RudderAngle_Adjust(Swerve_t *swerve)
+template<class Rudder_Type, class Wheel_Type, int N>
+void Swerve_Chassis<Rudder_Type, Wheel_Type, N>::RudderAngle_Adjust(Swerve_t *swerve)
 {
     
     float error=0;
@@ -317,7 +553,7 @@ void Swerve_Chassis::RudderAngle_Adjust(Swerve_t *swerve)
     else
         N2 = swerve->target_angle/360-1;
 
-    N = N1-N2;  //now_angle>0&&now_angle<180   ---->  N=0
+    N_round = N1-N2;  //now_angle>0&&now_angle<180   ---->  N=0
                                                                             //now_angle>=180&&now_angle<360  ---->  N=1
                                                                             //now_angle>=360                 ---->  N=1
                                                                             //now_angle<=-360                 ---->  N=-1
@@ -325,7 +561,7 @@ void Swerve_Chassis::RudderAngle_Adjust(Swerve_t *swerve)
                                                                             //now_angle>180&&now_angle<=0     ---->  N=0
 
 
-    swerve->target_angle = swerve->target_angle + N*360.0f;
+    swerve->target_angle = swerve->target_angle + N_round*360.0f;
     error = abs(swerve->target_angle - swerve->now_angle);
 
     if(swerve->target_angle < swerve->now_angle)
@@ -356,131 +592,182 @@ void Swerve_Chassis::RudderAngle_Adjust(Swerve_t *swerve)
 
 
 /**
- * @brief Chassis status reset
+ * @brief 重新回零，例如比赛中重启底盘、修改舵向零点时调用。同时清除锁存的故障，编码器跳变检测重新开始
+ */
+template<class Rudder_Type, class Wheel_Type, int N>
+void Swerve_Chassis<Rudder_Type, Wheel_Type, N>::Rehome(void)
+{
+    chassis_is_init = false;
+    homing_state = HOMING_IDLE;
+    fault.Clear_All();
+}
+
+
+/**
+ * @brief 修改两对对角模组连线的夹角并重新计算运动学，在控制周期之间调用
+ *
+ * @param theta 夹角，度
  */
-void Swerve_Chassis::Reset(void)
+template<class Rudder_Type, class Wheel_Type, int N>
+void Swerve_Chassis<Rudder_Type, Wheel_Type, N>::Theta_Set(float theta)
 {
-    static uint32_t real_time=0;
-    if(chassis_is_init==false&&reset_flag==2)
+    this->theta = theta;
+    kinematics = Geometry(Chassis_Radius, theta);
+}
+
+
+/**
+ * @brief 计算回零目标：离当前角度最近的0度或180度(180度时轮向反转，效果相同)，舵向最多转动90度
+ * @return true 所有舵向都已标定零点且收到反馈
+ */
+template<class Rudder_Type, class Wheel_Type, int N>
+bool Swerve_Chassis<Rudder_Type, Wheel_Type, N>::Homing_Target_Update(void)
+{
+    bool valid = true;
+    for(int i=0; i<N; i++)
     {
-        for(int i=0; i<4; i++)
+        if(RudderMotor[i].is_offset_set() == false || RudderMotor[i].get_rx_cnt() == 0)
         {
-            Chassis_Lock(&swerve[i]);
+            valid = false;
+            continue;
         }
-        reset_flag = 0;
+        float k = RudderMotor[i].get_angle() / 180.0f;
+        int n = (int)(k >= 0 ? k + 0.5f : k - 0.5f);
+        homing_target[i] = n * 180.0f;
     }
+    return valid;
+}
 
-    if(reset_flag==0)
-    {
-        real_time = 0;
-        reset_flag = 1;
-    }
 
-    real_time += dt*1000;
+/**
+ * @brief 舵向回零状态机，底盘未初始化时在控制函数中每周期调用。
+ *        舵向闭环转到零点，所有模组都在容差内保持Homing_Settle后完成，轮向电机全程卸力。
+ *        热启动(零点有效且舵向已经在零点并静止)时直接完成，不转动。
+ *        超过Homing_Timeout未完成时记录未收敛的模组，下一周期重新开始。
+ */
+template<class Rudder_Type, class Wheel_Type, int N>
+void Swerve_Chassis<Rudder_Type, Wheel_Type, N>::Homing(void)
+{
+    if(chassis_is_init == true)
+        return;
+
+    const uint8_t all = (1<<N) - 1;
+    uint32_t now = Get_SystemTimer();
+    uint8_t converged = 0;
 
-    if(real_time<1000)
+    if(homing_state != HOMING_RUN)
     {
-        for(int i=0; i<4; i++)
+        homing_target_valid = Homing_Target_Update();
+        homing_start = now;
+        homing_state = HOMING_RUN;
+        for(int i=0; i<N; i++)
         {
             WheelMotor[i].Mode = SET_CURRENT;
             WheelMotor[i].Out = 0;
-        }    
+        }
+
+        //热启动，舵向已经在零点
+        if(homing_target_valid)
+        {
+            for(int i=0; i<N; i++)
+            {
+                float err = RudderMotor[i].get_angle() - homing_target[i];
+                if(fabsf(err) < Homing_Tolerance && ABS(RudderMotor[i].get_speed()) < 10)
+                    converged |= 1<<i;
+            }
+        }
     }
-    else if(real_time>=1000 && real_time<3000)
+    else
     {
-        cmd_vel_.linear.x = 0;
-        cmd_vel_.linear.y = 0;
-        cmd_vel_.angular.z = 1;
+        //有模组还没有收到反馈时，等收到反馈后再确定目标
+        if(homing_target_valid == false)
+            homing_target_valid = Homing_Target_Update();
 
-        for(int i=0; i<4; i++)
+        for(int i=0; i<N; i++)
         {
-            Velocity_Calculate(cmd_vel_, &swerve[i]);
-            WheelMotor[i].Mode = SET_eRPM;
-            WheelMotor[i].Out = swerve[i].wheel_vel;
+            WheelMotor[i].Mode = SET_CURRENT;
+            WheelMotor[i].Out = 0;
+            if(homing_target_valid == false)
+            {
+                RudderMotor[i].Out = 0;
+                continue;
+            }
+
+            float err = RudderMotor[i].get_angle() - homing_target[i];
+            if(fabsf(err) < Homing_Tolerance && ABS(RudderMotor[i].get_speed()) < 10)
+            {
+                if(settle_since[i] == 0)
+                    settle_since[i] = now ? now : 1;
+                if(now - settle_since[i] >= Homing_Settle)
+                    converged |= 1<<i;
+            }
+            else
+            {
+                settle_since[i] = 0;
+            }
 
-            //电机速度赋值
             PID_Rudder_Speed[i].current = RudderMotor[i].get_speed();
             PID_Rudder_Pos[i].current = RudderMotor[i].get_angle();
-            PID_Rudder_Pos[i].target = swerve[i].target_angle;
+            PID_Rudder_Pos[i].target = homing_target[i];
             PID_Rudder_Speed[i].target = PID_Rudder_Pos[i].Adjust();
             RudderMotor[i].Out = PID_Rudder_Speed[i].Adjust();
         }
     }
-    else if(real_time>=3000 && real_time<5000)
+
+    if(converged == all)
     {
-        cmd_vel_.linear.x = 0;
-        cmd_vel_.linear.y = 0;
-        cmd_vel_.angular.z = -1;
-        
-        for(int i=0; i<4; i++)
+        for(int i=0; i<N; i++)
         {
-            Velocity_Calculate(cmd_vel_, &swerve[i]);
-            WheelMotor[i].Mode = SET_eRPM;
-            WheelMotor[i].Out = swerve[i].wheel_vel;
-
-            //电机速度赋值
-            PID_Rudder_Speed[i].current = RudderMotor[i].get_speed();
-            PID_Rudder_Pos[i].current = RudderMotor[i].get_angle();
-            PID_Rudder_Pos[i].target = swerve[i].target_angle;
-            PID_Rudder_Speed[i].target = PID_Rudder_Pos[i].Adjust();
-            RudderMotor[i].Out = PID_Rudder_Speed[i].Adjust();
+            swerve[i].target_angle = homing_target[i];
+            swerve[i].now_angle = homing_target[i];
+            settle_since[i] = 0;
         }
+        homing_time = now - homing_start;
+        homing_fail = 0;
+        homing_state = HOMING_DONE;
+        chassis_is_init = true;
     }
-    else
+    else if(now - homing_start > Homing_Timeout)
     {
-        chassis_is_init = true;
-        reset_flag=2;
+        for(int i=0; i<N; i++)
+            settle_since[i] = 0;
+        homing_time = now - homing_start;
+        homing_fail = (~converged) & all;
+        homing_state = HOMING_FAILED;
     }
 }
 
 
 /**
- * @brief 舵轮底盘安全检测，检测电机的最大电流是否超过设定值。电流值过大持续时间超过1s，蜂鸣器报警
- * 
- * @param Current_Max 
- * @return true 电流安全
- * @return false 电流过大
+ * @brief 电机故障检测，每个控制周期调用一次，每个电机检测一次。
+ *        GM6020电流为转矩电流原始值，VESC电流单位为mA，温度为MOS温度(需打开STATUS_4)
  */
-bool Swerve_Chassis::Chassis_Safety_Check(float Current_Max)
+template<class Rudder_Type, class Wheel_Type, int N>
+void Swerve_Chassis<Rudder_Type, Wheel_Type, N>::Fault_Check(void)
 {
-    static int beep_flag=0;
-    static uint32_t start_time=0, now_time=0, real_time=0;
-    for(int i=0; i<4; i++)
+    uint32_t now = Get_SystemTimer();
+    Fault_Sample_t sample;
+    for(int i=0; i<N; i++)
     {
-        if(WheelMotor[i].get_tarque() > Current_Max)
-        {
-            
-            if(beep_flag==0)
-            {
-                start_time = get_systemTick()/1000;
-                beep_flag = 1;
-            }
-
-            now_time = get_systemTick()/1000;
-            if(now_time<start_time)
-            {
-                real_time = 0xFFFFFFFF-start_time+now_time;
-            }
-            else
-            {
-                real_time = now_time-start_time;
-            }
-            
-            if(real_time>2000&&beep_flag==1)
-            {
-                Set_PwmFreq(&htim10, 5);
-                Set_PwmDuty(&htim10, TIM_CHANNEL_1, 50);
-                beep_flag = 2;
-                return false;
-            }
-        }
+        sample.current = RudderMotor[i].get_tarque();
+        sample.temp = RudderMotor[i].get_temperature();
+        sample.angle = RudderMotor[i].get_angle();
+        sample.speed = RudderMotor[i].get_speed()*6.0f;    //rpm -> 度/s
+        sample.rx_cnt = RudderMotor[i].get_rx_cnt();
+        fault.Update(i, sample, now);
+
+        sample.current = WheelMotor[i].get_current();
+        sample.temp = WheelMotor[i].get_temp_fet();
+        sample.angle = 0;
+        sample.speed = 0;
+        sample.rx_cnt = WheelMotor[i].get_rx_cnt();
+        fault.Update(N+i, sample, now);
     }
-
-    return true;
 }
 
 
-void Swerve_Chassis::Chassis_Lock(Swerve_t *swerve)
+template<class Rudder_Type, class Wheel_Type, int N>
+void Swerve_Chassis<Rudder_Type, Wheel_Type, N>::Chassis_Lock(Swerve_t *swerve)
 {
     static int reset_flag=0;
     static int32_t stop_start_time=0;
@@ -490,41 +777,31 @@ void Swerve_Chassis::Chassis_Lock(Swerve_t *swerve)
         if(reset_flag==0)
         {
             reset_flag = 1;
-            stop_start_time = get_systemTick()/1000;
+            stop_start_time = Get_SystemTimer()/1000;
         }
 
-        if(get_systemTick()/1000-stop_start_time>2000) 
+        if(Get_SystemTimer()/1000-stop_start_time>2000) 
         {
-            switch(swerve->num)
-            {
-                case 1:
-                    swerve->target_angle = theta/2;
-                    break;
-                case 2:
-                    swerve->target_angle = -theta/2;
-                    break;
-                case 3:
-                    swerve->target_angle = theta/2;
-                    break;
-                case 4:
-                    swerve->target_angle = -theta/2;
-                    break;
-                default:
-                    break;
-            }
+            //舵向转到模组的安装方向(折算到-90~90度)，各轮互成角度锁住底盘
+            float lock = Module_Angle(swerve->num-1, theta);
+            while(lock > 90.0f)
+                lock -= 180.0f;
+            while(lock <= -90.0f)
+                lock += 180.0f;
+            swerve->target_angle = lock;
         }
         else
         {
             //保证底盘停止时，舵向电机不会转动
             if(ABS(swerve->wheel_vel)< 100)
-                swerve->target_angle = swerve->now_angle-N*360.0f;
+                swerve->target_angle = swerve->now_angle-N_round*360.0f;
         }
     }
     else
     {
         //保证底盘停止时，舵向电机不会转动
         if(ABS(swerve->wheel_vel)<100)
-            swerve->target_angle = swerve->now_angle-N*360.0f;
+            swerve->target_angle = swerve->now_angle-N_round*360.0f;
         reset_flag = 0;
     }
 }
@@ -533,6 +810,7 @@ void Swerve_Chassis::Chassis_Lock(Swerve_t *swerve)
 /**
  * @brief 舵轮PID参数初始化
  * 
+ * @param num 舵轮下标，0~N-1
  * @param PID_Type 
  * @param Kp 
  * @param Ki 
@@ -540,78 +818,58 @@ void Swerve_Chassis::Chassis_Lock(Swerve_t *swerve)
  * @param Integral_Max 积分限幅
  * @param OUT_Max 输出限幅
  */
-void Swerve_Chassis::Pid_Param_Init(CHASSIS_PID_E PID_Type, float Kp, float Ki, float Kd, float Integral_Max, float Out_Max, float DeadZone)
+template<class Rudder_Type, class Wheel_Type, int N>
+bool Swerve_Chassis<Rudder_Type, Wheel_Type, N>::Pid_Param_Init(int num, SWERVE_PID_E PID_Type, float Kp, float Ki, float Kd, float Integral_Max, float Out_Max, float DeadZone)
 {
+    if(num < 0 || num >= N)
+        return false;
+
     switch(PID_Type)
     {
-        case RUDDER_LEFT_FRONT_Speed_E:
-            PID_Rudder_Speed[0].PID_Param_Init(Kp, Ki, Kd, Integral_Max, Out_Max, DeadZone);
-            break;
-        case RUDDER_RIGHT_FRONT_Speed_E:
-            PID_Rudder_Speed[1].PID_Param_Init(Kp, Ki, Kd, Integral_Max, Out_Max, DeadZone);
-            break;
-        case RUDDER_LEFT_REAR_Speed_E:
-            PID_Rudder_Speed[2].PID_Param_Init(Kp, Ki, Kd, Integral_Max, Out_Max, DeadZone);
-            break;
-        case RUDDER_RIGHT_REAR_Speed_E:
-            PID_Rudder_Speed[3].PID_Param_Init(Kp, Ki, Kd, Integral_Max, Out_Max, DeadZone);
-            break;
-        case RUDDER_LEFT_FRONT_Pos_E:
-            PID_Rudder_Pos[0].PID_Param_Init(Kp, Ki, Kd, Integral_Max, Out_Max, DeadZone);
-            break;
-        case RUDDER_RIGHT_FRONT_Pos_E:
-            PID_Rudder_Pos[1].PID_Param_Init(Kp, Ki, Kd, Integral_Max, Out_Max, DeadZone);
+        case RUDDER_SPEED_PID:
+            PID_Rudder_Speed[num].PID_Param_Init(Kp, Ki, Kd, Integral_Max, Out_Max, DeadZone);
+            rudder_out_max[num] = Out_Max;
             break;
-        case RUDDER_LEFT_REAR_Pos_E:
-            PID_Rudder_Pos[2].PID_Param_Init(Kp, Ki, Kd, Integral_Max, Out_Max, DeadZone);
-            break;
-        case RUDDER_RIGHT_REAR_Pos_E:
-            PID_Rudder_Pos[3].PID_Param_Init(Kp, Ki, Kd, Integral_Max, Out_Max, DeadZone);
+        case RUDDER_POS_PID:
+            PID_Rudder_Pos[num].PID_Param_Init(Kp, Ki, Kd, Integral_Max, Out_Max, DeadZone);
             break;
         default:
-            break;
+            return false;
     }
+    return true;
 }
 
 
 /**
  * @brief 舵轮底盘PID模式初始化
  * 
+ * @param num 舵轮下标，0~N-1
  * @param PID_Type 
  * @param LowPass_error 误差低通过滤器系数
  * @param LowPass_d_err 不完全微分系数
  * @param D_of_Current 是否开启微分先行
  * @param Imcreatement_of_Out 是否使用增量式输出
  */
-void Swerve_Chassis::Pid_Mode_Init(CHASSIS_PID_E PID_Type, float LowPass_error, float LowPass_d_err, bool D_of_Current, bool Imcreatement_of_Out)
+template<class Rudder_Type, class Wheel_Type, int N>
+bool Swerve_Chassis<Rudder_Type, Wheel_Type, N>::Pid_Mode_Init(int num, SWERVE_PID_E PID_Type, float LowPass_error, float LowPass_d_err, bool D_of_Current, bool Imcreatement_of_Out)
 {
+    if(num < 0 || num >= N)
+        return false;
+
     switch(PID_Type)
     {
-        case RUDDER_LEFT_FRONT_Pos_E:
-            PID_Rudder_Pos[0].PID_Mode_Init(LowPass_error, LowPass_d_err, D_of_Current, Imcreatement_of_Out);
-            break;
-        case RUDDER_RIGHT_FRONT_Pos_E:
-            PID_Rudder_Pos[1].PID_Mode_Init(LowPass_error, LowPass_d_err, D_of_Current, Imcreatement_of_Out);
-            break;
-        case RUDDER_LEFT_REAR_Pos_E:
-            PID_Rudder_Pos[2].PID_Mode_Init(LowPass_error, LowPass_d_err, D_of_Current, Imcreatement_of_Out);
-            break;
-        case RUDDER_RIGHT_REAR_Pos_E:
-            PID_Rudder_Pos[3].PID_Mode_Init(LowPass_error, LowPass_d_err, D_of_Current, Imcreatement_of_Out);
+        case RUDDER_SPEED_PID:
+            PID_Rudder_Speed[num].PID_Mode_Init(LowPass_error, LowPass_d_err, D_of_Current, Imcreatement_of_Out);
             break;
-        case RUDDER_LEFT_FRONT_Speed_E:
-            PID_Rudder_Speed[0].PID_Mode_Init(LowPass_error, LowPass_d_err, D_of_Current, Imcreatement_of_Out);
-            break;
-        case RUDDER_RIGHT_FRONT_Speed_E:
-            PID_Rudder_Speed[1].PID_Mode_Init(LowPass_error, LowPass_d_err, D_of_Current, Imcreatement_of_Out);
-            break;
-        case RUDDER_LEFT_REAR_Speed_E:
-            PID_Rudder_Speed[2].PID_Mode_Init(LowPass_error, LowPass_d_err, D_of_Current, Imcreatement_of_Out);
-            break;
-        case RUDDER_RIGHT_REAR_Speed_E:
-            PID_Rudder_Speed[3].PID_Mode_Init(LowPass_error, LowPass_d_err, D_of_Current, Imcreatement_of_Out);
+        case RUDDER_POS_PID:
+            PID_Rudder_Pos[num].PID_Mode_Init(LowPass_error, LowPass_d_err, D_of_Current, Imcreatement_of_Out);
             break;
         default:
-            break;
+            return false;
     }
+    return true;
 }
+
+
+//八期R2舵轮底盘：GM6020舵向 + VESC轮向，四个模组
+template class Swerve_Chassis<Motor_GM6020, VESC, 4>;
@@ -1,86 +1,269 @@
 /**
  * @file air_joy.cpp
  * @author Yang JianYi
- * @brief 航模手柄的应用文件，使用PPM解析航模手柄的数据
+ * @brief 航模手柄的应用文件，解析接收机的PPM或SBUS/iBUS数据。
+ *        1)PPM：定时器输入捕获记录每个上升沿的计数值，DMA循环写入捕获缓存，整个过程不进中断，
+ *          脉宽由硬件捕获，不受中断响应延时影响。Poll中读取新的捕获值，凑齐一帧后发布。
+ *          捕获使用系统us定时器TIM4，计数值与Get_SystemTimer同一时基。
+ *        2)SBUS/iBUS：串口循环DMA接收，Poll中逐字节拼帧、校验后发布。SBUS为100000波特率、8E2、电平反相，需要外部反相电路。
+ *        3)每帧整体发布到话题topic，订阅方读到的所有通道属于同一帧；超过Lost_Timeout没有新帧或SBUS报告失控时lost置1，
+ *          lost变化时也发布一次，订阅方不用自己判断超时。
+ *        Poll只在航模手柄任务中调用，话题只有这一个发布方。
  * @version 0.1
  * @date 2024-04-09
- * 
+ *
  * @copyright Copyright (c) 2024
- * 
+ *
  */
 #include "air_joy.h"
 
+#define PPM_SYNC_MIN    2100    //帧尾电平至少2ms=2000us(留点余量)
+#define PPM_PULSE_MIN   950     //单个PWM脉宽在1000-2000us，这里设定950-2050，提升容错
+#define PPM_PULSE_MAX   2050
+
+#define SBUS_FRAME_LEN  25
+#define SBUS_HEADER     0x0F
+#define SBUS_FAILSAFE   0x08
+#define IBUS_FRAME_LEN  32
+#define IBUS_HEADER     0x20
+#define IBUS_CHANNELS   14
+
 AirJoy air_joy;
 
-SystemTick_Fun AirJoy::get_systemTick = NULL;
-uint8_t AirJoy::getMicroTick_regist(uint32_t (*getTick_fun)(void))
+
+/**
+ * @brief 开始PPM捕获，定时器需已启动计数(Timer_Init)，通道1在cubeMX中配置为输入捕获，DMA为Circular、半字
+ *
+ * @param buffer 捕获缓存，需大于两次Poll之间的边沿数(每ms约1个)
+ */
+void AirJoy::PPM_Init(TIM_HandleTypeDef *htim, uint16_t *buffer, uint16_t len)
+{
+    this->htim = htim;
+    cap_buf = buffer;
+    cap_size = len;
+    cap_read = 0;
+    protocol = RC_PPM;
+
+    //不打开DMA的传输完成中断，捕获值由Poll读取
+    HAL_DMA_Start(htim->hdma[TIM_DMA_ID_CC1], (uint32_t)&htim->Instance->CCR1, (uint32_t)buffer, len);
+    __HAL_TIM_ENABLE_DMA(htim, TIM_DMA_CC1);
+    TIM_CCxChannelCmd(htim->Instance, TIM_CHANNEL_1, TIM_CCx_ENABLE);
+}
+
+
+/**
+ * @brief 开始SBUS/iBUS接收，串口接收DMA在cubeMX中配置为Circular
+ *
+ * @param manager huart对应的串口管理结构体
+ * @param len 接收缓存大小，需大于两次Poll之间收到的字节数
+ * @param protocol RC_SBUS或RC_IBUS
+ */
+void AirJoy::Serial_Init(UART_HandleTypeDef *huart, usart_manager_t *manager, uint8_t *buffer, uint16_t len, uint8_t protocol)
+{
+    this->protocol = protocol;
+    serial_len = 0;
+
+    if(protocol == RC_SBUS)
+    {
+        //8位数据加偶校验
+        huart->Init.BaudRate = 100000;
+        huart->Init.WordLength = UART_WORDLENGTH_9B;
+        huart->Init.StopBits = UART_STOPBITS_2;
+        huart->Init.Parity = UART_PARITY_EVEN;
+    }
+    else
+    {
+        huart->Init.BaudRate = 115200;
+        huart->Init.WordLength = UART_WORDLENGTH_8B;
+        huart->Init.StopBits = UART_STOPBITS_1;
+        huart->Init.Parity = UART_PARITY_NONE;
+    }
+    HAL_UART_Init(huart);
+
+    Uart_Stream_Init(huart, buffer, len, NULL);
+    uart = manager;
+}
+
+
+/**
+ * @brief 读取新收到的数据并解析，每ms调用一次
+ * @param now 当前时刻，us
+ */
+void AirJoy::Poll(uint32_t now)
+{
+    if(protocol == RC_PPM && htim != NULL)
+        PPM_Poll(now);
+    else if(protocol != RC_PPM && uart != NULL)
+        Serial_Poll(now);
+
+    uint8_t lost = (frame.frame_cnt == 0 || failsafe || (int32_t)(now - frame.stamp) > (int32_t)Lost_Timeout);
+    if(lost != frame.lost)
+    {
+        if(lost)
+            stats.lost_cnt++;
+        frame.lost = lost;
+        topic.Publish(frame, now);
+    }
+}
+
+
+void AirJoy::PPM_Poll(uint32_t now)
 {
-    if(getTick_fun != NULL)
+    uint16_t write = cap_size - ((DMA_Stream_TypeDef*)htim->hdma[TIM_DMA_ID_CC1]->Instance)->NDTR;
+    if(write >= cap_size)
+        write = 0;
+    //在写位置之后读计数值，本次读到的边沿都不晚于cnt，用于把最后一个边沿换算到系统时间
+    uint16_t cnt = (uint16_t)htim->Instance->CNT;
+
+    while(cap_read != write)
     {
-        AirJoy::get_systemTick = getTick_fun;
-        return 1;
+        uint16_t cap = cap_buf[cap_read];
+        cap_read = (cap_read + 1) % cap_size;
+        uint16_t ppm_time_delta = cap - last_cap;   //两个上升沿之间的时间，计数器16位回绕
+        last_cap = cap;
+
+        //由于部分老版本遥控器、接收机输出PPM信号不标准，当出现解析异常时，尝试改小PPM_SYNC_MIN，该情况仅出现一例：使用天地飞老版本遥控器
+        if(ppm_time_delta >= PPM_SYNC_MIN)     //帧头
+        {
+            if(ppm_ready && ppm_sample_cnt > 0)
+                stats.errors++;         //上一帧通道数不够
+            ppm_ready = 1;
+            ppm_sample_cnt = 0;
+        }
+        else if(ppm_ready == 0)
+            continue;
+        else if(ppm_time_delta >= PPM_PULSE_MIN && ppm_time_delta <= PPM_PULSE_MAX)
+        {
+            PPM_buf[ppm_sample_cnt++] = ppm_time_delta;
+            if(ppm_sample_cnt >= RC_PPM_CHANNELS)   //0-7表示8个通道。如果想要使用更多通道，使用SBUS/iBUS协议(串口接收)
+            {
+                Publish(PPM_buf, RC_PPM_CHANNELS, now - (uint16_t)(cnt - cap));
+                ppm_ready = 0;
+                ppm_sample_cnt = 0;
+            }
+        }
+        else
+        {
+            stats.errors++;
+            ppm_ready = 0;
+        }
+    }
+}
+
+
+void AirJoy::Serial_Poll(uint32_t now)
+{
+    const uint8_t *data;
+
+    //缓存回绕时分两段读取
+    for(int i=0; i<2; i++)
+    {
+        uint16_t len = Uart_Stream_Peek(uart, &data);
+        if(len == 0)
+            break;
+        for(uint16_t j=0; j<len; j++)
+            Serial_Byte(data[j], now);
+        Uart_Stream_Consume(uart, len);
     }
-    else 
-        return 0;
 }
 
 
 /**
- * @brief ppw signal data ubpack and update
- * @param GPIO_Pin The parameter of GPIO_EXTI callback function
- * @param GPIO_EXTI_USED_PIN the used GPIO_Pin for EXTI that we defined
+ * @brief 拼帧，帧长收满后校验，校验失败时从下一个帧头重新开始
  */
-void AirJoy::data_update(uint16_t GPIO_Pin, uint16_t GPIO_EXTI_USED_PIN)
+void AirJoy::Serial_Byte(uint8_t byte, uint32_t now)
 {
-    if(GPIO_Pin == GPIO_EXTI_USED_PIN)		//使用的外部中断引脚
+    uint8_t header = (protocol == RC_SBUS) ? SBUS_HEADER : IBUS_HEADER;
+    uint8_t size = (protocol == RC_SBUS) ? SBUS_FRAME_LEN : IBUS_FRAME_LEN;
+
+    if(serial_len == 0 && byte != header)
+        return;
+    serial_buf[serial_len++] = byte;
+    if(serial_len < size)
+        return;
+
+    bool ok = (protocol == RC_SBUS) ? SBUS_Decode(now) : IBUS_Decode(now);
+    serial_len = 0;
+    if(ok)
+        return;
+
+    stats.errors++;
+    for(uint8_t i=1; i<size; i++)
     {
-        //get the system tick
-		last_ppm_time=now_ppm_time;
-		now_ppm_time=get_systemTick();  //获取当前时间
-		ppm_time_delta=now_ppm_time-last_ppm_time;  //电平数据
+        if(serial_buf[i] == header)
+        {
+            serial_len = size - i;
+            memmove(serial_buf, serial_buf + i, serial_len);
+            break;
+        }
     }
+}
 
-    //开始解包PPM信号
-	if(ppm_ready==1)	//判断帧结束后，进行下一轮解析
-	{
-        //帧结束电平至少2ms=2000us(留点余量)
-        //由于部分老版本遥控器、接收机输出PPM信号不标准，当出现解析异常时，尝试改小此值，该情况仅出现一例：使用天地飞老版本遥控器
-		if(ppm_time_delta >= 2100)  //帧头
-		{
-			ppm_ready = 1;
-			ppm_sample_cnt=0;   //对应的通道值
-			ppm_update_flag=1;
-		} 
-		else if(ppm_time_delta>=950&&ppm_time_delta<=2050)//单个PWM脉宽在1000-2000us，这里设定950-2050，提升容错
-		{         
-			PPM_buf[ppm_sample_cnt++]=ppm_time_delta;//对应通道写入缓冲区 
-			if(ppm_sample_cnt>=8)   //单次解析结束0-7表示8个通道。如果想要使用10通道，使用ibus协议(串口接收)
-			{
-                LEFT_X=PPM_buf[0]; LEFT_Y=PPM_buf[1]; RIGHT_X=PPM_buf[3]; RIGHT_Y=PPM_buf[2];
-                SWA=PPM_buf[4]; SWB=PPM_buf[5]; SWC=PPM_buf[6]; SWD=PPM_buf[7];
-				ppm_ready=0;
-				ppm_sample_cnt=0;
-			}
-		}
-		else  
-            ppm_ready=0;
-	}
-	else if(ppm_time_delta>=2100)//帧尾电平至少2ms=2000us
-	{
-		ppm_ready=1;
-		ppm_sample_cnt=0;
-		ppm_update_flag=0;
-	}
+
+/**
+ * @brief SBUS：帧头0x0F，16个11位通道，标志字节，帧尾0x00(SBUS2为0x04、0x14、0x24、0x34)
+ */
+bool AirJoy::SBUS_Decode(uint32_t now)
+{
+    uint8_t end = serial_buf[SBUS_FRAME_LEN-1];
+    if(end != 0x00 && (end & 0x0F) != 0x04)
+        return false;
+
+    uint16_t ch[RC_CHANNEL_MAX];
+    uint32_t bits = 0;
+    uint8_t nbits = 0, index = 1;
+    for(int i=0; i<RC_CHANNEL_MAX; i++)
+    {
+        while(nbits < 11)
+        {
+            bits |= (uint32_t)serial_buf[index++] << nbits;
+            nbits += 8;
+        }
+        //172~1811对应988~2012us
+        ch[i] = (uint16_t)((((bits & 0x7FF) * 5 + 4) >> 3) + 880);
+        bits >>= 11;
+        nbits -= 11;
+    }
+
+    failsafe = (serial_buf[23] & SBUS_FAILSAFE) ? 1 : 0;
+    Publish(ch, RC_CHANNEL_MAX, now);
+    return true;
 }
 
 
 /**
- * @brief GPIO 的串口回调函数
- * 
- * @param GPIO_Pin 触发的IO口
+ * @brief iBUS：0x20 0x40，14个通道(小端，us)，校验和为0xFFFF减去前30字节之和
  */
-void HAL_GPIO_EXTI_Callback(uint16_t GPIO_Pin)
+bool AirJoy::IBUS_Decode(uint32_t now)
 {
-    air_joy.data_update(GPIO_Pin,GPIO_PIN_7);
+    if(serial_buf[1] != 0x40)
+        return false;
+
+    uint16_t sum = 0xFFFF;
+    for(int i=0; i<IBUS_FRAME_LEN-2; i++)
+        sum -= serial_buf[i];
+    if(sum != (uint16_t)(serial_buf[30] | serial_buf[31] << 8))
+        return false;
+
+    uint16_t ch[IBUS_CHANNELS];
+    for(int i=0; i<IBUS_CHANNELS; i++)
+        ch[i] = (uint16_t)(serial_buf[2 + 2*i] | (serial_buf[3 + 2*i] & 0x0F) << 8);
+
+    failsafe = 0;
+    Publish(ch, IBUS_CHANNELS, now);
+    return true;
 }
 
+
+void AirJoy::Publish(const uint16_t *ch, uint8_t channels, uint32_t stamp)
+{
+    memcpy(frame.ch, ch, channels * sizeof(uint16_t));
+    frame.channels = channels;
+    frame.stamp = stamp;
+    frame.frame_cnt++;
+    if(failsafe && !frame.lost)
+        stats.lost_cnt++;
+    frame.lost = failsafe;
+    topic.Publish(frame, stamp);
+    stats.frames++;
+}
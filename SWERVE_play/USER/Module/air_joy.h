@@ -4,25 +4,81 @@
 #include <stdint.h>
 #include "stm32f4xx_hal.h"
 #include "string.h"
+#include "drive_uart.h"
+#include "data_pool.h"
+#include "topic.h"
 
+#define RC_CHANNEL_MAX  16      //SBUS 16通道，iBUS 14通道，PPM 8通道
+#define RC_PPM_CHANNELS 8
 
+//通道号，三种协议的通道顺序相同
+enum RC_CHANNEL
+{
+    RC_LEFT_X,
+    RC_LEFT_Y,
+    RC_RIGHT_Y,
+    RC_RIGHT_X,
+    RC_SWA,
+    RC_SWB,
+    RC_SWC,
+    RC_SWD
+};
+
+//一帧遥控数据，整帧发布到话题"rc.frame"，订阅方取到的所有通道属于同一帧
+typedef struct RC_Frame_t
+{
+    uint16_t ch[RC_CHANNEL_MAX];    //脉宽，us，一般为1000~2000
+    uint8_t channels;               //本帧的通道数
+    uint8_t lost;                   //1：超过Lost_Timeout没有新帧，或接收机报告失控
+    uint32_t frame_cnt;             //解析完成的帧数，不变说明没有新数据
+    uint32_t stamp;                 //帧的时刻，us，PPM为最后一个边沿的捕获时刻
+}RC_Frame_t;
+
+typedef struct RC_Stats_t
+{
+    uint32_t frames;                //解析完成的帧数
+    uint32_t errors;                //脉宽超出范围的PPM帧、校验失败的串口帧
+    uint32_t lost_cnt;              //进入失控状态的次数
+}RC_Stats_t;
 
 #ifdef __cplusplus
-typedef uint32_t (*SystemTick_Fun)(void);
 class AirJoy
 {
 public:
-    static uint8_t getMicroTick_regist(uint32_t (*getTick_fun)(void));
-    void data_update(uint16_t GPIO_Pin, uint16_t GPIO_EXTI_USED_PIN);
-    uint16_t SWA=0,SWB=0,SWC=0,SWD=0;
-    uint16_t LEFT_X=0,LEFT_Y=0,RIGHT_X=0,RIGHT_Y=0;
+    uint32_t Lost_Timeout = 100000;     /*!< 超过该时间没有新帧认为信号丢失，us */
+    Topic<RC_Frame_t> topic;            /*!< 每解析完一帧、lost变化时发布，由航模手柄任务(Poll)发布 */
+
+    AirJoy() : topic("rc.frame"){}
+    void PPM_Init(TIM_HandleTypeDef *htim, uint16_t *buffer, uint16_t len);
+    void Serial_Init(UART_HandleTypeDef *huart, usart_manager_t *manager, uint8_t *buffer, uint16_t len, uint8_t protocol);
+    void Poll(uint32_t now);
+    RC_Stats_t get_stats(void) const { return stats; }
+
 private:
-    static SystemTick_Fun get_systemTick;
-    uint32_t last_ppm_time, now_ppm_time=0;
-    uint8_t ppm_ready=0,ppm_sample_cnt=0;
-    uint8_t ppm_update_flag=0;
-	uint16_t ppm_time_delta=0;   //得到上升沿与下降沿的时间
-    uint16_t PPM_buf[10]={0};   
+    //PPM：TIM4_CH1捕获上升沿，DMA循环写入cap_buf，两个相邻上升沿的间隔即为一个通道的脉宽
+    TIM_HandleTypeDef *htim = NULL;
+    uint16_t *cap_buf = NULL;
+    uint16_t cap_size = 0, cap_read = 0;
+    uint16_t last_cap = 0;
+    uint8_t ppm_ready = 0, ppm_sample_cnt = 0;
+    uint16_t PPM_buf[RC_PPM_CHANNELS] = {0};
+
+    //SBUS/iBUS：串口循环DMA接收，逐字节拼帧
+    usart_manager_t *uart = NULL;
+    uint8_t protocol = RC_PPM;
+    uint8_t serial_buf[32];
+    uint8_t serial_len = 0;
+    uint8_t failsafe = 0;
+
+    RC_Frame_t frame = {{0}, 0, 1, 0, 0};
+    RC_Stats_t stats = {0, 0, 0};
+
+    void PPM_Poll(uint32_t now);
+    void Serial_Poll(uint32_t now);
+    void Serial_Byte(uint8_t byte, uint32_t now);
+    bool SBUS_Decode(uint32_t now);
+    bool IBUS_Decode(uint32_t now);
+    void Publish(const uint16_t *ch, uint8_t channels, uint32_t stamp);
 };
 
 extern "C" {
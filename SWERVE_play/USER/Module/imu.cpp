@@ -0,0 +1,121 @@
+/**
+ * @file imu.cpp
+ * @author Yang JianYi
+ * @brief 串口陀螺仪驱动(维特智能HWT101/WT901系列协议)，使用串口DMA+空闲中断接收，在接收回调中直接解包。
+ *        协议：每帧11字节，0x55 + 数据类型 + 8字节数据 + 和校验
+ *              0x52 角速度帧：wz = (int16)(data[5]<<8|data[4]) / 32768 * 2000 度/s
+ *              0x53 角度帧  ：yaw = (int16)(data[5]<<8|data[4]) / 32768 * 180 度
+ *        一次DMA接收中可能包含多帧或半帧数据，解包按字节进行，遇到错误帧会自动重新寻找帧头。
+ *        使用方法：在service_config.cpp中调用Uart_Init初始化USART6，接收回调中调用imu.Recieve_From_IMU，
+ *        任务中通过imu.get_data()获取带时间戳的偏航角和角速度。
+ * @version 0.1
+ * @date 2024-06-08
+ *
+ * @copyright Copyright (c) 2024
+ *
+ */
+#include "imu.h"
+#include "task.h"
+
+IMU imu;
+
+#define IMU_FRAME_HEAD  0x55
+#define IMU_FRAME_GYRO  0x52
+#define IMU_FRAME_ANGLE 0x53
+
+
+
+/**
+ * @brief 按字节解析串口数据，在串口接收回调(中断)中调用
+ *
+ * @param buffer DMA接收缓存
+ * @param len 本次接收的字节数
+ */
+void IMU::Recieve_From_IMU(const uint8_t *buffer, uint16_t len)
+{
+    for(uint16_t i=0; i<len; i++)
+    {
+        if(frame_index == 0 && buffer[i] != IMU_FRAME_HEAD)
+            continue;
+
+        frame[frame_index++] = buffer[i];
+        if(frame_index < sizeof(frame))
+            continue;
+
+        frame_index = 0;
+        uint8_t sum = 0;
+        for(int j=0; j<10; j++)
+            sum += frame[j];
+
+        if(sum == frame[10])
+            Frame_Unpack(frame);
+        else
+            checksum_error++;
+    }
+}
+
+
+/**
+ * @brief 单帧解包，偏航角展开为连续值，方便航向保持计算误差
+ */
+void IMU::Frame_Unpack(const uint8_t *frame)
+{
+    int16_t raw = (int16_t)(frame[7] << 8 | frame[6]);
+
+    switch(frame[1])
+    {
+        case IMU_FRAME_GYRO:
+            data.yaw_rate = raw / 32768.0f * 2000.0f;
+            break;
+
+        case IMU_FRAME_ANGLE:
+        {
+            float raw_yaw = raw / 32768.0f * 180.0f;
+            if(yaw_is_init)
+            {
+                if(raw_yaw - last_raw_yaw < -180)
+                    yaw_round++;
+                else if(raw_yaw - last_raw_yaw > 180)
+                    yaw_round--;
+            }
+            else
+            {
+                yaw_is_init = true;
+            }
+            last_raw_yaw = raw_yaw;
+
+            data.yaw = raw_yaw + yaw_round*360.0f;
+            data.timestamp = Get_SystemTimer();
+            data.frame_cnt++;
+            break;
+        }
+
+        default:
+            break;
+    }
+}
+
+
+/**
+ * @brief 获取IMU数据快照，数据在串口中断中更新，读取时进入临界区保证数据完整
+ */
+IMU_Data_t IMU::get_data(void)
+{
+    IMU_Data_t res;
+    taskENTER_CRITICAL();
+    res = data;
+    taskEXIT_CRITICAL();
+    return res;
+}
+
+
+/**
+ * @brief IMU是否在线
+ * @param timeout_us 超过该时间没有收到角度帧认为离线
+ */
+bool IMU::is_online(uint32_t timeout_us)
+{
+    if(data.frame_cnt == 0)
+        return false;
+    return (Get_SystemTimer() - data.timestamp) < timeout_us;
+}
@@ -0,0 +1,42 @@
+#pragma once
+#include "stdint.h"
+#include "drive_uart.h"
+#include "data_pool.h"
+#include "tool.h"
+#include "sys_clock.h"
+
+//IMU发布的数据
+typedef struct IMU_Data_t
+{
+    float yaw;              //偏航角，度，连续累加，不在±180处跳变
+    float yaw_rate;         //偏航角速度，度/s
+    uint32_t timestamp;     //最后一帧角度数据的接收时间，us
+    uint32_t frame_cnt;     //成功解析的角度帧计数
+}IMU_Data_t;
+
+#ifdef __cplusplus
+
+class IMU : Tools
+{
+public:
+    IMU(){}
+    void Recieve_From_IMU(const uint8_t *buffer, uint16_t len);
+    IMU_Data_t get_data(void);
+    bool is_online(uint32_t timeout_us = 50000);
+
+    uint32_t checksum_error = 0;    //校验失败的帧数
+
+private:
+    void Frame_Unpack(const uint8_t *frame);
+
+    IMU_Data_t data = {0};
+    uint8_t frame[11];
+    uint8_t frame_index = 0;
+    float last_raw_yaw = 0;
+    int32_t yaw_round = 0;
+    bool yaw_is_init = false;
+};
+
+extern IMU imu;
+
+#endif
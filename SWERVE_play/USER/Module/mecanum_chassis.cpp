@@ -1,2 +0,0 @@
-//留给后来者，学院很少使用麦轮，懒得封装
-#include "Chassis.h"
@@ -0,0 +1,287 @@
+/**
+ * @file param_tuner.cpp
+ * @author Yang JianYi
+ * @brief 串口在线调参，使用USART2，帧格式与ROS通讯相同：
+ *        0x55 0xAA + 数据长度 + 数据 + crc8(前面所有字节) + 0x0D 0x0A
+ *        请求数据：命令字 + 序号 + 参数；应答数据：命令字|0x80 + 相同的序号 + 状态 + 返回值，浮点数为小端。
+ *        INFO   请求 [index]                         应答 [index][num][type][value][min][max][name...]
+ *        FIND   请求 [name...]                       应答 [index][type][value]
+ *        GET    请求 [n][index...]                   应答 [n][index value]...
+ *        SET    请求 [n][index value]...             应答 [n]，出错时为 [出错的index]
+ *        COMMIT 请求 无                              应答 [记录序号 uint32]，底盘不是静止时返回TUNE_ERR_BUSY
+ *        REVERT 请求 无                              应答 无，flash中保存过的参数恢复为保存值
+ *        RESET  请求 无                              应答 无，与参数修改一样在控制周期之间执行
+ *        接收中断中只校验帧，把DMA缓存的指针放入Tune_Port队列(不拷贝)，请求在底盘任务的两次Control之间由Poll处理，
+ *        处理完后归还缓存。串口使用TUNE_RX_POOL_NUM块缓存轮流接收，缓存都未归还时新的请求被丢弃，上位机超时重发。
+ *        同一批修改应用后(调用Apply_Regist注册的函数)才发送应答，控制周期内不会看到只改了一半的参数。
+ *        flash擦除时CPU被挂起1~2s，COMMIT只在底盘静止时执行；保存后发送完应答，如果当前扇区已经放不下
+ *        下一条记录，底盘仍静止时就擦除另一个扇区(param_store.Prepare)，下一次COMMIT只需要编程。
+ *        上位机工具见Tools/param_tune.py。
+ * @version 0.1
+ * @date 2024-06-17
+ *
+ * @copyright Copyright (c) 2024
+ *
+ */
+#include "param_tuner.h"
+#include <string.h>
+
+Param_Tuner tuner(&huart2);
+
+
+static float Float_Get(const uint8_t *buffer)
+{
+    float value;
+    memcpy(&value, buffer, 4);
+    return value;
+}
+
+
+static void Float_Put(uint8_t *buffer, float value)
+{
+    memcpy(buffer, &value, 4);
+}
+
+
+/**
+ * @brief 校验一帧请求并放入队列，在串口接收回调(中断)中调用
+ * @return uint32_t 1表示缓存已放入队列，由Poll处理完后归还；0表示缓存可以立即重用
+ */
+uint32_t Param_Tuner::Recieve_From_Host(uint8_t *buffer, uint16_t len)
+{
+    if(len < 6 || buffer[0] != 0x55 || buffer[1] != 0xAA || buffer[2] + 6 != len
+       || buffer[len-2] != 0x0D || buffer[len-1] != 0x0A
+       || buffer[len-3] != serial_get_crc8_value((unsigned char *)buffer, len-3))
+    {
+        frame_error++;
+        return 0;
+    }
+
+    Tune_Frame_t frame;
+    frame.buffer = buffer;
+    frame.len = len;
+    if(Tune_Port == NULL || xQueueSendFromISR(Tune_Port, &frame, 0) != pdPASS)
+        return 0;
+    frame_cnt++;
+    return 1;
+}
+
+
+/**
+ * @brief 处理队列中的请求，在底盘任务的控制周期之间调用
+ *        有参数被修改时先应用再发送应答，本批的应答合并为一次发送
+ */
+void Param_Tuner::Poll(void)
+{
+    Tune_Frame_t frame;
+    uint8_t ack[TUNE_PAYLOAD_MAX];
+    uint8_t *buffer = tx_buff;
+    uint16_t tx_len = 0;
+
+    if(Tune_Port == NULL)
+        return;
+
+    for(int i=0; i<TUNE_BATCH_MAX && xQueueReceive(Tune_Port, &frame, 0) == pdPASS; i++)
+    {
+        uint8_t len = Request_Process(frame.buffer + 3, frame.buffer[2], ack);
+        Uart_Rx_Release(huart, frame.buffer);
+        tx_len += Frame_Pack(buffer + tx_len, ack, len);
+    }
+
+    if(changed)
+    {
+        if(apply != 0)
+            apply();
+        changed = false;
+    }
+
+    if(reset_request)
+    {
+        reset();
+        reset_request = false;
+    }
+
+    if(tx_len > 0)
+        Uart_Transmit(huart, buffer, tx_len);
+
+    //应答已交给DMA，擦除期间照常发送
+    if(prepare_request)
+    {
+        if(commit_check == 0 || commit_check())
+            param_store.Prepare();
+        prepare_request = false;
+    }
+}
+
+
+/**
+ * @brief 处理一条请求
+ *
+ * @param request 请求数据(命令字开始)
+ * @param ack 应答数据
+ * @return uint8_t 应答数据长度
+ */
+uint8_t Param_Tuner::Request_Process(const uint8_t *request, uint8_t len, uint8_t *ack)
+{
+    uint8_t n = 0;
+
+    if(len < 2)
+    {
+        ack[n++] = TUNE_ACK;
+        ack[n++] = 0;
+        ack[n++] = TUNE_ERR_CMD;
+        return n;
+    }
+
+    uint8_t cmd = request[0];
+    const uint8_t *arg = request + 2;
+    uint8_t arg_len = len - 2;
+
+    ack[n++] = cmd | TUNE_ACK;
+    ack[n++] = request[1];
+    uint8_t *status = &ack[n++];
+    *status = TUNE_OK;
+
+    switch(cmd)
+    {
+        case TUNE_CMD_INFO:
+        {
+            const Param_t *p = param_store.get_param(arg_len == 1 ? arg[0] : -1);
+            if(p == 0)
+            {
+                *status = (arg_len == 1) ? TUNE_ERR_INDEX : TUNE_ERR_CMD;
+                break;
+            }
+            ack[n++] = arg[0];
+            ack[n++] = param_store.get_num();
+            ack[n++] = p->type;
+            Float_Put(ack + n, param_store.Get(arg[0]));  n += 4;
+            Float_Put(ack + n, p->min);                   n += 4;
+            Float_Put(ack + n, p->max);                   n += 4;
+            for(const char *c = p->name; *c != '\0' && n < TUNE_PAYLOAD_MAX; c++)
+                ack[n++] = *c;
+            break;
+        }
+
+        case TUNE_CMD_FIND:
+        {
+            char name[TUNE_PAYLOAD_MAX];
+            memcpy(name, arg, arg_len);
+            name[arg_len] = '\0';
+            int index = param_store.Find(name);
+            if(index < 0)
+            {
+                *status = TUNE_ERR_INDEX;
+                break;
+            }
+            ack[n++] = index;
+            ack[n++] = param_store.get_param(index)->type;
+            Float_Put(ack + n, param_store.Get(index));   n += 4;
+            break;
+        }
+
+        case TUNE_CMD_GET:
+        {
+            if(arg_len < 1 || arg_len != 1 + arg[0] || 4 + 5*arg[0] > TUNE_PAYLOAD_MAX)
+            {
+                *status = TUNE_ERR_CMD;
+                break;
+            }
+            ack[n++] = arg[0];
+            for(int i=0; i<arg[0]; i++)
+            {
+                uint8_t index = arg[1+i];
+                if(param_store.get_param(index) == 0)
+                {
+                    *status = TUNE_ERR_INDEX;
+                    n = 3;
+                    ack[n++] = index;
+                    break;
+                }
+                ack[n++] = index;
+                Float_Put(ack + n, param_store.Get(index));   n += 4;
+            }
+            break;
+        }
+
+        case TUNE_CMD_SET:
+        {
+            if(arg_len < 1 || arg_len != 1 + 5*arg[0])
+            {
+                *status = TUNE_ERR_CMD;
+                break;
+            }
+
+            //先全部检查，有一个不合法就全部不修改
+            for(int i=0; i<arg[0]; i++)
+            {
+                uint8_t index = arg[1+5*i];
+                if(param_store.Check(index, Float_Get(arg + 2 + 5*i)) == false)
+                {
+                    *status = param_store.get_param(index) == 0 ? TUNE_ERR_INDEX : TUNE_ERR_RANGE;
+                    ack[n++] = index;
+                    break;
+                }
+            }
+            if(*status != TUNE_OK)
+                break;
+
+            for(int i=0; i<arg[0]; i++)
+                param_store.Set(arg[1+5*i], Float_Get(arg + 2 + 5*i));
+            changed = changed || arg[0] > 0;
+            ack[n++] = arg[0];
+            break;
+        }
+
+        case TUNE_CMD_COMMIT:
+        {
+            if(commit_check != 0 && commit_check() == false)
+                *status = TUNE_ERR_BUSY;
+            else if(param_store.Commit() == false)
+                *status = TUNE_ERR_FLASH;
+            else
+                prepare_request = true;
+            uint32_t seq = param_store.get_seq();
+            memcpy(ack + n, &seq, 4);   n += 4;
+            break;
+        }
+
+        case TUNE_CMD_REVERT:
+            param_store.Load();
+            changed = true;
+            break;
+
+        case TUNE_CMD_RESET:
+            if(reset == 0)
+                *status = TUNE_ERR_CMD;
+            else
+                reset_request = true;
+            break;
+
+        default:
+            *status = TUNE_ERR_CMD;
+            break;
+    }
+
+    return n;
+}
+
+
+/**
+ * @brief 按0x55 0xAA ... crc8 0x0D 0x0A打包
+ * @return uint16_t 帧长度
+ */
+uint16_t Param_Tuner::Frame_Pack(uint8_t *buffer, const uint8_t *payload, uint8_t len)
+{
+    uint16_t index = 0;
+    buffer[index++] = 0x55;
+    buffer[index++] = 0xAA;
+    buffer[index++] = len;
+    memcpy(buffer + index, payload, len);
+    index += len;
+    buffer[index] = serial_get_crc8_value(buffer, index);
+    index++;
+    buffer[index++] = 0x0D;
+    buffer[index++] = 0x0A;
+    return index;
+}
@@ -0,0 +1,64 @@
+#pragma once
+#include "stdint.h"
+#include "drive_uart.h"
+#include "data_pool.h"
+#include "param_store.h"
+
+//调参命令，应答的命令字为请求命令字|0x80
+#define TUNE_CMD_INFO       0x01    //按序号读取参数信息：类型、当前值、范围、名字
+#define TUNE_CMD_FIND       0x02    //按名字查找参数序号
+#define TUNE_CMD_GET        0x03    //按序号批量读取参数值
+#define TUNE_CMD_SET        0x04    //按序号批量修改参数值，全部合法才修改，在两个控制周期之间一次性生效
+#define TUNE_CMD_COMMIT     0x05    //把当前参数保存到flash，只在Commit_Check_Regist注册的函数返回true(底盘静止)时执行
+#define TUNE_CMD_REVERT     0x06    //重新从flash加载，丢弃未保存的修改
+#define TUNE_CMD_RESET      0x07    //调用Reset_Regist注册的函数，底盘为清除锁存的故障并重新回零
+#define TUNE_ACK            0x80
+
+//应答状态
+#define TUNE_OK             0
+#define TUNE_ERR_CMD        1       //未知命令或长度不对
+#define TUNE_ERR_INDEX      2       //参数不存在
+#define TUNE_ERR_RANGE      3       //超出范围
+#define TUNE_ERR_FLASH      4       //flash写入失败
+#define TUNE_ERR_BUSY       5       //机器人在运动，不能保存
+
+#define TUNE_PAYLOAD_MAX    (TUNE_UART_SIZE - 6)
+#define TUNE_BATCH_MAX      4       //每次Poll最多处理的请求数，应答合并后一次拷贝到串口发送缓存
+
+typedef void (*Tune_Apply_Fun)(void);
+
+#ifdef __cplusplus
+
+typedef bool (*Tune_Check_Fun)(void);
+
+class Param_Tuner
+{
+public:
+    Param_Tuner(UART_HandleTypeDef *huart) : huart(huart){}
+
+    void Apply_Regist(Tune_Apply_Fun fun) { apply = fun; }
+    void Reset_Regist(Tune_Apply_Fun fun) { reset = fun; }
+    void Commit_Check_Regist(Tune_Check_Fun fun) { commit_check = fun; }
+    uint32_t Recieve_From_Host(uint8_t *buffer, uint16_t len);
+    void Poll(void);
+
+    uint32_t frame_cnt = 0;     //收到的有效请求帧数
+    uint32_t frame_error = 0;   //帧头、帧尾或校验错误的帧数
+
+private:
+    UART_HandleTypeDef *huart;
+    Tune_Apply_Fun apply = 0;
+    Tune_Apply_Fun reset = 0;
+    Tune_Check_Fun commit_check = 0;
+    uint8_t tx_buff[TUNE_BATCH_MAX*TUNE_UART_SIZE];     //本批应答打包后拷贝到串口发送缓存
+    bool changed = false;
+    bool reset_request = false;
+    bool prepare_request = false;
+
+    uint8_t Request_Process(const uint8_t *request, uint8_t len, uint8_t *ack);
+    uint16_t Frame_Pack(uint8_t *buffer, const uint8_t *payload, uint8_t len);
+};
+
+extern Param_Tuner tuner;
+
+#endif
@@ -0,0 +1,215 @@
+/**
+ * @file task_monitor.cpp
+ * @author Yang JianYi
+ * @brief 任务负载监视：每TASK_MONITOR_PERIOD毫秒统计一次各任务的CPU占用、栈高水位和队列占用，通过USART2(调参串口)发送。
+ *        运行时间由FreeRTOS的运行时间统计(configGENERATE_RUN_TIME_STATS)提供，时基为TIM4的us计数，见freertos.c。
+ *        帧格式与调参相同：0x55 0xAA + 数据长度 + 数据 + crc8 + 0x0D 0x0A，数据区(小端)：
+ *        [0]     0x20 消息类型
+ *        [1:5]   uint32 时间戳，us     [5:9] uint32 统计周期，us
+ *        [9:11]  uint16 总CPU占用(100%减去IDLE)，0.01%
+ *        [11]    任务数n   [12] 队列数m
+ *        之后n个任务，每个14字节：名字(8字节，不足补0)、uint16 CPU占用(0.01%)、uint16 栈最小剩余(字节)、优先级、状态(eTaskState)
+ *        之后m个队列，每个11字节：名字(8字节)、当前数量、周期内的最大数量、队列长度
+ *        同一周期再发一帧话题统计(topic.h)，数据区：
+ *        [0]     0x21 消息类型   [1] 话题数k
+ *        之后k个话题，每个20字节：名字(12字节)、uint16 发布频率(Hz)、uint16 最近一次延时、uint16 周期内最大延时(us，超出为0xFFFF)、
+ *        uint16 累计overrun
+ *        调参上位机按命令字只取应答帧，不受这些帧影响。上位机工具见Tools/task_monitor.py。
+ * @version 0.1
+ * @date 2024-06-26
+ *
+ * @copyright Copyright (c) 2024
+ *
+ */
+#include "task_monitor.h"
+#include <string.h>
+
+//与tasks.c中的默认值相同
+#ifndef configIDLE_TASK_NAME
+#define configIDLE_TASK_NAME "IDLE"
+#endif
+
+Task_Monitor task_monitor(&huart2);
+
+static_assert(TASK_MONITOR_PAYLOAD_MAX <= 255, "task monitor frame does not fit the one byte length field");
+static_assert(2 + TOPIC_MONITOR_MAX*TOPIC_MONITOR_SIZE <= TASK_MONITOR_PAYLOAD_MAX, "topic frame does not fit tx_buff");
+
+
+/**
+ * @brief 添加一个要监视的队列，名字取队列注册表中的名字(vQueueAddToRegistry)
+ */
+void Task_Monitor::Queue_Regist(QueueHandle_t handle)
+{
+    if(handle == NULL || queues >= TASK_MONITOR_MAX_QUEUES)
+        return;
+
+    Queue_Load_t init = {0};
+    init.queue = handle;
+    init.size = (uint8_t)(uxQueueMessagesWaiting(handle) + uxQueueSpacesAvailable(handle));
+    queue[queues++] = init;
+}
+
+
+/**
+ * @brief 每ms调用一次：采样队列占用，到统计周期时计算负载并发送
+ */
+void Task_Monitor::Poll(void)
+{
+    for(int i=0; i<queues; i++)
+    {
+        uint8_t used = (uint8_t)uxQueueMessagesWaiting(queue[i].queue);
+        queue[i].used = used;
+        if(used > queue[i].peak)
+            queue[i].peak = used;
+    }
+
+    TickType_t tick = xTaskGetTickCount();
+    if(tick - last_tick < pdMS_TO_TICKS(TASK_MONITOR_PERIOD))
+        return;
+    last_tick = tick;
+
+    Update();
+    Send();
+    Topics_Send();
+    for(int i=0; i<queues; i++)
+        queue[i].peak = queue[i].used;
+}
+
+
+/**
+ * @brief 读取所有任务的运行时间，与上一次的差值除以周期即为CPU占用。
+ *        按句柄匹配上一次的记录，任务顺序变化不影响；计数器回绕时无符号差值仍然正确
+ */
+void Task_Monitor::Update(void)
+{
+    uint32_t total;
+    UBaseType_t n = uxTaskGetSystemState(status, TASK_MONITOR_MAX_TASKS, &total);
+    if(n == 0)
+        return;     //任务数超过TASK_MONITOR_MAX_TASKS
+
+    window = total - last_total;
+    last_total = total;
+
+    //先按上一次的记录算出各任务的运行时间增量，再覆盖记录
+    uint32_t delta[TASK_MONITOR_MAX_TASKS];
+    for(UBaseType_t i=0; i<n; i++)
+    {
+        delta[i] = status[i].ulRunTimeCounter;
+        for(int j=0; j<tasks; j++)
+        {
+            if(task[j].handle == status[i].xHandle)
+            {
+                delta[i] -= task[j].run_time;
+                break;
+            }
+        }
+    }
+
+    load = 0;
+    for(UBaseType_t i=0; i<n; i++)
+    {
+        Task_Load_t &t = task[i];
+        uint64_t cpu = window > 0 ? (uint64_t)delta[i] * 10000 / window : 0;
+        t.name = status[i].pcTaskName;
+        t.handle = status[i].xHandle;
+        t.run_time = status[i].ulRunTimeCounter;
+        t.cpu = cpu > 10000 ? 10000 : (uint16_t)cpu;
+        t.stack_free = (uint16_t)(status[i].usStackHighWaterMark * sizeof(StackType_t));
+        t.priority = (uint8_t)status[i].uxCurrentPriority;
+        t.state = (uint8_t)status[i].eCurrentState;
+
+        if(strcmp(t.name, configIDLE_TASK_NAME) == 0)
+            load = 10000 - t.cpu;
+    }
+    tasks = (uint8_t)n;
+}
+
+
+static uint8_t *Put_Name(uint8_t *p, const char *name, int len = TASK_MONITOR_NAME_LEN)
+{
+    memset(p, 0, len);
+    if(name != NULL)
+        strncpy((char *)p, name, len);
+    return p + len;
+}
+
+
+static void Put_Uint16(uint8_t *p, uint32_t value)
+{
+    uint16_t v = value > 0xFFFF ? 0xFFFF : (uint16_t)value;
+    memcpy(p, &v, 2);
+}
+
+
+static uint16_t Frame_Pack(uint8_t *frame, uint8_t len)
+{
+    frame[0] = 0x55;
+    frame[1] = 0xAA;
+    frame[2] = len;
+    frame[3+len] = serial_get_crc8_value(frame, 3+len);
+    frame[4+len] = 0x0D;
+    frame[5+len] = 0x0A;
+    return len + 6;
+}
+
+
+void Task_Monitor::Send(void)
+{
+    uint8_t *p = tx_buff + 3;
+    uint32_t now = last_total;
+
+    p[0] = TASK_MONITOR_MSG_ID;
+    memcpy(p + 1, &now, 4);
+    memcpy(p + 5, &window, 4);
+    memcpy(p + 9, &load, 2);
+    p[11] = tasks;
+    p[12] = queues;
+    p += TASK_MONITOR_HEAD_SIZE;
+
+    for(int i=0; i<tasks; i++)
+    {
+        p = Put_Name(p, task[i].name);
+        memcpy(p, &task[i].cpu, 2);
+        memcpy(p + 2, &task[i].stack_free, 2);
+        p[4] = task[i].priority;
+        p[5] = task[i].state;
+        p += 6;
+    }
+    for(int i=0; i<queues; i++)
+    {
+        p = Put_Name(p, pcQueueGetName(queue[i].queue));
+        p[0] = queue[i].used;
+        p[1] = queue[i].peak;
+        p[2] = queue[i].size;
+        p += 3;
+    }
+
+    Uart_Transmit(huart, tx_buff, Frame_Pack(tx_buff, (uint8_t)(p - tx_buff - 3)));
+}
+
+
+/**
+ * @brief 结束各话题的统计周期，发送话题的发布频率和延时
+ */
+void Task_Monitor::Topics_Send(void)
+{
+    uint8_t *p = tx_buff + 3;
+    uint8_t n = 0;
+
+    p[0] = TOPIC_MONITOR_MSG_ID;
+    p += 2;
+    for(Topic_Base *topic = Topic_Base::First(); topic != NULL && n < TOPIC_MONITOR_MAX; topic = topic->Next(), n++)
+    {
+        topic->Stats_Update(last_total);
+        Topic_Stats_t stats = topic->get_stats();
+        p = Put_Name(p, topic->get_name(), TOPIC_MONITOR_NAME_LEN);
+        Put_Uint16(p, stats.rate);
+        Put_Uint16(p + 2, stats.latency);
+        Put_Uint16(p + 4, stats.latency_max);
+        Put_Uint16(p + 6, stats.overrun);
+        p += 8;
+    }
+    tx_buff[4] = n;
+
+    Uart_Transmit(huart, tx_buff, Frame_Pack(tx_buff, (uint8_t)(p - tx_buff - 3)));
+}
@@ -0,0 +1,77 @@
+#pragma once
+#include "stdint.h"
+#include "drive_uart.h"
+#include "data_pool.h"
+#include "task.h"
+#include "topic.h"
+
+#define TASK_MONITOR_MAX_TASKS  10      //TASK_NUM(6)个应用任务、IDLE、Tmr Svc，留两个余量
+#define TASK_MONITOR_MAX_QUEUES 6
+#define TASK_MONITOR_NAME_LEN   8       //发送的名字长度，超出截断
+#define TASK_MONITOR_MSG_ID     0x20    //数据区第一个字节，与调参应答(0x81~0x86)区分
+#define TASK_MONITOR_HEAD_SIZE  13
+#define TASK_MONITOR_TASK_SIZE  (TASK_MONITOR_NAME_LEN + 6)
+#define TASK_MONITOR_QUEUE_SIZE (TASK_MONITOR_NAME_LEN + 3)
+#define TASK_MONITOR_PAYLOAD_MAX (TASK_MONITOR_HEAD_SIZE + TASK_MONITOR_MAX_TASKS*TASK_MONITOR_TASK_SIZE \
+                                + TASK_MONITOR_MAX_QUEUES*TASK_MONITOR_QUEUE_SIZE)
+
+//话题统计帧
+#define TOPIC_MONITOR_MSG_ID    0x21
+#define TOPIC_MONITOR_NAME_LEN  12
+#define TOPIC_MONITOR_SIZE      (TOPIC_MONITOR_NAME_LEN + 8)
+#define TOPIC_MONITOR_MAX       10      //超出的话题不发送
+
+//一个任务在上一个统计周期内的情况
+typedef struct Task_Load_t
+{
+    const char *name;
+    TaskHandle_t handle;
+    uint32_t run_time;          //累计运行时间，us，32位回绕，只用差值
+    uint16_t cpu;               //上一个周期的CPU占用，0.01%
+    uint16_t stack_free;        //栈的最小剩余量(高水位)，字节
+    uint8_t priority;
+    uint8_t state;              //eTaskState
+}Task_Load_t;
+
+//队列的占用，peak为每次Poll采样到的最大值，Poll之间的短暂峰值看不到
+typedef struct Queue_Load_t
+{
+    QueueHandle_t queue;
+    uint8_t used;
+    uint8_t peak;
+    uint8_t size;
+}Queue_Load_t;
+
+#ifdef __cplusplus
+
+class Task_Monitor
+{
+public:
+    Task_Monitor(UART_HandleTypeDef *huart) : huart(huart){}
+
+    void Queue_Regist(QueueHandle_t queue);
+    void Poll(void);
+
+    uint16_t get_load(void) const { return load; }
+    uint8_t get_tasks(void) const { return tasks; }
+    const Task_Load_t &get_task(uint8_t index) const { return task[index]; }
+
+private:
+    UART_HandleTypeDef *huart;
+    TaskStatus_t status[TASK_MONITOR_MAX_TASKS];    //uxTaskGetSystemState的输出，放在这里不占调用任务的栈
+    Task_Load_t task[TASK_MONITOR_MAX_TASKS];
+    Queue_Load_t queue[TASK_MONITOR_MAX_QUEUES];
+    uint8_t tasks = 0, queues = 0;
+    uint16_t load = 0;                              //总CPU占用(100%-IDLE)，0.01%
+    uint32_t last_total = 0, window = 0;
+    TickType_t last_tick = 0;
+    uint8_t tx_buff[TASK_MONITOR_PAYLOAD_MAX + 6];
+
+    void Update(void);
+    void Send(void);
+    void Topics_Send(void);
+};
+
+extern Task_Monitor task_monitor;
+
+#endif
@@ -0,0 +1,255 @@
+/**
+ * @file telemetry.cpp
+ * @author Yang JianYi
+ * @brief 上行遥测，底盘状态按固定频率通过USART3(ROS串口)DMA发送给上位机。
+ *        帧格式与下行相同：0x55 0xAA + 数据长度 + 数据 + crc8 + 0x0D 0x0A，数据区(小端)：
+ *        [0]     0x10 消息类型
+ *        [1:3]   uint16 帧序号，上位机根据序号间隔统计丢帧
+ *        [3:7]   uint32 时间戳，us
+ *        [7:9]   uint16 累计丢帧数
+ *        [9:33]  float x、y(m)，yaw(度)，vx、vy(m/s)，wz(rad/s)
+ *        [33:41] int16 x4 舵向角度，0.01度，范围±180
+ *        [41:49] int16 x4 轮向电机转速，rpm(VESC为eRPM)
+ *        [49:57] int16 x4 舵向电机电流，0.01A
+ *        [57:65] int16 x4 轮向电机电流，0.01A
+ *        [65:69] 8个电机的故障位，每个4位，低4位为偶数通道
+ *        [69]    状态位，[70] 回零状态
+ *        [71:73] uint16 母线电压，0.01V，[73] 电流预算使用率，%
+ *        [74:78] uint32 [3:7]换算到上位机时钟的时间戳，us，未对时为0
+ *        [78]    对时应答序号，0表示没有请求，[79:83] uint32 请求中的t1(上位机时钟)，[83:87] uint32 收到请求的时刻t2
+ *        [87:91] uint32 本帧开始发送的时刻t3，在启动DMA时写入，同一个请求的应答会重复出现在之后的帧中，上位机取最先收到的一帧
+ *        [91:93] uint16 最近一帧控制帧的帧龄，0.1ms，0xFFFF表示未知，[93:95] uint16 超时丢弃的控制帧数
+ *        控制周期内只打包、不等待发送：DMA空闲时立即发送，忙时放入另一块缓存，在发送完成中断中接着发送。
+ *        115200波特率每秒只能发约150帧，USART3改为921600，Rate_Set按波特率限制最高频率。
+ *        [3:7]以外的时刻均为本地时钟，上位机用对时结果换算，见clock_sync.h。
+ * @version 0.1
+ * @date 2024-06-18
+ *
+ * @copyright Copyright (c) 2024
+ *
+ */
+#include "telemetry.h"
+#include "task.h"
+#include <string.h>
+
+Telemetry telemetry(&huart3);
+
+
+
+/**
+ * @brief 设置发送频率，限制在TELEMETRY_RATE_MIN~TELEMETRY_RATE_MAX之间，且不超过串口带宽的90%
+ * @return uint16_t 实际使用的频率
+ */
+uint16_t Telemetry::Rate_Set(uint16_t hz)
+{
+    uint32_t max = huart->Init.BaudRate / 10 * 9 / 10 / TELEMETRY_FRAME_SIZE;
+    if(max > TELEMETRY_RATE_MAX)
+        max = TELEMETRY_RATE_MAX;
+
+    if(hz < TELEMETRY_RATE_MIN)
+        hz = TELEMETRY_RATE_MIN;
+    if(hz > max)
+        hz = max;
+
+    rate = hz;
+    period = 1000000 / hz;
+    return rate;
+}
+
+
+/**
+ * @brief 是否到了发送下一帧的时间，到时返回true并开始下一个周期
+ */
+bool Telemetry::Is_Due(void)
+{
+    uint32_t now = Get_SystemTimer();
+    Window_Update(now);
+    if(now - last_time < period)
+        return false;
+
+    //落后超过一个周期时不补发
+    last_time = (now - last_time < 2*period) ? last_time + period : now;
+    return true;
+}
+
+
+/**
+ * @brief 打包一帧并交给DMA发送，不等待发送完成
+ */
+void Telemetry::Publish(const Telemetry_Data_t &data)
+{
+    int8_t index;
+
+    //上一帧还没开始发送就被这一帧覆盖
+    taskENTER_CRITICAL();
+    if(pending >= 0)
+    {
+        index = pending;
+        pending = -1;
+        frames_dropped++;
+    }
+    else
+    {
+        index = (sending == 0) ? 1 : 0;
+    }
+    taskEXIT_CRITICAL();
+
+    Encode(buffer[index], data);
+
+    taskENTER_CRITICAL();
+    pending = index;
+    if(busy == false)
+        Start(index);
+    taskEXIT_CRITICAL();
+}
+
+
+/**
+ * @brief DMA发送完成，在HAL_UART_TxCpltCallback中调用
+ */
+void Telemetry::Tx_Complete(void)
+{
+    busy = false;
+    frames_sent++;
+    bytes_sent += TELEMETRY_FRAME_SIZE;
+    if(pending >= 0)
+        Start(pending);
+    else
+        sending = -1;
+}
+
+
+Telemetry_Stats_t Telemetry::get_stats(void) const
+{
+    Telemetry_Stats_t stats;
+    stats.frames_sent = frames_sent;
+    stats.frames_dropped = frames_dropped;
+    stats.bytes_sent = bytes_sent;
+    stats.throughput = throughput;
+    stats.frame_rate = frame_rate;
+    stats.rate = rate;
+    return stats;
+}
+
+
+/**
+ * @brief 开始发送一块缓存，调用时中断已屏蔽(临界区或发送完成中断中)
+ */
+void Telemetry::Start(int8_t index)
+{
+    pending = -1;
+
+    //发送时刻t3写入帧中后重新计算校验
+    uint8_t *frame = buffer[index];
+    uint32_t now = Get_SystemTimer();
+    memcpy(frame + 3 + 87, &now, 4);
+    frame[3+TELEMETRY_PAYLOAD_SIZE] = serial_get_crc8_value(frame, 3+TELEMETRY_PAYLOAD_SIZE);
+    if(clock != NULL)
+        clock->Tx_Stamp(frame[3+78], now);
+
+    if(HAL_UART_Transmit_DMA(huart, frame, TELEMETRY_FRAME_SIZE) == HAL_OK)
+    {
+        busy = true;
+        sending = index;
+    }
+    else
+    {
+        sending = -1;
+        frames_dropped++;
+    }
+}
+
+
+/**
+ * @brief 每秒统计一次实际发送的帧数和字节数
+ */
+void Telemetry::Window_Update(uint32_t now)
+{
+    if(now - window_start < 1000000)
+        return;
+
+    uint32_t frames = frames_sent, bytes = bytes_sent;
+    float k = 1e6f / (float)(now - window_start);
+    frame_rate = (uint32_t)((frames - window_frames) * k);
+    throughput = (uint32_t)((bytes - window_bytes) * k);
+    window_frames = frames;
+    window_bytes = bytes;
+    window_start = now;
+}
+
+
+static void Put_Int16(uint8_t *buffer, float value)
+{
+    if(value > 32767)
+        value = 32767;
+    else if(value < -32768)
+        value = -32768;
+    int16_t v = (int16_t)value;
+    memcpy(buffer, &v, 2);
+}
+
+
+void Telemetry::Encode(uint8_t *frame, const Telemetry_Data_t &data)
+{
+    uint8_t *p = frame + 3;
+    uint32_t now = Get_SystemTimer();
+    uint16_t dropped = (uint16_t)frames_dropped;
+    float odom[6] = {data.x, data.y, data.yaw, data.vx, data.vy, data.wz};
+
+    frame[0] = 0x55;
+    frame[1] = 0xAA;
+    frame[2] = TELEMETRY_PAYLOAD_SIZE;
+
+    p[0] = TELEMETRY_MSG_ID;
+    memcpy(p + 1, &seq, 2);
+    memcpy(p + 3, &now, 4);
+    memcpy(p + 7, &dropped, 2);
+    memcpy(p + 9, odom, sizeof(odom));
+    for(int i=0; i<TELEMETRY_MODULES; i++)
+    {
+        //舵向角度是多圈累加值，发送时折算到±180度
+        float angle = data.module_angle[i] - 360.0f*(int32_t)(data.module_angle[i]/360.0f);
+        if(angle > 180)
+            angle -= 360;
+        else if(angle < -180)
+            angle += 360;
+        Put_Int16(p + 33 + 2*i, angle*100);
+        Put_Int16(p + 41 + 2*i, data.wheel_speed[i]);
+        Put_Int16(p + 49 + 2*i, data.rudder_current[i]*100);
+        Put_Int16(p + 57 + 2*i, data.wheel_current[i]*100);
+    }
+    for(int i=0; i<TELEMETRY_CHANNELS/2; i++)
+        p[65+i] = (data.faults[2*i] & 0x0F) | (data.faults[2*i+1] << 4);
+    p[69] = data.status;
+    if(clock != NULL && clock->is_synced(now))
+        p[69] |= TELEMETRY_CLOCK_SYNC;
+    p[70] = data.homing_state;
+    uint16_t voltage = data.bus_voltage > 0 ? (uint16_t)(data.bus_voltage*100) : 0;
+    memcpy(p + 71, &voltage, 2);
+    float usage = data.power_usage*100;
+    p[73] = usage > 255 ? 255 : (usage < 0 ? 0 : (uint8_t)usage);
+
+    uint8_t sync_seq = 0;
+    uint32_t host = 0, t1 = 0, t2 = 0, t3 = 0;
+    if(clock != NULL)
+    {
+        if(p[69] & TELEMETRY_CLOCK_SYNC)
+            host = clock->To_Host(now);
+        clock->get_echo(&sync_seq, &t1, &t2);
+    }
+    memcpy(p + 74, &host, 4);
+    p[78] = sync_seq;
+    memcpy(p + 79, &t1, 4);
+    memcpy(p + 83, &t2, 4);
+    memcpy(p + 87, &t3, 4);
+    float age = cmd_age / 100.0f;
+    uint16_t age_raw = (cmd_age < 0 || age > 65534) ? 0xFFFF : (uint16_t)age;
+    uint16_t stale = cmd_stale > 0xFFFF ? 0xFFFF : (uint16_t)cmd_stale;
+    memcpy(p + 91, &age_raw, 2);
+    memcpy(p + 93, &stale, 2);
+
+    frame[3+TELEMETRY_PAYLOAD_SIZE] = serial_get_crc8_value(frame, 3+TELEMETRY_PAYLOAD_SIZE);
+    frame[4+TELEMETRY_PAYLOAD_SIZE] = 0x0D;
+    frame[5+TELEMETRY_PAYLOAD_SIZE] = 0x0A;
+    seq++;
+}
@@ -0,0 +1,94 @@
+#pragma once
+#include "stdint.h"
+#include "drive_uart.h"
+#include "data_pool.h"
+#include "clock_sync.h"
+#include "sys_clock.h"
+
+#define TELEMETRY_MODULES       4       //每帧的模组(轮子)数，不足4个的底盘其余填0
+#define TELEMETRY_CHANNELS      8       //故障位通道数
+#define TELEMETRY_MSG_ID        0x10    //数据区第一个字节，与下行控制帧区分
+#define TELEMETRY_PAYLOAD_SIZE  95
+#define TELEMETRY_FRAME_SIZE    (TELEMETRY_PAYLOAD_SIZE + 6)
+#define TELEMETRY_RATE_MIN      100
+#define TELEMETRY_RATE_MAX      1000
+
+//状态位
+#define TELEMETRY_CHASSIS_INIT  0x01    //舵向已回零
+#define TELEMETRY_IMU_ONLINE    0x02
+#define TELEMETRY_HEADING_HOLD  0x04    //航向保持开启
+#define TELEMETRY_CLOCK_SYNC    0x08    //已与上位机对时，上位机时间戳有效
+
+//一帧遥测的原始数据，由底盘任务填写
+typedef struct Telemetry_Data_t
+{
+    float x, y, yaw;                            //里程计，m、m、度
+    float vx, vy, wz;                           //底盘速度，m/s、rad/s
+    float module_angle[TELEMETRY_MODULES];      //舵向角度，度；轮速底盘为0
+    float wheel_speed[TELEMETRY_MODULES];       //轮向电机转速，rpm(VESC为eRPM)
+    float rudder_current[TELEMETRY_MODULES];    //舵向电机电流，A
+    float wheel_current[TELEMETRY_MODULES];     //轮向电机电流，A
+    uint8_t faults[TELEMETRY_CHANNELS];         //各电机故障位，见fault_monitor.h
+    uint8_t status;                             //TELEMETRY_xxx状态位
+    uint8_t homing_state;
+    float bus_voltage;                          //V
+    float power_usage;                          //电流预算使用率，0~1
+}Telemetry_Data_t;
+
+//发送统计
+typedef struct Telemetry_Stats_t
+{
+    uint32_t frames_sent;       //DMA发送完成的帧数
+    uint32_t frames_dropped;    //DMA来不及发送、被新帧覆盖的帧数
+    uint32_t bytes_sent;
+    uint32_t throughput;        //最近1s实际发送的字节数，B/s
+    uint32_t frame_rate;        //最近1s实际发送的帧数，Hz
+    uint16_t rate;              //当前设定的发送频率，Hz
+}Telemetry_Stats_t;
+
+#ifdef __cplusplus
+
+class Telemetry
+{
+public:
+    Telemetry(UART_HandleTypeDef *huart) : huart(huart){}
+
+    uint16_t Rate_Set(uint16_t hz);
+    bool Is_Due(void);
+    void Publish(const Telemetry_Data_t &data);
+    void Tx_Complete(void);
+    Telemetry_Stats_t get_stats(void) const;
+    void Clock_Regist(Clock_Sync *clock) { this->clock = clock; }
+    void Cmd_Age_Set(int32_t age, uint32_t stale) { cmd_age = age; cmd_stale = stale; }
+
+private:
+    UART_HandleTypeDef *huart;
+    Clock_Sync *clock = NULL;
+    int32_t cmd_age = -1;
+    uint32_t cmd_stale = 0;
+
+    //双缓存：一块由DMA发送，另一块写入新帧。新帧来时另一块还没发出去就覆盖它(计为丢帧)，保证发出的总是最新数据
+    uint8_t buffer[2][TELEMETRY_FRAME_SIZE];
+    volatile bool busy = false;             //DMA正在发送
+    volatile int8_t sending = -1;           //正在发送的缓存
+    volatile int8_t pending = -1;           //已写好、等待发送的缓存
+    uint16_t seq = 0;
+
+    uint16_t rate = TELEMETRY_RATE_MIN;
+    uint32_t period = 1000000 / TELEMETRY_RATE_MIN;
+    uint32_t last_time = 0;
+
+    volatile uint32_t frames_sent = 0;
+    volatile uint32_t bytes_sent = 0;
+    uint32_t frames_dropped = 0;
+    uint32_t window_start = 0, window_frames = 0, window_bytes = 0;
+    uint32_t throughput = 0, frame_rate = 0;
+
+    void Start(int8_t index);
+    void Encode(uint8_t *frame, const Telemetry_Data_t &data);
+    void Window_Update(uint32_t now);
+};
+
+extern Telemetry telemetry;
+
+#endif